@@ -0,0 +1,69 @@
+#ifndef _ASSETS_H
+#define _ASSETS_H
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "mesh.h"
+#include "texture.h"
+
+#define ASSET_IMAGE 0
+#define ASSET_MESH  1
+
+// Um arquivo a ser carregado pelo AssetLoader. Depois que o trabalho termina,
+// "texture" ou "mesh" contém o resultado, pronto para ser enviado para a GPU.
+struct AssetJob
+{
+    int          kind;          // ASSET_IMAGE ou ASSET_MESH
+    std::string  filename;
+    int          texture_index; // Somente para ASSET_IMAGE: índice da textura no jogo, usado para entregá-la ao streaming de texturas
+    int          image_size;    // Somente para ASSET_IMAGE: lado da imagem quadrada enviada para a GPU; 0 mantém o tamanho do arquivo
+    int          texture_format; // Somente para ASSET_IMAGE: TEXTURE_FORMAT_RGB8 ou TEXTURE_FORMAT_BC1
+    unsigned int vertex_format; // Somente para ASSET_MESH: formato dos vértices (VERTEX_FORMAT_DEFAULT, etc.)
+
+    TextureData    texture;
+    LoadedMesh     mesh;
+    PackedVertices vertices; // Vértices de "mesh" já intercalados no formato "vertex_format"
+
+    double       load_time = 0.0; // Tempo, em segundos, gasto por uma thread auxiliar neste arquivo
+    std::string  error;           // Mensagem de erro, se o arquivo não pôde ser carregado; vazia se pôde
+};
+
+// Carregamento de imagens e malhas em paralelo. As partes que não dependem
+// de OpenGL (leitura do disco, decodificação de JPEG/PNG e compressão das
+// texturas, leitura dos OBJ, ou dos caches de ambos) são executadas por um
+// conjunto de threads auxiliares; a thread que possui o contexto OpenGL
+// recebe os arquivos prontos, na ordem em que terminam, através de
+// WaitFinishedAsset(), e somente os envia para a GPU. Assim o tempo total
+// fica limitado pelo arquivo mais lento, e não pela soma de todos eles.
+//
+// Todos os arquivos devem ser incluídos com AddImageJob() e AddMeshJob()
+// antes de StartAssetLoader().
+struct AssetLoader
+{
+    std::deque<AssetJob>     jobs; // Um deque nunca move os elementos já incluídos; os ponteiros para eles permanecem válidos
+    std::vector<size_t>      order; // Ordem em que os trabalhos são executados: do maior arquivo para o menor
+
+    std::vector<std::thread> threads;
+    unsigned int             num_threads = 0;
+    std::mutex               mutex;
+    std::condition_variable  condition;
+    size_t                   next_job = 0;   // Próxima posição de "order" a ser executada
+    std::vector<size_t>      finished;       // Trabalhos terminados e ainda não entregues por WaitFinishedAsset()
+    size_t                   delivered = 0;  // Trabalhos já entregues
+
+    double                   start_time = 0.0;
+};
+
+void AddImageJob(AssetLoader& loader, const char* filename, int texture_index, int image_size = 0, int texture_format = TEXTURE_FORMAT_RGB8);
+void AddMeshJob(AssetLoader& loader, const char* filename, unsigned int vertex_format = VERTEX_FORMAT_DEFAULT);
+void StartAssetLoader(AssetLoader& loader, unsigned int num_threads = 0); // 0: uma thread por núcleo
+AssetJob* WaitFinishedAsset(AssetLoader& loader); // Retorna NULL quando todos os arquivos já foram entregues
+void StopAssetLoader(AssetLoader& loader); // Descarta os trabalhos ainda não iniciados e espera as threads terminarem
+void PrintAssetLoadingReport(const AssetLoader& loader, double upload_time);
+
+#endif // _ASSETS_H
@@ -1,3 +1,9 @@
+#ifndef _COLLISIONS_H
+#define _COLLISIONS_H
+
+#include <vector>
+#include <cstdint>
+
 #include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -19,6 +25,13 @@
 #define RAIO_ESFERAS 0.5
 #define VELOCIDADE_ALVOS 3
 #define ALTURA_BALAS 0.8
+#define QUANTIDADE_ESFERAS 4
+
+/* Limites da grade uniforme usada na fase ampla dos testes de colisão. A grade cobre
+o plano XZ do cenário (o mesmo intervalo de LIMITE_ESQUERDA..LIMITE_DIREITA usado em main.cpp). */
+#define LIMITE_MIN_GRADE -15.0
+#define LIMITE_MAX_GRADE 15.0
+#define TAMANHO_CELULA_GRADE 1.0
 
 typedef struct
 {
@@ -48,17 +61,40 @@ typedef struct
 
 } Esfera;
 
+/* Número de balas testadas de uma vez pelo teste vetorizado testa_lote_balas_aabb(). */
+#define LARGURA_LOTE_BALAS 8
+
+/* Conjunto de balas guardado como estrutura de vetores (SoA): cada atributo fica em um vetor
+contíguo próprio, de forma que os laços de colisão leem somente as posições e o estado das balas,
+e o teste vetorizado carrega 8 balas por instrução. O índice i identifica a mesma bala em todos os vetores.
+Os vetores têm tamanho múltiplo de LARGURA_LOTE_BALAS; as posições excedentes nunca são ativadas. */
 typedef struct
 {
-    float x = 0.0;
-    float y = ALTURA_BALAS;
-    float z = 0.0;
-    glm::vec4 direcao = glm::vec4(0.0f,0.0f,0.0f,0.0f);
-    glm::vec4 eixo_rotacao_normalizado = glm::vec4(0.0f,0.0f,0.0f,0.0f);
-    float angulo_rotacao;
-    bool desenhar = false;
+    int quantidade = 0;
+
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+
+    /* Posição da bala no início do último deslocamento. Os testes de colisão varrem o
+    segmento entre esta posição e a atual, para que balas rápidas não atravessem objetos finos. */
+    std::vector<float> x_anterior;
+    std::vector<float> y_anterior;
+    std::vector<float> z_anterior;
+
+    /* 1 se a bala está em voo (deve ser desenhada), 0 caso contrário. Inteiros de 32 bits,
+    para serem usados diretamente como máscara nos testes vetorizados. */
+    std::vector<int32_t> desenhar;
 
-} Bala;
+    /* 1 se a bala atingiu um objeto do cenário neste quadro. A posição atual já foi recuada
+    até o ponto de impacto, e a bala é removida em controla_balas() no quadro seguinte. */
+    std::vector<int32_t> atingiu_cenario;
+
+    std::vector<glm::vec4> direcao;
+    std::vector<glm::vec4> eixo_rotacao_normalizado;
+    std::vector<float> angulo_rotacao;
+
+} Balas;
 
 typedef struct
 {
@@ -71,16 +107,90 @@ typedef struct
 
 } ObjetoCenario;
 
+/* Intervalo de células (inclusivo) ocupado por um objeto na grade. x0 < 0 indica objeto fora da grade. */
+typedef struct
+{
+    int x0 = -1;
+    int z0 = -1;
+    int x1 = -1;
+    int z1 = -1;
+
+} IntervaloGrade;
+
+/* Grade uniforme no plano XZ. Cada célula guarda os índices dos objetos cujas bounding
+boxes a sobrepõem, de modo que um ponto só precisa ser testado contra os objetos da sua célula. */
+typedef struct
+{
+    int colunas = 0;
+    std::vector< std::vector<int> > celulas;
+    std::vector<IntervaloGrade> intervalos;
+
+} GradeColisao;
+
+/* Aloca "quantidade" balas, todas fora de voo. */
+void inicializa_balas(Balas& balas, int quantidade);
+
+/* Teste vetorizado: compara as caixas que envolvem os segmentos das balas primeira .. primeira+7 com uma caixa.
+Retorna uma máscara com o bit k ligado se a bala primeira+k está em voo e a sua caixa sobrepõe a caixa dada,
+isto é, se ela pode intersectar o objeto. "primeira" deve ser múltiplo de LARGURA_LOTE_BALAS. Usa AVX2 ou SSE2
+quando o compilador os habilita (-mavx2, ou SSE2 por padrão em x86-64) e, fora isso, uma versão escalar. */
+int testa_lote_balas_aabb(const Balas& balas, int primeira, glm::vec4 bbox_minimo, glm::vec4 bbox_maximo);
+
+/* Prepara uma grade vazia capaz de indexar "quantidade" objetos. */
+void inicializa_grade(GradeColisao& grade, int quantidade);
+
+/* Insere (ou move) o objeto "id" na grade, de acordo com a sua bounding box. Só altera as
+células quando o intervalo ocupado muda, então pode ser chamada a cada quadro para objetos que se movem. */
+void atualiza_grade(GradeColisao& grade, int id, glm::vec4 bbox_minimo, glm::vec4 bbox_maximo);
+
+/* Retira o objeto "id" de todas as células da grade. */
+void remove_da_grade(GradeColisao& grade, int id);
+
+/* Retorna os índices dos objetos que podem conter o ponto (x, z). */
+const std::vector<int>& consulta_grade(const GradeColisao& grade, float x, float z);
+
+/* Preenche "candidatos" com os índices (sem repetição) dos objetos das células cobertas pelo
+retângulo que envolve o segmento de (x0, z0) a (x1, z1). */
+void consulta_grade_segmento(const GradeColisao& grade, float x0, float z0, float x1, float z1, std::vector<int>& candidatos);
+
+/* Teste de colisão segmento-cubo (método das "slabs"). Se o segmento de "inicio" a "fim" intersecta a caixa,
+retorna true e guarda em t_entrada o parâmetro (entre 0 e 1) do primeiro ponto de contato. */
+bool intersecta_segmento_aabb(glm::vec4 inicio, glm::vec4 fim, glm::vec4 bbox_minimo, glm::vec4 bbox_maximo, float& t_entrada);
 
+/* Teste de colisão segmento-esfera, análogo ao anterior. */
+bool intersecta_segmento_esfera(glm::vec4 inicio, glm::vec4 fim, glm::vec4 centro, float raio, float& t_entrada);
 
-/* Função com teste de colisão ponto-cubo, responsável por impedir que um alvo seja desenhado, caso seja acertado por uma bala. */
-void destroi_alvos(Bala vetor_balas[], Alvo vetor_alvos[]);
+/* Calcula a bounding box, em coordenadas do mundo, de uma caixa dada em coordenadas locais e transformada
+pela matriz de modelagem "modelo". O resultado é a menor caixa alinhada aos eixos que contém os 8 cantos
+transformados, mesmo quando "modelo" tem rotações ou escalas negativas. */
+void calcula_aabb_mundo(const glm::mat4& modelo, glm::vec4 bbox_minimo_local, glm::vec4 bbox_maximo_local, glm::vec4& bbox_minimo, glm::vec4& bbox_maximo);
 
-/* Função com teste de colisão ponto-cubo, responsável por impedir que uma bala seja desenhada, caso atinja um objeto do cenário.*/
-void destroi_balas(Bala vetor_balas[], ObjetoCenario vetor_objetos[]);
+/* Constrói a grade dos objetos estáticos do cenário, uma única vez, a partir das suas bounding boxes. */
+void constroi_grade_objetos(GradeColisao& grade, ObjetoCenario vetor_objetos[], int quantidade_objetos = QUANTIDADE_OBJETOS);
 
-/* Função com teste de colisão ponto-esfera, responsável por verificar se uma esfera do cenário deve ser destruída.*/
-void destroi_esferas(Bala vetor_balas[], Esfera vetor_esferas[]);
+/* Atualiza incrementalmente a grade dos alvos, que se movem a cada quadro. Alvos já destruídos são retirados da grade. */
+void atualiza_grade_alvos(GradeColisao& grade, Alvo vetor_alvos[], int quantidade_alvos = QUANTIDADE_ALVOS);
+
+/* Atualiza incrementalmente a grade das esferas, usando o cubo que envolve cada esfera. */
+void atualiza_grade_esferas(GradeColisao& grade, Esfera vetor_esferas[], int quantidade_esferas = QUANTIDADE_ESFERAS);
+
+
+
+/* Os testes abaixo varrem o segmento percorrido por cada bala no último deslocamento (de x_anterior até x).
+As balas são processadas em lotes de LARGURA_LOTE_BALAS: cada objeto das células da grade cobertas pelos
+segmentos do lote é comparado com as 8 balas de uma vez por testa_lote_balas_aabb(), e só as balas aprovadas
+passam pelo teste exato. Devem ser chamados
+nesta ordem: destroi_balas() recua as balas que atingem o cenário até o ponto de impacto, de forma que os alvos
+e esferas atrás de um objeto do cenário não sejam atingidos. */
+
+/* Função com teste de colisão segmento-cubo, responsável por impedir que um alvo seja desenhado, caso seja acertado por uma bala. */
+void destroi_alvos(Balas& balas, Alvo vetor_alvos[], GradeColisao& grade_alvos);
+
+/* Função com teste de colisão segmento-cubo, responsável por impedir que uma bala seja desenhada, caso atinja um objeto do cenário.*/
+void destroi_balas(Balas& balas, ObjetoCenario vetor_objetos[], const GradeColisao& grade_objetos);
+
+/* Função com teste de colisão segmento-esfera, responsável por verificar se uma esfera do cenário deve ser destruída.*/
+void destroi_esferas(Balas& balas, Esfera vetor_esferas[], GradeColisao& grade_esferas);
 
 /* Função com teste de colisão cubo-plano para um plano em que X é constante (como não se usa o valor y de posição, o teste na verdade é de quadrado-plano */
 /* Foram separadas em 2 funções para X e Z, para que o jogador pudesse "deslizar" no outro sentido caso desse colisão com 1 das paredes */
@@ -91,3 +201,5 @@ bool limita_jogador_plano_x(glm::vec4 bbox_jogador_max, glm::vec4 bbox_jogador_m
 /* Função com teste de colisão cubo-plano para um plano em que Z é constante (como não se usa o valor y de posição, o teste na verdade é de quadrado-plano) */
 /* Como as funções são separadas entre X e Z, cada função é uma função de colisão linha-plano*/
 bool limita_jogador_plano_z(glm::vec4 bbox_jogador_max, glm::vec4 bbox_jogador_min, float z);
+
+#endif // _COLLISIONS_H
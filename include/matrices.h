@@ -9,8 +9,10 @@
 #include <cstdio>
 #include <cstdlib>
 
+#include <glm/mat3x3.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
+#include <glm/matrix.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 // Esta função Matrix() auxilia na criação de matrizes usando a biblioteca GLM.
@@ -364,6 +366,15 @@ glm::mat4 Matrix_Perspective(float field_of_view, float aspect, float n, float f
     return -M*P;
 }
 
+// Matriz que transforma as normais de um objeto com matriz de modelagem M:
+// a inversa da transposta da parte 3x3 de M (a translação não afeta vetores).
+// Veja slides 123-151 do documento Aula_07_Transformacoes_Geometricas_3D.pdf.
+// É calculada uma vez por objeto desenhado, e não uma vez por vértice no shader.
+glm::mat3 Matrix_Normal(glm::mat4 M)
+{
+    return glm::transpose(glm::inverse(glm::mat3(M)));
+}
+
 // Função que imprime uma matriz M no terminal
 void PrintMatrix(glm::mat4 M)
 {
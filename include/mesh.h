@@ -0,0 +1,217 @@
+#ifndef _MESH_H
+#define _MESH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include <tiny_obj_loader.h>
+
+// Estrutura que representa um modelo geométrico carregado a partir de um
+// arquivo ".obj". Veja https://en.wikipedia.org/wiki/Wavefront_.obj_file .
+struct ObjModel
+{
+    tinyobj::attrib_t                 attrib;
+    std::vector<tinyobj::shape_t>     shapes;
+    std::vector<tinyobj::material_t>  materials;
+
+    // Este construtor lê o modelo de um arquivo utilizando a biblioteca tinyobjloader.
+    // Veja: https://github.com/syoyo/tinyobjloader
+    // Em caso de erro, lança std::runtime_error com a descrição do erro. Com
+    // "verbose", imprime o progresso e o nome de cada objeto no terminal.
+    ObjModel(const char* filename, const char* basepath = NULL, bool triangulate = true, bool verbose = true);
+};
+
+// Computa normais de um ObjModel, caso não existam.
+void ComputeNormals(ObjModel* model);
+
+// Um objeto (shape) de uma malha: intervalo dos seus índices dentro de
+// MeshData::indices, número de vértices distintos referenciados por eles e a
+// sua axis-aligned bounding box. Os níveis de detalhe de um objeto (veja
+// GenerateMeshLODs()) vêm logo depois dele, em ordem crescente de lod_level.
+struct MeshShape
+{
+    std::string  name;
+    size_t       first_index;
+    size_t       num_indices;
+    size_t       num_vertices; // Sem a soldagem de BuildMeshData(), seria igual a num_indices. 0 nos níveis gerados, que usam os vértices do original
+    glm::vec3    bbox_min;
+    glm::vec3    bbox_max;
+    int          lod_level = 0;    // 0 no objeto original; n no n-ésimo nível de detalhe
+    float        lod_error = 0.0f; // Distância máxima, nas coordenadas do modelo, entre o nível e o original
+};
+
+// Vetores de atributos e de índices de um arquivo OBJ, prontos para serem
+// enviados para os VBOs por BuildTrianglesAndAddToVirtualScene() (main.cpp).
+// Os ponteiros apontam ou para a memória de um MeshData (veja BuildMeshData())
+// ou diretamente para o arquivo de cache mapeado em memória (veja LoadMesh()).
+struct MeshArrays
+{
+    const float*    model_coefficients;   // vec4 por vértice
+    size_t          num_model_coefficients;
+    const float*    normal_coefficients;  // vec4 por vértice, ou nenhum
+    size_t          num_normal_coefficients;
+    const float*    texture_coefficients; // vec2 por vértice, ou nenhum
+    size_t          num_texture_coefficients;
+    const uint32_t* indices;
+    size_t          num_indices;
+
+    std::vector<MeshShape> shapes;
+};
+
+// Malha construída a partir de um ObjModel, dona dos seus vetores.
+struct MeshData
+{
+    std::vector<float>    model_coefficients;
+    std::vector<float>    normal_coefficients;
+    std::vector<float>    texture_coefficients;
+    std::vector<uint32_t> indices;
+    std::vector<MeshShape> shapes;
+};
+
+void BuildMeshData(ObjModel* model, MeshData& mesh); // Constrói os vetores de atributos e índices de um ObjModel
+MeshArrays GetMeshArrays(const MeshData& mesh);       // Aponta um MeshArrays para os vetores de um MeshData
+void PrintMeshVertexReport(const char* filename, const MeshArrays& mesh, size_t vertex_stride); // Imprime o número de vértices de cada objeto, antes e depois da soldagem, e o tamanho dos VBOs (vertex_stride: PackedVertices::stride)
+
+// Otimização da ordem dos triângulos e dos vértices de um MeshData construído
+// por BuildMeshData(). Para cada objeto: os triângulos são reordenados para
+// aproveitar a cache de vértices transformados da GPU (Tipsify), os grupos de
+// triângulos resultantes são ordenados de fora para dentro para reduzir o
+// overdraw, e os vértices são renumerados na ordem do primeiro uso. A malha
+// desenhada é a mesma; somente as ordens mudam.
+#define MESH_VERTEX_CACHE_SIZE  16    // Tamanho da cache FIFO de vértices simulada
+#define MESH_OVERDRAW_THRESHOLD 1.05f // Aumento de ACMR aceito para dividir os triângulos em grupos
+
+void OptimizeMeshData(MeshData& mesh);
+
+// Níveis de detalhe (LODs). Objetos com pelo menos MESH_LOD_MIN_TRIANGLES
+// triângulos recebem até MESH_MAX_LODS versões simplificadas por colapsos de
+// arestas guiados por quádricas de erro, cada uma com MESH_LOD_RATIO vezes os
+// triângulos da anterior. Os níveis gerados são novos objetos "X_LOD1",
+// "X_LOD2", ..., incluídos logo depois de "X", cujos índices referenciam os
+// vértices de "X". Objetos que já têm níveis feitos à mão no OBJ ("X_LOD0",
+// "X_LOD1", ...) não são simplificados; os seus níveis são somente marcados e
+// o seu erro é medido. Deve ser chamada depois de OptimizeMeshData().
+#define MESH_LOD_MIN_TRIANGLES 1000
+#define MESH_MAX_LODS          3
+#define MESH_LOD_RATIO         0.5
+#define MESH_LOD_BORDER_WEIGHT 10.0 // Peso dos planos que preservam as bordas abertas
+
+void GenerateMeshLODs(MeshData& mesh);
+void PrintMeshLODReport(const char* filename, const MeshArrays& mesh); // Triângulos e erro de cada nível de detalhe
+
+// Estatísticas da cache de vértices para uma sequência de triângulos: ACMR
+// (average cache miss ratio) é o número de vértices transformados por
+// triângulo, e ATVR (average transform to vertex ratio) é o número de vezes
+// que cada vértice distinto é transformado. O ideal é ATVR = 1.
+struct VertexCacheStatistics
+{
+    size_t num_triangles = 0;
+    size_t num_vertices = 0;
+    size_t cache_misses = 0;
+    float  acmr = 0.0f;
+    float  atvr = 0.0f;
+};
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t num_indices, unsigned int cache_size = MESH_VERTEX_CACHE_SIZE);
+void PrintVertexCacheReport(const char* filename, const MeshArrays& before, const MeshArrays& after); // ACMR e ATVR de cada objeto
+
+// Formatos de vértice dos VBOs. Os atributos de cada vértice são intercalados
+// em um único buffer (posição, normal e coordenadas de textura, nesta ordem),
+// e o formato de cada um é escolhido por malha com a combinação dos bits
+// abaixo. Com VERTEX_FORMAT_FLOAT um vértice ocupa 32 bytes, contra os 40 dos
+// três VBOs separados com vec4 usados antes; com VERTEX_FORMAT_DEFAULT, 24
+// bytes; acrescentando VERTEX_HALF_POSITIONS, 20 bytes.
+#define VERTEX_PACKED_NORMALS    1 // Normais em inteiros de 16 bits normalizados ([-1,1])
+#define VERTEX_PACKED_TEXCOORDS  2 // Coordenadas de textura em inteiros de 16 bits normalizados ([0,1]), se couberem
+#define VERTEX_HALF_POSITIONS    4 // Posições em half float: somente para objetos pequenos, perto da origem
+
+#define VERTEX_FORMAT_FLOAT   0
+#define VERTEX_FORMAT_DEFAULT (VERTEX_PACKED_NORMALS | VERTEX_PACKED_TEXCOORDS)
+
+// Tipos dos componentes de um atributo, traduzidos para os tipos da OpenGL
+// em AddMeshToVirtualScene() (main.cpp).
+#define VERTEX_ATTRIBUTE_FLOAT   0
+#define VERTEX_ATTRIBUTE_HALF    1
+#define VERTEX_ATTRIBUTE_SNORM16 2
+#define VERTEX_ATTRIBUTE_UNORM16 3
+
+struct VertexAttribute
+{
+    int     type = VERTEX_ATTRIBUTE_FLOAT;
+    int     components = 0; // 0: atributo ausente
+    size_t  offset = 0;     // Em bytes, a partir do início do vértice
+};
+
+// Vértices intercalados de uma malha, prontos para um único glBufferData().
+struct PackedVertices
+{
+    unsigned int    format = VERTEX_FORMAT_FLOAT; // Bits efetivamente usados
+    size_t          stride = 0;                   // Bytes por vértice
+    size_t          num_vertices = 0;
+    VertexAttribute position;
+    VertexAttribute normal;
+    VertexAttribute texcoords;
+    std::vector<unsigned char> data;
+};
+
+// Intercala e compacta os vetores de uma malha no formato pedido. Bits que não
+// se aplicam à malha (por exemplo, VERTEX_PACKED_TEXCOORDS com coordenadas de
+// textura fora de [0,1]) são ignorados; veja PackedVertices::format.
+void PackVertices(const MeshArrays& mesh, unsigned int format, PackedVertices& vertices);
+
+// Arquivo mapeado em memória (somente leitura).
+struct MappedFile
+{
+    const unsigned char* data = NULL;
+    size_t               size = 0;
+#ifdef _WIN32
+    void*                file_handle = NULL;
+    void*                mapping_handle = NULL;
+#endif
+};
+
+bool MapFile(const char* filename, MappedFile& file);
+void UnmapFile(MappedFile& file);
+
+// Grava "header" seguido de "data" no arquivo "filename", substituindo-o. Os
+// bytes vão para um arquivo temporário, renomeado ao final, para que uma
+// execução interrompida nunca deixe um arquivo truncado no lugar do válido.
+bool WriteFileReplacing(const char* filename, const void* header, size_t header_size, const void* data, size_t data_size);
+
+double Now(); // Segundos de um relógio monotônico, para medir tempos
+
+// Cache binário das malhas. Ao lado de cada arquivo "X.obj" é gravado um
+// arquivo "X.obj.meshcache" com os vetores finais de MeshData e os metadados
+// de cada objeto, identificado pelo hash (FNV-1a de 64 bits) do conteúdo do
+// OBJ e pela versão do formato. Nas execuções seguintes, o cache é mapeado em
+// memória e os vetores são enviados diretamente para a GPU, sem passar pela
+// tinyobjloader nem por ComputeNormals(). Qualquer alteração na forma como
+// as malhas são construídas deve incrementar MESH_CACHE_VERSION.
+#define MESH_CACHE_VERSION 4
+
+uint64_t HashBytes(const unsigned char* data, size_t size);
+bool SaveMeshCache(const char* cache_filename, uint64_t source_hash, const MeshData& mesh);
+bool OpenMeshCache(const char* cache_filename, uint64_t source_hash, MappedFile& file, MeshArrays& arrays);
+
+// Carrega a malha do arquivo OBJ "filename", usando o cache quando ele é
+// válido e gravando-o quando não é. Os vetores apontados por "arrays" ficam
+// válidos até UnloadMesh(). Os tempos, em segundos, são devolvidos em
+// "load_time"; "from_cache" indica qual dos caminhos foi usado. Como é
+// executada pelas threads do AssetLoader, não imprime o progresso e, em caso
+// de erro, lança std::runtime_error em vez de encerrar o programa.
+struct LoadedMesh
+{
+    MeshArrays  arrays;
+    MeshData    data;  // Vazio quando a malha veio do cache
+    MappedFile  cache; // Vazio quando a malha veio do OBJ
+    bool        from_cache = false;
+    double      load_time = 0.0;
+};
+
+void LoadMesh(const char* filename, LoadedMesh& mesh);
+void UnloadMesh(LoadedMesh& mesh);
+
+#endif // _MESH_H
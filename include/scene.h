@@ -0,0 +1,43 @@
+#ifndef _SCENE_H
+#define _SCENE_H
+
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include "collisions.h"
+
+/* Modelos usados pela cena estática. O nome de cada um (NOME_MODELOS_CENARIO) é o nome do
+objeto dentro do arquivo OBJ correspondente (ARQUIVO_MODELOS_CENARIO). */
+#define MODELO_CAIXA 0
+#define MODELO_BARREIRA 1
+#define MODELO_PALETE 2
+#define QUANTIDADE_MODELOS_CENARIO 3
+
+extern const char* const NOME_MODELOS_CENARIO[QUANTIDADE_MODELOS_CENARIO];
+extern const char* const ARQUIVO_MODELOS_CENARIO[QUANTIDADE_MODELOS_CENARIO];
+
+/* Objeto da cena estática: modelo (MODELO_*) e matriz de modelagem. Se o objeto participa
+dos testes de colisão das balas, indice_colisao é a sua posição em vetor_objetos; caso
+contrário, é -1. */
+typedef struct
+{
+    int modelo;
+    glm::mat4 model;
+    int indice_colisao;
+
+} ItemEstatico;
+
+/* Disposição das caixas, barreiras e paletes, que nunca se movem. Não faz nenhuma chamada
+OpenGL, para que possa ser usada também pela simulação sem janela (headless.cpp). */
+void monta_cena_estatica(std::vector<ItemEstatico>& itens);
+
+/* Estágio de transformação e limites: calcula as bounding boxes dos objetos do cenário, em
+coordenadas do mundo, a partir da bounding box local de cada modelo e da matriz de modelagem
+de cada item. */
+void calcula_bboxes_cenario(const std::vector<ItemEstatico>& itens,
+                            const glm::vec4 bbox_minimo_modelos[], const glm::vec4 bbox_maximo_modelos[],
+                            ObjetoCenario vetor_objetos[]);
+
+#endif // _SCENE_H
@@ -0,0 +1,154 @@
+#ifndef _SIMULATION_H
+#define _SIMULATION_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include "collisions.h"
+
+/* A simulação do jogo (alvos, esferas, balas e movimento do jogador) avança em passos de
+duração fixa, independentemente da taxa de quadros. O tempo real decorrido entre dois quadros
+é acumulado e consumido em passos de PASSO_SIMULACAO segundos; a sobra do acumulador é usada
+para interpolar as posições desenhadas entre os dois últimos passos. Assim o custo da física
+por quadro é limitado e o resultado do jogo não depende da velocidade do computador. */
+#define FREQUENCIA_SIMULACAO 120
+#define PASSO_SIMULACAO (1.0/FREQUENCIA_SIMULACAO)
+
+/* Número máximo de passos executados em um único quadro. Se um quadro demorar mais do que isso
+(por exemplo, ao arrastar a janela), o tempo excedente é descartado e o jogo fica mais lento
+por um instante, em vez de tentar recuperar o atraso e travar de vez. */
+#define MAXIMO_PASSOS_POR_QUADRO 8
+
+#define VELOCIDADE_CAMERA 2.5
+#define ESPESSURA_JOGADOR 0.25
+#define LIMITE_ESQUERDA -15.0
+#define LIMITE_DIREITA 15.0
+#define LIMITE_FUNDO -15.0
+#define LIMITE_FRENTE 15.0
+#define LIMITE_CIMA 15.0
+#define LIMITE_BAIXO -15.0
+#define TEMPO_ALVO_BEZIER 2
+#define ALTURA_ESFERAS 5.0
+
+/* Entrada do jogador amostrada pelo laço principal e consumida pelos passos da simulação. */
+typedef struct
+{
+    bool frente = false;
+    bool tras = false;
+    bool direita = false;
+    bool esquerda = false;
+
+    /* Indica um disparo pendente. É consumido (e zerado) pelo primeiro passo executado. */
+    bool disparar = false;
+
+    glm::vec4 direcao_camera = glm::vec4(0.0f,0.0f,-1.0f,0.0f); /* Vetor "view" da câmera */
+    glm::vec4 vetor_u = glm::vec4(1.0f,0.0f,0.0f,0.0f);         /* Vetor "u" da câmera */
+    glm::vec4 vetor_w = glm::vec4(0.0f,0.0f,1.0f,0.0f);         /* Vetor "w" da câmera */
+
+} EntradaSimulacao;
+
+typedef struct
+{
+    Alvo alvos[QUANTIDADE_ALVOS];
+    Esfera esferas[QUANTIDADE_ESFERAS];
+    Balas balas;
+    ObjetoCenario objetos[QUANTIDADE_OBJETOS];
+
+    GradeColisao grade_objetos;
+    GradeColisao grade_alvos;
+    GradeColisao grade_esferas;
+
+    /* Indica se as bounding boxes do cenário já foram informadas (veja constroi_cenario_simulacao()). */
+    bool cenario_pronto = false;
+
+    /* Bounding box do modelo "Cube" usado pelos alvos, em coordenadas locais (SceneObject::bbox_min e bbox_max). */
+    glm::vec4 bbox_minimo_alvo = glm::vec4(-1.0f,-1.0f,-1.0f,0.0f);
+    glm::vec4 bbox_maximo_alvo = glm::vec4(1.0f,1.0f,1.0f,0.0f);
+
+    glm::vec4 posicao_jogador = glm::vec4(0.0f,0.55f,4.5f,1.0f);
+
+    /* Posições no início do último passo, usadas para interpolar o desenho. As balas
+    guardam a sua em Balas::x_anterior, y_anterior e z_anterior. */
+    glm::vec4 posicao_jogador_anterior = glm::vec4(0.0f,0.55f,4.5f,1.0f);
+    glm::vec4 posicao_alvos_anterior[QUANTIDADE_ALVOS];
+    glm::vec4 centro_esferas_anterior[QUANTIDADE_ESFERAS];
+
+    /* Parâmetro da curva de Bézier percorrida pelo alvo 0, que vai e volta a cada TEMPO_ALVO_BEZIER segundos. */
+    double tempo_bezier = 0.0;
+    bool bezier_ida = true;
+
+    double acumulador = 0.0;
+    long long passos = 0;
+    bool fim_jogo = false;
+
+} EstadoSimulacao;
+
+/* Posições interpoladas entre os dois últimos passos, prontas para serem desenhadas. */
+typedef struct
+{
+    glm::vec4 posicao_jogador;
+
+    glm::vec4 posicao_alvos[QUANTIDADE_ALVOS];
+    bool alvo_visivel[QUANTIDADE_ALVOS];
+
+    glm::vec4 centro_esferas[QUANTIDADE_ESFERAS];
+    bool esfera_visivel[QUANTIDADE_ESFERAS];
+
+    /* Somente as balas ativas, em sequência. */
+    std::vector<glm::vec4> posicao_balas;
+    std::vector<glm::vec4> eixo_rotacao_balas;
+    std::vector<float> angulo_rotacao_balas;
+
+    bool fim_jogo;
+
+} QuadroSimulacao;
+
+/* Simulação executada em uma thread auxiliar, em paralelo com o desenho. A cada quadro o laço
+principal entrega a entrada e o tempo decorrido com solicita_passos_simulacao() e desenha o quadro
+publicado anteriormente, que não é mais alterado; a thread auxiliar avança o estado e escreve o
+próximo quadro no outro buffer. aguarda_passos_simulacao() espera o fim dos passos e troca os buffers.
+O estado só pode ser acessado pelo laço principal entre aguarda_passos_simulacao() e a próxima
+solicitação. */
+typedef struct
+{
+    EstadoSimulacao estado;
+
+    QuadroSimulacao quadros[2];
+    int quadro_leitura = 0; /* Quadro desenhado pelo laço principal; a thread auxiliar escreve no outro. */
+
+    EntradaSimulacao entrada;
+    double tempo_decorrido = 0.0;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable condicao;
+    bool trabalho_pendente = false;
+    bool encerrar = false;
+
+    /* Duração, em segundos, da última chamada de avanca_simulacao() feita pela thread auxiliar. */
+    double duracao_passos = 0.0;
+
+} SimulacaoParalela;
+
+/* Matriz de modelagem do alvo de índice "indice" na posição dada. É usada tanto para desenhar
+o alvo quanto para calcular a sua bounding box, de modo que as duas nunca divergem. */
+glm::mat4 modelo_alvo(int indice, glm::vec4 posicao);
+
+void inicializa_simulacao(EstadoSimulacao& estado, glm::vec4 posicao_jogador);
+void constroi_cenario_simulacao(EstadoSimulacao& estado, const ObjetoCenario vetor_objetos[]);
+void passo_simulacao(EstadoSimulacao& estado, EntradaSimulacao& entrada, double passo);
+float avanca_simulacao(EstadoSimulacao& estado, EntradaSimulacao& entrada, double tempo_decorrido);
+void extrai_quadro_simulacao(const EstadoSimulacao& estado, float alfa, QuadroSimulacao& quadro);
+
+void inicia_simulacao_paralela(SimulacaoParalela& simulacao);
+void solicita_passos_simulacao(SimulacaoParalela& simulacao, const EntradaSimulacao& entrada, double tempo_decorrido);
+void aguarda_passos_simulacao(SimulacaoParalela& simulacao);
+void encerra_simulacao_paralela(SimulacaoParalela& simulacao);
+const QuadroSimulacao& quadro_simulacao(const SimulacaoParalela& simulacao);
+
+#endif // _SIMULATION_H
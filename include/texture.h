@@ -0,0 +1,113 @@
+#ifndef _TEXTURE_H
+#define _TEXTURE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "mesh.h"
+
+// Imagem decodificada pela stb_image, com três canais (RGB) de 8 bits, na
+// ordem das linhas do arquivo (a primeira linha em cima). A inversão para a
+// ordem da OpenGL é feita por ExpandImageRGBA().
+struct LoadedImage
+{
+    int            width = 0;
+    int            height = 0;
+    unsigned char* data = NULL;
+};
+
+void DecodeImage(const char* filename, LoadedImage& image); // Lê e decodifica uma imagem (sem OpenGL); lança std::runtime_error em caso de erro
+void FreeDecodedImage(LoadedImage& image);
+void ResizeImage(LoadedImage& image, int width, int height); // Reamostra uma imagem decodificada (reduções à metade e filtro bilinear)
+
+// Preparação das imagens para a GPU, executada pelas threads do AssetLoader
+// entre a decodificação e a compressão: a imagem RGB é expandida para RGBA
+// (4 bytes por pixel, um vetor SSE de 16 bytes a cada 4 pixels) e invertida
+// verticalmente em uma única passada, e cada nível de mipmap é a média de
+// cada bloco 2x2 do anterior, calculada em espaço de cor linear (a média de
+// valores sRGB escurece as texturas nos níveis menores). As duas funções
+// têm uma versão SSE2, disponível em todas as CPUs x86-64, e uma versão
+// escalar com exatamente o mesmo resultado; "simd" escolhe entre elas
+// (veja benchmark_texturas.cpp).
+#if defined(__SSE2__) || defined(_M_X64)
+#define TEXTURE_SIMD true
+#else
+#define TEXTURE_SIMD false
+#endif
+
+void ExpandImageRGBA(const LoadedImage& image, bool flip, unsigned char* rgba, bool simd = TEXTURE_SIMD);
+void DownsampleImageSRGB(const unsigned char* rgba, int width, int height,
+                         unsigned char* target, int target_width, int target_height, bool simd = TEXTURE_SIMD);
+
+// Formatos das texturas enviadas para a GPU. Em BC1 (também chamado de DXT1 ou
+// S3TC) cada bloco de 4x4 pixels é guardado em 8 bytes: duas cores RGB 5:6:5 e
+// um índice de 2 bits por pixel, que escolhe uma das duas cores ou uma de duas
+// interpolações entre elas. São 0.5 byte por pixel, contra os 3 de RGB8, e a
+// GPU lê os blocos diretamente, sem descomprimir a textura na memória.
+#define TEXTURE_FORMAT_RGB8 0 // GL_SRGB8, enviada em RGBA (4 bytes por pixel, como a GPU a guarda)
+#define TEXTURE_FORMAT_BC1  1 // GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+
+// Um nível de mipmap, dentro de TextureData::data.
+struct TextureLevel
+{
+    int     width;
+    int     height;
+    size_t  offset; // Em bytes, a partir de TextureData::data
+    size_t  size;   // Em bytes
+};
+
+// Textura pronta para ser enviada para a GPU: todos os níveis de mipmap, do
+// maior (nível 0) para 1x1, um depois do outro. Os dados apontados por "data"
+// ficam ou em "pixels" ou diretamente no arquivo de cache mapeado em memória
+// (veja LoadTexture()).
+struct TextureData
+{
+    int                        format = TEXTURE_FORMAT_RGB8;
+    std::vector<TextureLevel>  levels;
+    const unsigned char*       data = NULL;
+    size_t                     size = 0;   // Soma dos tamanhos dos níveis
+    std::vector<unsigned char> pixels;     // Vazio quando a textura veio do cache
+    MappedFile                 cache;      // Vazio quando a textura veio da imagem
+    bool                       from_cache = false;
+    double                     load_time = 0.0;
+};
+
+size_t TextureLevelSize(int format, int width, int height); // Bytes de um nível de "width" x "height" pixels
+
+// Gera todos os níveis de mipmap de uma imagem RGBA (veja ExpandImageRGBA())
+// com DownsampleImageSRGB() e os converte para o formato pedido.
+void BuildTextureMipmaps(const unsigned char* rgba, int width, int height, int format, TextureData& texture);
+
+// Comprime uma imagem RGBA de 8 bits para BC1 (o canal alfa é ignorado), um
+// bloco por vez. Blocos que ultrapassam a borda da imagem repetem a última
+// linha e a última coluna.
+void CompressBC1(const unsigned char* rgba, int width, int height, unsigned char* blocks);
+
+// Descomprime uma imagem BC1 para RGBA de 8 bits (usada para medir o erro da compressão).
+void DecompressBC1(const unsigned char* blocks, int width, int height, unsigned char* rgba);
+
+// Cache das texturas comprimidas. Comprimir as imagens é bem mais lento que
+// decodificá-las, por isso o resultado é gravado ao lado de cada imagem
+// "X.jpg", no arquivo "X.jpg.texcache", com todos os níveis de mipmap. Ele é
+// identificado pelo hash do conteúdo da imagem (veja HashBytes() em mesh.h),
+// pelo formato, pelo tamanho e pela versão; nas execuções seguintes o cache é
+// mapeado em memória e os níveis são enviados diretamente com
+// glCompressedTexSubImage3D(), sem passar pela stb_image. Os caches podem ser
+// gerados antes da primeira execução do jogo com "make comprime_texturas".
+// Qualquer alteração na forma como as texturas são construídas deve
+// incrementar TEXTURE_CACHE_VERSION.
+#define TEXTURE_CACHE_VERSION 2
+
+bool SaveTextureCache(const char* cache_filename, uint64_t source_hash, const TextureData& texture);
+bool OpenTextureCache(const char* cache_filename, uint64_t source_hash, int format, int size, TextureData& texture); // size == 0: qualquer tamanho
+
+// Carrega a imagem "filename" com size x size pixels (ou com o seu tamanho
+// original, se size == 0) no formato pedido. Texturas BC1 vêm do cache quando
+// ele é válido; quando não é, a imagem é decodificada, comprimida e o cache é
+// gravado. Texturas RGB8 são sempre decodificadas e não usam cache. Como é
+// executada pelas threads do AssetLoader, lança std::runtime_error em caso de
+// erro em vez de encerrar o programa.
+void LoadTexture(const char* filename, int size, int format, TextureData& texture);
+void UnloadTexture(TextureData& texture);
+
+#endif // _TEXTURE_H
@@ -0,0 +1,177 @@
+#include "assets.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <exception>
+
+void AddImageJob(AssetLoader& loader, const char* filename, int texture_index, int image_size, int texture_format)
+{
+    loader.jobs.push_back(AssetJob());
+    AssetJob& job = loader.jobs.back();
+    job.kind = ASSET_IMAGE;
+    job.filename = filename;
+    job.texture_index = texture_index;
+    job.image_size = image_size;
+    job.texture_format = texture_format;
+    job.vertex_format = VERTEX_FORMAT_FLOAT;
+}
+
+void AddMeshJob(AssetLoader& loader, const char* filename, unsigned int vertex_format)
+{
+    loader.jobs.push_back(AssetJob());
+    AssetJob& job = loader.jobs.back();
+    job.kind = ASSET_MESH;
+    job.filename = filename;
+    job.texture_index = -1;
+    job.image_size = 0;
+    job.texture_format = TEXTURE_FORMAT_RGB8;
+    job.vertex_format = vertex_format;
+}
+
+static void RunAssetJob(AssetJob& job)
+{
+    double start = Now();
+
+    // Os erros não encerram o programa aqui: std::exit() destruiria as
+    // variáveis globais enquanto as outras threads ainda as usam. Eles são
+    // guardados no trabalho e tratados pela thread que recebe os arquivos.
+    try
+    {
+        if (job.kind == ASSET_IMAGE)
+            LoadTexture(job.filename.c_str(), job.image_size, job.texture_format, job.texture);
+        else
+        {
+            LoadMesh(job.filename.c_str(), job.mesh);
+            PackVertices(job.mesh.arrays, job.vertex_format, job.vertices);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        job.error = e.what();
+    }
+    job.load_time = Now() - start;
+}
+
+static void AssetLoaderThread(AssetLoader* loader)
+{
+    for (;;)
+    {
+        size_t job;
+        {
+            std::lock_guard<std::mutex> lock(loader->mutex);
+            if (loader->next_job == loader->order.size())
+                return;
+            job = loader->order[loader->next_job++];
+        }
+
+        RunAssetJob(loader->jobs[job]);
+
+        {
+            std::lock_guard<std::mutex> lock(loader->mutex);
+            loader->finished.push_back(job);
+        }
+        loader->condition.notify_one();
+    }
+}
+
+static long FileSize(const char* filename)
+{
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL)
+        return 0;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+void StartAssetLoader(AssetLoader& loader, unsigned int num_threads)
+{
+    loader.start_time = Now();
+
+    // Os arquivos maiores começam primeiro, para que o mais lento não fique
+    // para o final, sozinho, enquanto as outras threads já terminaram.
+    std::vector<long> sizes(loader.jobs.size());
+    loader.order.resize(loader.jobs.size());
+    for (size_t i = 0; i < loader.jobs.size(); ++i)
+    {
+        sizes[i] = FileSize(loader.jobs[i].filename.c_str());
+        loader.order[i] = i;
+    }
+    std::stable_sort(loader.order.begin(), loader.order.end(),
+                     [&sizes](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    num_threads = std::min(num_threads, (unsigned int)std::max((size_t)1, loader.jobs.size()));
+
+    loader.num_threads = num_threads;
+    for (unsigned int i = 0; i < num_threads; ++i)
+        loader.threads.push_back(std::thread(AssetLoaderThread, &loader));
+}
+
+AssetJob* WaitFinishedAsset(AssetLoader& loader)
+{
+    if (loader.delivered == loader.jobs.size())
+        return NULL;
+
+    std::unique_lock<std::mutex> lock(loader.mutex);
+    loader.condition.wait(lock, [&loader] { return !loader.finished.empty(); });
+
+    size_t job = loader.finished.back();
+    loader.finished.pop_back();
+    loader.delivered += 1;
+    return &loader.jobs[job];
+}
+
+void StopAssetLoader(AssetLoader& loader)
+{
+    {
+        std::lock_guard<std::mutex> lock(loader.mutex);
+        loader.next_job = loader.order.size();
+    }
+    for (size_t i = 0; i < loader.threads.size(); ++i)
+        loader.threads[i].join();
+    loader.threads.clear();
+
+    for (size_t i = 0; i < loader.jobs.size(); ++i)
+    {
+        UnloadTexture(loader.jobs[i].texture);
+        UnloadMesh(loader.jobs[i].mesh);
+        loader.jobs[i].vertices = PackedVertices();
+    }
+}
+
+void PrintAssetLoadingReport(const AssetLoader& loader, double upload_time)
+{
+    double total_time = Now() - loader.start_time;
+    double sum_time = 0.0;
+    size_t slowest = 0;
+    int from_cache = 0;
+    int num_meshes = 0;
+    int textures_from_cache = 0;
+
+    for (size_t i = 0; i < loader.jobs.size(); ++i)
+    {
+        const AssetJob& job = loader.jobs[i];
+        sum_time += job.load_time;
+        if (job.load_time > loader.jobs[slowest].load_time)
+            slowest = i;
+        if (job.kind == ASSET_MESH)
+        {
+            num_meshes += 1;
+            if (job.mesh.from_cache)
+                from_cache += 1;
+        }
+        else if (job.texture.from_cache)
+            textures_from_cache += 1;
+    }
+
+    printf("Carregamento: %d imagens (%d do cache) e %d malhas (%d do cache) com %d threads em %.1f ms "
+           "(soma dos arquivos: %.1f ms; mais lento: \"%s\", %.1f ms; envio para a GPU: %.1f ms).\n",
+           (int)loader.jobs.size() - num_meshes, textures_from_cache, num_meshes, from_cache, (int)loader.num_threads,
+           1000.0*total_time, 1000.0*sum_time,
+           loader.jobs.empty() ? "" : loader.jobs[slowest].filename.c_str(),
+           loader.jobs.empty() ? 0.0 : 1000.0*loader.jobs[slowest].load_time, 1000.0*upload_time);
+}
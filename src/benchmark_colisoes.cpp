@@ -0,0 +1,276 @@
+// Benchmark dos testes de colisão bala-cenário, bala-alvo e bala-esfera.
+//
+// Compara o teste exaustivo (cada bala contra todos os objetos, como era feito
+// antes da grade uniforme) com a fase ampla por grade de collisions.cpp, para
+// 50, 5 mil e 500 mil balas. Cada bala varre o segmento do seu último
+// deslocamento. Os dois métodos devem encontrar exatamente as mesmas colisões;
+// o programa confere isso antes de imprimir os tempos.
+//
+// As balas ficam em estrutura de arrays (Balas) e a fase estreita testa lotes de
+// LARGURA_LOTE_BALAS balas por vez com SSE2 ou AVX2, conforme a compilação.
+//
+// Uso: make benchmark
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+
+#include <glm/geometric.hpp>
+
+#include "collisions.h"
+
+/* Gerador congruencial simples, para que todas as execuções usem o mesmo cenário. */
+static unsigned int semente = 12345u;
+
+static float aleatorio(float minimo, float maximo)
+{
+    semente = semente*1664525u + 1013904223u;
+    return minimo + (maximo - minimo)*((semente >> 8)/16777216.0f);
+}
+
+static double agora()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+typedef struct
+{
+    const char* nome;
+    std::vector<ObjetoCenario> objetos;
+    std::vector<Alvo> alvos;
+    std::vector<Esfera> esferas;
+
+} Cenario;
+
+static Cenario gera_cenario(const char* nome, int quantidade_objetos, int quantidade_alvos, int quantidade_esferas)
+{
+    Cenario cenario;
+    cenario.nome = nome;
+
+    cenario.objetos.resize(quantidade_objetos);
+    for (int j = 0; j < quantidade_objetos; j++)
+    {
+        glm::vec4 centro = glm::vec4(aleatorio(-14.0f, 14.0f), aleatorio(0.0f, 2.0f), aleatorio(-14.0f, 14.0f), 0.0f);
+        glm::vec4 meia = glm::vec4(aleatorio(0.2f, 1.0f), aleatorio(0.2f, 1.0f), aleatorio(0.2f, 1.0f), 0.0f);
+        cenario.objetos[j].bbox_minimo = centro - meia;
+        cenario.objetos[j].bbox_maximo = centro + meia;
+    }
+
+    cenario.alvos.resize(quantidade_alvos);
+    for (int j = 0; j < quantidade_alvos; j++)
+    {
+        Alvo& alvo = cenario.alvos[j];
+        alvo.x = aleatorio(-10.0f, 10.0f);
+        alvo.y = 0.5f;
+        alvo.z = aleatorio(-14.0f, 14.0f);
+        alvo.bbox_minimo = glm::vec4(alvo.x - 0.4f, alvo.y - 0.5f, alvo.z - 0.1f, 0.0f);
+        alvo.bbox_maximo = glm::vec4(alvo.x + 0.4f, alvo.y + 0.5f, alvo.z + 0.1f + ESPESSURA_ALVOS, 0.0f);
+    }
+
+    cenario.esferas.resize(quantidade_esferas);
+    for (int j = 0; j < quantidade_esferas; j++)
+    {
+        cenario.esferas[j].centro_x = aleatorio(-10.0f, 10.0f);
+        cenario.esferas[j].centro_y = aleatorio(0.5f, 5.0f);
+        cenario.esferas[j].centro_z = aleatorio(-14.0f, 14.0f);
+    }
+
+    return cenario;
+}
+
+static Balas gera_balas(int quantidade)
+{
+    Balas balas;
+    inicializa_balas(balas, quantidade);
+    for (int i = 0; i < quantidade; i++)
+    {
+        balas.desenhar[i] = 1;
+        balas.x_anterior[i] = aleatorio(-15.0f, 15.0f);
+        balas.y_anterior[i] = aleatorio(0.0f, 6.0f);
+        balas.z_anterior[i] = aleatorio(-15.0f, 15.0f);
+
+        /* Deslocamento de um quadro para velocidades entre 1x e 10x VELOCIDADE_BALAS a 60 quadros por segundo. */
+        float passo = aleatorio(1.0f, 10.0f)*VELOCIDADE_BALAS/60.0f;
+        glm::vec3 direcao = glm::normalize(glm::vec3(aleatorio(-1.0f, 1.0f), aleatorio(-0.2f, 0.2f), aleatorio(-1.0f, 1.0f)));
+        balas.x[i] = balas.x_anterior[i] + passo*direcao.x;
+        balas.y[i] = balas.y_anterior[i] + passo*direcao.y;
+        balas.z[i] = balas.z_anterior[i] + passo*direcao.z;
+    }
+    return balas;
+}
+
+/* Versão exaustiva dos testes, com a mesma semântica das funções destroi_*: primeiro recua a bala até o
+objeto do cenário mais próximo, depois procura o primeiro alvo e a primeira esfera ao longo do segmento. */
+static void forca_bruta(Balas& balas, Cenario& cenario)
+{
+    for (int i = 0; i < balas.quantidade; i++)
+    {
+        glm::vec4 inicio = glm::vec4(balas.x_anterior[i], balas.y_anterior[i], balas.z_anterior[i], 1.0f);
+        glm::vec4 fim = glm::vec4(balas.x[i], balas.y[i], balas.z[i], 1.0f);
+        float t_impacto = 2.0f;
+        for (size_t j = 0; j < cenario.objetos.size(); j++)
+        {
+            float t;
+            if (intersecta_segmento_aabb(inicio, fim, cenario.objetos[j].bbox_minimo, cenario.objetos[j].bbox_maximo, t) && t < t_impacto)
+                t_impacto = t;
+        }
+        if (t_impacto <= 1.0f)
+        {
+            glm::vec4 impacto = inicio + t_impacto*(fim - inicio);
+            balas.x[i] = impacto.x;
+            balas.y[i] = impacto.y;
+            balas.z[i] = impacto.z;
+            balas.atingiu_cenario[i] = 1;
+        }
+    }
+
+    for (int i = 0; i < balas.quantidade; i++)
+    {
+        glm::vec4 inicio = glm::vec4(balas.x_anterior[i], balas.y_anterior[i], balas.z_anterior[i], 1.0f);
+        glm::vec4 fim = glm::vec4(balas.x[i], balas.y[i], balas.z[i], 1.0f);
+        int atingido = -1;
+        float t_atingido = 2.0f;
+        for (size_t j = 0; j < cenario.alvos.size(); j++)
+        {
+            glm::vec4 frente_minimo = cenario.alvos[j].bbox_minimo;
+            frente_minimo.z = cenario.alvos[j].bbox_maximo.z-ESPESSURA_ALVOS;
+            float t;
+            if (cenario.alvos[j].dano < MAXIMO_DANO &&
+                intersecta_segmento_aabb(inicio, fim, frente_minimo, cenario.alvos[j].bbox_maximo, t) && t < t_atingido)
+            {
+                atingido = (int)j;
+                t_atingido = t;
+            }
+        }
+        if (atingido >= 0)
+        {
+            cenario.alvos[atingido].dano += 1;
+            balas.desenhar[i] = 0;
+        }
+    }
+
+    for (int i = 0; i < balas.quantidade; i++)
+    {
+        if (!balas.desenhar[i])
+            continue;
+        glm::vec4 inicio = glm::vec4(balas.x_anterior[i], balas.y_anterior[i], balas.z_anterior[i], 1.0f);
+        glm::vec4 fim = glm::vec4(balas.x[i], balas.y[i], balas.z[i], 1.0f);
+        int atingida = -1;
+        float t_atingida = 2.0f;
+        for (size_t j = 0; j < cenario.esferas.size(); j++)
+        {
+            glm::vec4 centro = glm::vec4(cenario.esferas[j].centro_x, cenario.esferas[j].centro_y, cenario.esferas[j].centro_z, 1.0f);
+            float t;
+            if (cenario.esferas[j].dano < MAXIMO_DANO &&
+                intersecta_segmento_esfera(inicio, fim, centro, RAIO_ESFERAS, t) && t < t_atingida)
+            {
+                atingida = (int)j;
+                t_atingida = t;
+            }
+        }
+        if (atingida >= 0)
+        {
+            cenario.esferas[atingida].dano += 1;
+            balas.desenhar[i] = 0;
+        }
+    }
+}
+
+static void com_grade(Balas& balas, Cenario& cenario, GradeColisao& grade_objetos, GradeColisao& grade_alvos, GradeColisao& grade_esferas)
+{
+    destroi_balas(balas, cenario.objetos.data(), grade_objetos);
+    destroi_alvos(balas, cenario.alvos.data(), grade_alvos);
+    destroi_esferas(balas, cenario.esferas.data(), grade_esferas);
+}
+
+/* Confere se os dois métodos deixaram balas, alvos e esferas exatamente no mesmo estado. */
+static bool mesmos_resultados(const Balas& balas_a, const Cenario& cenario_a, const Balas& balas_b, const Cenario& cenario_b)
+{
+    if (balas_a.desenhar != balas_b.desenhar || balas_a.atingiu_cenario != balas_b.atingiu_cenario ||
+        balas_a.x != balas_b.x || balas_a.y != balas_b.y || balas_a.z != balas_b.z)
+        return false;
+
+    for (size_t j = 0; j < cenario_a.alvos.size(); j++)
+        if (cenario_a.alvos[j].dano != cenario_b.alvos[j].dano)
+            return false;
+
+    for (size_t j = 0; j < cenario_a.esferas.size(); j++)
+        if (cenario_a.esferas[j].dano != cenario_b.esferas[j].dano)
+            return false;
+
+    return true;
+}
+
+static void mede(const Cenario& original, int quantidade_balas)
+{
+    const Balas balas_originais = gera_balas(quantidade_balas);
+
+    GradeColisao grade_objetos;
+    Cenario copia = original;
+    constroi_grade_objetos(grade_objetos, copia.objetos.data(), (int)copia.objetos.size());
+
+    double tempo_forca_bruta = 0.0;
+    double tempo_grade = 0.0;
+    bool iguais = true;
+
+    /* Repetimos as medições pequenas até acumular um tempo mensurável. */
+    int repeticoes = 0;
+    while (repeticoes == 0 || (tempo_forca_bruta + tempo_grade < 0.2 && repeticoes < 10000))
+    {
+        repeticoes++;
+
+        Balas balas_referencia = balas_originais;
+        Cenario referencia = original;
+        double inicio = agora();
+        forca_bruta(balas_referencia, referencia);
+        tempo_forca_bruta += agora() - inicio;
+
+        Balas balas = balas_originais;
+        copia = original;
+        GradeColisao grade_alvos;
+        GradeColisao grade_esferas;
+        atualiza_grade_alvos(grade_alvos, copia.alvos.data(), (int)copia.alvos.size());
+        atualiza_grade_esferas(grade_esferas, copia.esferas.data(), (int)copia.esferas.size());
+        inicio = agora();
+        com_grade(balas, copia, grade_objetos, grade_alvos, grade_esferas);
+        tempo_grade += agora() - inicio;
+
+        iguais = iguais && mesmos_resultados(balas_referencia, referencia, balas, copia);
+    }
+
+    tempo_forca_bruta /= repeticoes;
+    tempo_grade /= repeticoes;
+
+    printf("%-10s %8d balas | exaustivo %10.3f ms | grade %10.3f ms | ganho %6.1fx%s\n",
+           original.nome, quantidade_balas, 1000.0*tempo_forca_bruta, 1000.0*tempo_grade,
+           tempo_forca_bruta/tempo_grade,
+           iguais ? "" : "  ** RESULTADOS DIFERENTES **");
+
+    if (!iguais)
+        std::exit(EXIT_FAILURE);
+}
+
+int main()
+{
+    const int quantidades[] = { 50, 5000, 500000 };
+
+#if defined(__AVX2__)
+    printf("Teste em lote: AVX2 (8 balas por instrucao)\n");
+#elif defined(__SSE2__)
+    printf("Teste em lote: SSE2 (4 balas por instrucao)\n");
+#else
+    printf("Teste em lote: escalar\n");
+#endif
+
+    Cenario jogo = gera_cenario("jogo", QUANTIDADE_OBJETOS, QUANTIDADE_ALVOS, QUANTIDADE_ESFERAS);
+    Cenario estresse = gera_cenario("estresse", 100*QUANTIDADE_OBJETOS, 100*QUANTIDADE_ALVOS, 100*QUANTIDADE_ESFERAS);
+
+    for (int k = 0; k < 3; k++)
+        mede(jogo, quantidades[k]);
+
+    for (int k = 0; k < 3; k++)
+        mede(estresse, quantidades[k]);
+
+    return 0;
+}
@@ -0,0 +1,261 @@
+// Benchmark do carregamento das malhas com e sem o cache binário de mesh.cpp.
+//
+// Para cada arquivo OBJ usado pelo jogo (e para o bunny.obj), apaga o cache,
+// mede o carregamento "frio" (tinyobjloader, ComputeNormals(), BuildMeshData()
+// e gravação do cache) e depois o carregamento a partir do cache (hash do OBJ,
+// mapeamento do cache em memória e validação). Nos dois casos os vetores são
+// copiados para um buffer, como glBufferData() faria, para que as páginas do
+// cache sejam de fato lidas. O programa confere que os dois caminhos produzem
+// exatamente os mesmos vetores antes de imprimir os tempos.
+//
+// Também imprime, para cada objeto, o número de vértices antes e depois da
+// soldagem de vértices iguais feita por BuildMeshData(), e, para cada formato
+// de vértice de PackVertices(), o tamanho dos VBOs e o maior erro introduzido
+// na posição, na normal e nas coordenadas de textura. Por fim, imprime o ACMR
+// e o ATVR de cada objeto antes e depois de OptimizeMeshData(), e o tempo
+// gasto pela otimização (incluído no tempo do carregamento "frio"), e os
+// níveis de detalhe de cada objeto, com o número de triângulos e o erro.
+//
+// Uso: make benchmark_malhas
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <glm/gtc/packing.hpp>
+
+#include "mesh.h"
+
+#define REPETICOES_CACHE 20
+
+static const char* ARQUIVOS[] =
+{
+    "data/piso.obj",
+    "data/poligono1.obj",
+    "data/bullet.obj",
+    "data/glock.obj",
+    "data/sphere.obj",
+    "data/Cup.obj",
+    "data/WoodenCrate.obj",
+    "data/barreira.obj",
+    "data/PalletPlywoodNew_GameReady_LODs.obj",
+    "data/bunny.obj",
+};
+
+static double agora()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Cópia dos vetores de uma malha, no lugar do envio para a GPU. */
+static std::vector<unsigned char> copia_vetores(const MeshArrays& arrays)
+{
+    std::vector<unsigned char> copia;
+    const unsigned char* inicio;
+
+    inicio = (const unsigned char*)arrays.model_coefficients;
+    copia.insert(copia.end(), inicio, inicio + arrays.num_model_coefficients*sizeof(float));
+    inicio = (const unsigned char*)arrays.normal_coefficients;
+    copia.insert(copia.end(), inicio, inicio + arrays.num_normal_coefficients*sizeof(float));
+    inicio = (const unsigned char*)arrays.texture_coefficients;
+    copia.insert(copia.end(), inicio, inicio + arrays.num_texture_coefficients*sizeof(float));
+    inicio = (const unsigned char*)arrays.indices;
+    copia.insert(copia.end(), inicio, inicio + arrays.num_indices*sizeof(uint32_t));
+
+    return copia;
+}
+
+static bool mesmos_objetos(const MeshArrays& a, const MeshArrays& b)
+{
+    if (a.shapes.size() != b.shapes.size())
+        return false;
+    for (size_t i = 0; i < a.shapes.size(); i++)
+        if (a.shapes[i].name != b.shapes[i].name ||
+            a.shapes[i].first_index != b.shapes[i].first_index ||
+            a.shapes[i].num_indices != b.shapes[i].num_indices ||
+            a.shapes[i].num_vertices != b.shapes[i].num_vertices ||
+            a.shapes[i].lod_level != b.shapes[i].lod_level ||
+            a.shapes[i].lod_error != b.shapes[i].lod_error ||
+            a.shapes[i].bbox_min != b.shapes[i].bbox_min ||
+            a.shapes[i].bbox_max != b.shapes[i].bbox_max)
+            return false;
+    return true;
+}
+
+/* Lê um componente de um atributo dos vértices intercalados, como a GPU faria. */
+static float le_componente(const PackedVertices& vertices, const VertexAttribute& atributo, size_t vertice, int componente)
+{
+    const unsigned char* origem = vertices.data.data() + vertice*vertices.stride + atributo.offset;
+    uint16_t inteiro;
+    float real;
+
+    switch (atributo.type)
+    {
+        case VERTEX_ATTRIBUTE_FLOAT:
+            memcpy(&real, origem + componente*sizeof(float), sizeof(float));
+            return real;
+        case VERTEX_ATTRIBUTE_HALF:
+            memcpy(&inteiro, origem + componente*sizeof(uint16_t), sizeof(uint16_t));
+            return glm::unpackHalf1x16(inteiro);
+        case VERTEX_ATTRIBUTE_SNORM16:
+            memcpy(&inteiro, origem + componente*sizeof(uint16_t), sizeof(uint16_t));
+            return glm::unpackSnorm1x16(inteiro);
+        default:
+            memcpy(&inteiro, origem + componente*sizeof(uint16_t), sizeof(uint16_t));
+            return glm::unpackUnorm1x16(inteiro);
+    }
+}
+
+static float erro_maximo(const PackedVertices& vertices, const VertexAttribute& atributo,
+                         const float* original, int componentes_original, int componentes)
+{
+    float erro = 0.0f;
+    if (atributo.components == 0)
+        return erro;
+    for (size_t i = 0; i < vertices.num_vertices; i++)
+        for (int c = 0; c < componentes; c++)
+            erro = std::max(erro, std::fabs(le_componente(vertices, atributo, i, c) - original[i*componentes_original + c]));
+    return erro;
+}
+
+/* Tamanho e precisão dos VBOs de uma malha em cada formato de vértice. */
+static void imprime_formatos(const char* arquivo, const MeshArrays& arrays)
+{
+    static const unsigned int formatos[] = {VERTEX_FORMAT_FLOAT, VERTEX_FORMAT_DEFAULT, VERTEX_FORMAT_DEFAULT | VERTEX_HALF_POSITIONS};
+    static const char* nomes[] = {"float", "padrao", "padrao+half"};
+
+    size_t vertices_antigos = arrays.num_model_coefficients/4;
+    size_t bytes_antigos = 4*sizeof(float);
+    if (arrays.num_normal_coefficients > 0)
+        bytes_antigos += 4*sizeof(float);
+    if (arrays.num_texture_coefficients > 0)
+        bytes_antigos += 2*sizeof(float);
+    printf("%s: VBOs separados (vec4, vec4, vec2): %lu bytes por vertice, %.1f KB\n", arquivo,
+           (unsigned long)bytes_antigos, vertices_antigos*bytes_antigos/1024.0);
+    for (size_t f = 0; f < sizeof(formatos)/sizeof(formatos[0]); f++)
+    {
+        PackedVertices vertices;
+        PackVertices(arrays, formatos[f], vertices);
+        printf("%s: formato %-12s %lu bytes por vertice, %.1f KB; erro maximo: posicao %g, normal %g, textura %g%s\n",
+               arquivo, nomes[f], (unsigned long)vertices.stride, vertices.data.size()/1024.0,
+               erro_maximo(vertices, vertices.position, arrays.model_coefficients, 4, 3),
+               erro_maximo(vertices, vertices.normal, arrays.normal_coefficients, 4, 3),
+               erro_maximo(vertices, vertices.texcoords, arrays.texture_coefficients, 2, 2),
+               (formatos[f] & VERTEX_PACKED_TEXCOORDS) && arrays.num_texture_coefficients > 0 &&
+               !(vertices.format & VERTEX_PACKED_TEXCOORDS) ? " (textura fora de [0,1]: mantida em float)" : "");
+    }
+}
+
+/* ACMR e ATVR de cada objeto com e sem OptimizeMeshData(). */
+static void imprime_cache_vertices(const char* arquivo, const MeshArrays& otimizada)
+{
+    ObjModel modelo(arquivo);
+    ComputeNormals(&modelo);
+    MeshData original;
+    BuildMeshData(&modelo, original);
+
+    MeshData copia = original;
+    double inicio = agora();
+    OptimizeMeshData(copia);
+    double tempo = agora() - inicio;
+
+    PrintVertexCacheReport(arquivo, GetMeshArrays(original), otimizada);
+    printf("%s: OptimizeMeshData() em %.2f ms\n", arquivo, 1000.0*tempo);
+}
+
+typedef struct
+{
+    const char* arquivo;
+    long tamanho;
+    double tempo_frio;
+    double tempo_cache;
+
+} Medicao;
+
+int main()
+{
+    std::vector<Medicao> medicoes;
+
+    for (size_t k = 0; k < sizeof(ARQUIVOS)/sizeof(ARQUIVOS[0]); k++)
+    {
+        Medicao medicao;
+        medicao.arquivo = ARQUIVOS[k];
+
+        FILE* teste = fopen(medicao.arquivo, "rb");
+        if (teste == NULL)
+        {
+            medicao.tamanho = -1;
+            medicoes.push_back(medicao);
+            continue;
+        }
+        fseek(teste, 0, SEEK_END);
+        medicao.tamanho = ftell(teste);
+        fclose(teste);
+
+        std::string cache = std::string(medicao.arquivo) + ".meshcache";
+        remove(cache.c_str());
+
+        double inicio = agora();
+        LoadedMesh frio;
+        LoadMesh(medicao.arquivo, frio);
+        std::vector<unsigned char> vetores_frio = copia_vetores(frio.arrays);
+        medicao.tempo_frio = agora() - inicio;
+        PackedVertices vertices;
+        PackVertices(frio.arrays, VERTEX_FORMAT_DEFAULT, vertices);
+        PrintMeshVertexReport(medicao.arquivo, frio.arrays, vertices.stride);
+        imprime_formatos(medicao.arquivo, frio.arrays);
+        imprime_cache_vertices(medicao.arquivo, frio.arrays);
+        PrintMeshLODReport(medicao.arquivo, frio.arrays);
+
+        medicao.tempo_cache = 0.0;
+        bool iguais = !frio.from_cache;
+        for (int r = 0; r < REPETICOES_CACHE; r++)
+        {
+            inicio = agora();
+            LoadedMesh cacheada;
+            LoadMesh(medicao.arquivo, cacheada);
+            std::vector<unsigned char> vetores_cache = copia_vetores(cacheada.arrays);
+            medicao.tempo_cache += agora() - inicio;
+
+            iguais = iguais && cacheada.from_cache && vetores_cache == vetores_frio &&
+                     mesmos_objetos(cacheada.arrays, frio.arrays);
+            UnloadMesh(cacheada);
+        }
+        medicao.tempo_cache /= REPETICOES_CACHE;
+        UnloadMesh(frio);
+
+        if (!iguais)
+        {
+            fprintf(stderr, "ERROR: \"%s\": o cache nao reproduz a malha lida do OBJ.\n", medicao.arquivo);
+            std::exit(EXIT_FAILURE);
+        }
+        medicoes.push_back(medicao);
+    }
+
+    double total_frio = 0.0;
+    double total_cache = 0.0;
+
+    printf("\n%-45s %10s %12s %12s %8s\n", "arquivo", "tamanho", "OBJ", "cache", "ganho");
+    for (size_t k = 0; k < medicoes.size(); k++)
+    {
+        const Medicao& medicao = medicoes[k];
+        if (medicao.tamanho < 0)
+        {
+            printf("%-45s (arquivo ausente)\n", medicao.arquivo);
+            continue;
+        }
+        printf("%-45s %7.2f MB %9.2f ms %9.2f ms %7.1fx\n",
+               medicao.arquivo, medicao.tamanho/1048576.0, 1000.0*medicao.tempo_frio, 1000.0*medicao.tempo_cache,
+               medicao.tempo_frio/medicao.tempo_cache);
+        total_frio += medicao.tempo_frio;
+        total_cache += medicao.tempo_cache;
+    }
+    printf("%-45s %10s %9.2f ms %9.2f ms %7.1fx\n", "total", "", 1000.0*total_frio, 1000.0*total_cache, total_frio/total_cache);
+
+    return 0;
+}
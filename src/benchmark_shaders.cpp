@@ -0,0 +1,334 @@
+// Benchmark do custo dos shaders em alta resolução (fill rate).
+//
+// Desenha, em um framebuffer fora da tela (3840x2160 por padrão), várias
+// camadas de uma grade de triângulos que cobre a imagem inteira, sem teste de
+// profundidade, de forma que todos os fragmentos de todas as camadas sejam
+// sombreados. A iluminação é a mesma de shader_vertex.glsl e
+// shader_fragment.glsl (Gouraud no vértice e Blinn-Phong no fragmento), em
+// duas versões:
+//
+//   - "inversoes no shader": a posição da câmera é calculada com
+//     inverse(view) em cada vértice e em cada fragmento, e a matriz das
+//     normais com inverse(transpose(model)) em cada vértice, como os shaders
+//     do jogo faziam antes;
+//   - "uniforms": a posição da câmera e a matriz das normais são calculadas
+//     uma vez no código C++ e enviadas como uniforms, como os shaders atuais.
+//
+// O tempo de GPU de cada quadro é medido com GL_TIME_ELAPSED, e o programa
+// imprime a mediana das repetições e o custo por fragmento.
+//
+// Uso: make benchmark_shaders            (3840x2160)
+//      ./bin/Linux/benchmark_shaders 1920 1080
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/matrix.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#define GRADE 256         // Quadrados por lado da grade
+#define CAMADAS 16        // Camadas desenhadas por quadro
+#define AQUECIMENTO 5     // Quadros descartados antes das medições
+#define REPETICOES 30
+
+static const char* SHADER_VERTICES = R"(
+layout (location = 0) in vec4 model_coefficients;
+layout (location = 1) in vec3 normal_coefficients;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+#ifndef INVERSOES_NO_SHADER
+uniform mat3 normal_matrix;
+uniform vec4 camera_position;
+#endif
+
+out vec4 position_world;
+out vec4 normal;
+out vec3 cor_v;
+
+void main()
+{
+    gl_Position = projection * view * model * model_coefficients;
+    position_world = model * model_coefficients;
+
+#ifdef INVERSOES_NO_SHADER
+    normal = inverse(transpose(model)) * vec4(normal_coefficients, 0.0);
+    normal.w = 0.0;
+    vec4 camera_position = inverse(view) * vec4(0.0, 0.0, 0.0, 1.0);
+#else
+    normal = vec4(normal_matrix * normal_coefficients, 0.0);
+#endif
+
+    vec3 Kd = vec3(0.8,0.4,0.08);
+    vec3 Ks = vec3(0.8,0.8,0.8);
+    vec3 Ka = Kd/2;
+    vec4 l = normalize(vec4(1.0,1.0,0.0,0.0));
+    vec4 n = normalize(normal);
+    vec4 v = normalize(camera_position - position_world);
+    vec4 h = (v+l)/sqrt(dot(v+l,v+l));
+    cor_v = Kd*max(0, dot(n,l)) + Ka*vec3(0.2) + Ks*pow(max(dot(n,h), 0.0), 20.0);
+}
+)";
+
+static const char* SHADER_FRAGMENTOS = R"(
+in vec4 position_world;
+in vec4 normal;
+in vec3 cor_v;
+
+#ifdef INVERSOES_NO_SHADER
+uniform mat4 view;
+#else
+uniform vec4 camera_position;
+#endif
+
+out vec4 color;
+
+void main()
+{
+#ifdef INVERSOES_NO_SHADER
+    vec4 camera_position = inverse(view) * vec4(0.0, 0.0, 0.0, 1.0);
+#endif
+    vec4 n = normalize(normal);
+    vec4 l = normalize(vec4(1.0,1.0,0.0,0.0));
+    vec4 v = normalize(camera_position - position_world);
+    vec4 h = (v+l)/sqrt(dot(v+l,v+l));
+
+    vec3 Kd = vec3(0.2,0.2,0.2);
+    vec3 Ks = vec3(0.3,0.3,0.3);
+    vec3 lambert = Kd*max(0, dot(n,l));
+    vec3 blinn_phong = Ks*pow(max(dot(n,h), 0.0), 20.0);
+    color = vec4(0.5*cor_v + lambert + blinn_phong, 1.0);
+}
+)";
+
+static GLuint compila_shader(GLenum tipo, const char* corpo, bool inversoes)
+{
+    std::string fonte = "#version 330 core\n";
+    if (inversoes)
+        fonte += "#define INVERSOES_NO_SHADER\n";
+    fonte += corpo;
+
+    const char* texto = fonte.c_str();
+    GLuint shader = glCreateShader(tipo);
+    glShaderSource(shader, 1, &texto, NULL);
+    glCompileShader(shader);
+
+    GLint compilado;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compilado);
+    if (!compilado)
+    {
+        char log[4096];
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        fprintf(stderr, "ERROR: shader de %s nao compilou:\n%s\n", tipo == GL_VERTEX_SHADER ? "vertices" : "fragmentos", log);
+        std::exit(EXIT_FAILURE);
+    }
+    return shader;
+}
+
+static GLuint cria_programa(bool inversoes)
+{
+    GLuint vertices = compila_shader(GL_VERTEX_SHADER, SHADER_VERTICES, inversoes);
+    GLuint fragmentos = compila_shader(GL_FRAGMENT_SHADER, SHADER_FRAGMENTOS, inversoes);
+
+    GLuint programa = glCreateProgram();
+    glAttachShader(programa, vertices);
+    glAttachShader(programa, fragmentos);
+    glLinkProgram(programa);
+
+    GLint ligado;
+    glGetProgramiv(programa, GL_LINK_STATUS, &ligado);
+    if (!ligado)
+    {
+        char log[4096];
+        glGetProgramInfoLog(programa, sizeof(log), NULL, log);
+        fprintf(stderr, "ERROR: programa de GPU nao foi ligado:\n%s\n", log);
+        std::exit(EXIT_FAILURE);
+    }
+    glDeleteShader(vertices);
+    glDeleteShader(fragmentos);
+    return programa;
+}
+
+/* Grade de GRADE x GRADE quadrados em [-1,1]x[-1,1], no plano z = 0, com normal +z. */
+static GLuint cria_grade(GLsizei& quantidade_indices)
+{
+    std::vector<float> posicoes;
+    std::vector<float> normais;
+    for (int i = 0; i <= GRADE; i++)
+        for (int j = 0; j <= GRADE; j++)
+        {
+            float x = -1.0f + 2.0f*j/GRADE;
+            float y = -1.0f + 2.0f*i/GRADE;
+            posicoes.insert(posicoes.end(), {x, y, 0.0f, 1.0f});
+            normais.insert(normais.end(), {0.0f, 0.0f, 1.0f});
+        }
+
+    std::vector<GLuint> indices;
+    for (int i = 0; i < GRADE; i++)
+        for (int j = 0; j < GRADE; j++)
+        {
+            GLuint a = i*(GRADE + 1) + j;
+            GLuint b = a + 1;
+            GLuint c = a + GRADE + 1;
+            GLuint d = c + 1;
+            indices.insert(indices.end(), {a, b, d, a, d, c});
+        }
+    quantidade_indices = (GLsizei)indices.size();
+
+    GLuint vao, buffers[3];
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(3, buffers);
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, posicoes.size()*sizeof(float), posicoes.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+    glBufferData(GL_ARRAY_BUFFER, normais.size()*sizeof(float), normais.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(1);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[2]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    return vao;
+}
+
+/* Mediana, em segundos, do tempo de GPU de REPETICOES quadros com CAMADAS camadas da grade. */
+static double mede(bool inversoes, GLuint vao, GLsizei quantidade_indices)
+{
+    GLuint programa = cria_programa(inversoes);
+    glUseProgram(programa);
+
+    // Câmera ortográfica olhando para a grade, que é um pouco maior que a tela
+    // e tem uma escala não uniforme, para que a matriz das normais não seja trivial.
+    glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(1.1f, 1.2f, 0.5f));
+    glm::mat4 view = glm::lookAt(glm::vec3(0.3f, 0.2f, 2.0f), glm::vec3(0.3f, 0.2f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::ortho(-0.7f, 0.7f, -0.8f, 0.8f, 0.1f, 10.0f);
+    glUniformMatrix4fv(glGetUniformLocation(programa, "model"), 1, GL_FALSE, glm::value_ptr(model));
+    glUniformMatrix4fv(glGetUniformLocation(programa, "view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(programa, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    if (!inversoes)
+    {
+        glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3(model)));
+        glm::vec4 camera_position = glm::inverse(view)[3];
+        glUniformMatrix3fv(glGetUniformLocation(programa, "normal_matrix"), 1, GL_FALSE, glm::value_ptr(normal_matrix));
+        glUniform4fv(glGetUniformLocation(programa, "camera_position"), 1, glm::value_ptr(camera_position));
+    }
+
+    glBindVertexArray(vao);
+    GLuint consulta;
+    glGenQueries(1, &consulta);
+
+    std::vector<double> tempos;
+    for (int r = 0; r < AQUECIMENTO + REPETICOES; r++)
+    {
+        glClear(GL_COLOR_BUFFER_BIT);
+        glBeginQuery(GL_TIME_ELAPSED, consulta);
+        for (int c = 0; c < CAMADAS; c++)
+            glDrawElements(GL_TRIANGLES, quantidade_indices, GL_UNSIGNED_INT, 0);
+        glEndQuery(GL_TIME_ELAPSED);
+
+        GLuint64 nanossegundos;
+        glGetQueryObjectui64v(consulta, GL_QUERY_RESULT, &nanossegundos);
+        if (r >= AQUECIMENTO)
+            tempos.push_back(nanossegundos*1e-9);
+    }
+
+    glDeleteQueries(1, &consulta);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glDeleteProgram(programa);
+
+    std::sort(tempos.begin(), tempos.end());
+    return tempos[tempos.size()/2];
+}
+
+int main(int argc, char* argv[])
+{
+    int largura = 3840;
+    int altura = 2160;
+    if (argc == 3)
+    {
+        largura = atoi(argv[1]);
+        altura = atoi(argv[2]);
+    }
+    if (largura <= 0 || altura <= 0)
+    {
+        fprintf(stderr, "ERROR: uso: %s [largura altura]\n", argv[0]);
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (!glfwInit())
+    {
+        fprintf(stderr, "ERROR: glfwInit() failed.\n");
+        std::exit(EXIT_FAILURE);
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    #ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    #endif
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow* janela = glfwCreateWindow(64, 64, "benchmark_shaders", NULL, NULL);
+    if (!janela)
+    {
+        glfwTerminate();
+        fprintf(stderr, "ERROR: glfwCreateWindow() failed.\n");
+        std::exit(EXIT_FAILURE);
+    }
+    glfwMakeContextCurrent(janela);
+    gladLoadGLLoader((GLADloadproc) glfwGetProcAddress);
+
+    printf("GPU: %s, %s, OpenGL %s\n", glGetString(GL_VENDOR), glGetString(GL_RENDERER), glGetString(GL_VERSION));
+
+    // Framebuffer fora da tela, com a resolução pedida.
+    GLuint framebuffer, cor;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glGenRenderbuffers(1, &cor);
+    glBindRenderbuffer(GL_RENDERBUFFER, cor);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, largura, altura);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, cor);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf(stderr, "ERROR: framebuffer de %dx%d incompleto.\n", largura, altura);
+        std::exit(EXIT_FAILURE);
+    }
+    glViewport(0, 0, largura, altura);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+
+    GLsizei quantidade_indices;
+    GLuint vao = cria_grade(quantidade_indices);
+
+    double fragmentos = (double)largura*altura*CAMADAS;
+    double antes = mede(true, vao, quantidade_indices);
+    double depois = mede(false, vao, quantidade_indices);
+
+    printf("%dx%d, %d camadas de %d triangulos: %.1f milhoes de fragmentos por quadro\n",
+           largura, altura, CAMADAS, (int)quantidade_indices/3, fragmentos*1e-6);
+    printf("%-22s %10s %16s %18s\n", "shaders", "quadro", "por fragmento", "fragmentos/s");
+    printf("%-22s %7.2f ms %13.3f ns %14.2f G/s\n", "inversoes no shader", 1000.0*antes, 1e9*antes/fragmentos, fragmentos/antes*1e-9);
+    printf("%-22s %7.2f ms %13.3f ns %14.2f G/s\n", "uniforms", 1000.0*depois, 1e9*depois/fragmentos, fragmentos/depois*1e-9);
+    printf("reducao do tempo de GPU: %.1f%% (%.2fx)\n", 100.0*(antes - depois)/antes, antes/depois);
+
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,183 @@
+// Benchmark da preparação das imagens para a GPU (veja texture.h).
+//
+// Para cada imagem do jogo, decodifica o arquivo e o reamostra para o tamanho
+// usado pelo jogo, e mede, nas versões escalar e SSE2:
+//
+//   - a expansão de RGB para RGBA com a inversão vertical (ExpandImageRGBA());
+//   - a geração de todos os níveis de mipmap em espaço de cor linear
+//     (DownsampleImageSRGB(), do nível 0 até 1x1).
+//
+// O programa confere que as duas versões produzem exatamente os mesmos bytes
+// antes de imprimir os tempos. Por fim, carrega todas as imagens em RGB8 (sem
+// o cache de texturas) através do AssetLoader, com uma thread e com uma
+// thread por núcleo, para mostrar como a preparação escala com o número de
+// threads.
+//
+// Uso: make benchmark_texturas
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "assets.h"
+#include "texture.h"
+
+#define TAMANHO_TEXTURAS 1024
+#define REPETICOES 5
+
+static const char* ARQUIVOS[] =
+{
+    "data/textura_piso.jpg",
+    "data/textB1!.png",
+    "data/textura_bala.jpg",
+    "data/glocktexture.png",
+    "data/skybox.jpeg",
+    "data/telainicio.jpg",
+    "data/trofeu_textura.png",
+    "data/skybox_trofeu.jpg",
+    "data/WoodenCrate_Crate_BaseColor.png",
+    "data/barreira.jpg",
+    "data/PalletPlywood_Base_Color.png",
+};
+
+static double agora()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool existe(const char* arquivo)
+{
+    FILE* teste = fopen(arquivo, "rb");
+    if (teste == NULL)
+        return false;
+    fclose(teste);
+    return true;
+}
+
+/* Todos os níveis de mipmap de uma imagem RGBA, um depois do outro. */
+static void gera_mipmaps(const std::vector<unsigned char>& rgba, int tamanho, std::vector<unsigned char>& niveis, bool simd)
+{
+    niveis.clear();
+    size_t anterior = 0;
+    while (tamanho > 1)
+    {
+        int menor = tamanho / 2;
+        size_t inicio = niveis.size();
+        niveis.resize(inicio + (size_t)menor * menor * 4);
+        const unsigned char* origem = inicio == 0 ? rgba.data() : &niveis[anterior];
+        DownsampleImageSRGB(origem, tamanho, tamanho, &niveis[inicio], menor, menor, simd);
+        anterior = inicio;
+        tamanho = menor;
+    }
+}
+
+/* Menor tempo, em segundos, entre as repetições de uma versão. */
+struct Tempos
+{
+    double expansao = 1e30;
+    double mipmaps = 1e30;
+};
+
+static void mede(const LoadedImage& imagem, bool simd, Tempos& tempos,
+                 std::vector<unsigned char>& rgba, std::vector<unsigned char>& niveis)
+{
+    rgba.resize((size_t)imagem.width * imagem.height * 4);
+    for (int r = 0; r < REPETICOES; r++)
+    {
+        double inicio = agora();
+        ExpandImageRGBA(imagem, true, rgba.data(), simd);
+        tempos.expansao = std::min(tempos.expansao, agora() - inicio);
+
+        inicio = agora();
+        gera_mipmaps(rgba, imagem.width, niveis, simd);
+        tempos.mipmaps = std::min(tempos.mipmaps, agora() - inicio);
+    }
+}
+
+/* Carrega todas as imagens existentes com o AssetLoader e retorna o tempo total. */
+static double carrega_todas(unsigned int threads)
+{
+    AssetLoader carregador;
+    for (size_t k = 0; k < sizeof(ARQUIVOS)/sizeof(ARQUIVOS[0]); k++)
+        if (existe(ARQUIVOS[k]))
+            AddImageJob(carregador, ARQUIVOS[k], (int)k, TAMANHO_TEXTURAS, TEXTURE_FORMAT_RGB8);
+
+    double inicio = agora();
+    StartAssetLoader(carregador, threads);
+    while (AssetJob* trabalho = WaitFinishedAsset(carregador))
+    {
+        if (!trabalho->error.empty())
+        {
+            std::string erro = trabalho->error;
+            StopAssetLoader(carregador);
+            fprintf(stderr, "ERROR: %s\n", erro.c_str());
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    double tempo = agora() - inicio;
+    StopAssetLoader(carregador);
+    return tempo;
+}
+
+int main()
+{
+    if (!TEXTURE_SIMD)
+        printf("AVISO: SSE2 indisponivel nesta CPU; as duas versoes sao escalares.\n");
+
+    Tempos total_escalar, total_simd;
+    total_escalar.expansao = total_escalar.mipmaps = 0.0;
+    total_simd.expansao = total_simd.mipmaps = 0.0;
+
+    printf("%-40s %12s %22s %22s\n", "arquivo", "decodificar", "RGBA (escalar/SSE2)", "mipmaps (escalar/SSE2)");
+    for (size_t k = 0; k < sizeof(ARQUIVOS)/sizeof(ARQUIVOS[0]); k++)
+    {
+        if (!existe(ARQUIVOS[k]))
+        {
+            printf("%-40s (arquivo ausente)\n", ARQUIVOS[k]);
+            continue;
+        }
+
+        double inicio = agora();
+        LoadedImage imagem;
+        DecodeImage(ARQUIVOS[k], imagem);
+        double decodificacao = agora() - inicio;
+        ResizeImage(imagem, TAMANHO_TEXTURAS, TAMANHO_TEXTURAS);
+
+        Tempos escalar, simd;
+        std::vector<unsigned char> rgba_escalar, rgba_simd, niveis_escalar, niveis_simd;
+        mede(imagem, false, escalar, rgba_escalar, niveis_escalar);
+        mede(imagem, TEXTURE_SIMD, simd, rgba_simd, niveis_simd);
+        FreeDecodedImage(imagem);
+
+        if (rgba_escalar != rgba_simd || niveis_escalar != niveis_simd)
+        {
+            fprintf(stderr, "ERROR: as versoes escalar e SSE2 de \"%s\" produziram resultados diferentes.\n", ARQUIVOS[k]);
+            std::exit(EXIT_FAILURE);
+        }
+
+        total_escalar.expansao += escalar.expansao;
+        total_escalar.mipmaps += escalar.mipmaps;
+        total_simd.expansao += simd.expansao;
+        total_simd.mipmaps += simd.mipmaps;
+
+        printf("%-40s %9.1f ms %8.2f / %6.2f ms %8.2f / %6.2f ms\n", ARQUIVOS[k], 1000.0*decodificacao,
+               1000.0*escalar.expansao, 1000.0*simd.expansao, 1000.0*escalar.mipmaps, 1000.0*simd.mipmaps);
+    }
+    printf("%-40s %12s %8.2f / %6.2f ms %8.2f / %6.2f ms (%.1fx e %.1fx)\n", "total", "",
+           1000.0*total_escalar.expansao, 1000.0*total_simd.expansao,
+           1000.0*total_escalar.mipmaps, 1000.0*total_simd.mipmaps,
+           total_escalar.expansao / total_simd.expansao, total_escalar.mipmaps / total_simd.mipmaps);
+
+    unsigned int nucleos = std::max(1u, std::thread::hardware_concurrency());
+    double uma = carrega_todas(1);
+    double todas = carrega_todas(nucleos);
+    printf("\nAssetLoader (decodificacao, RGBA e mipmaps em RGB8): 1 thread: %.1f ms; %u threads: %.1f ms (%.1fx).\n",
+           1000.0*uma, nucleos, 1000.0*todas, uma / todas);
+
+    return 0;
+}
@@ -1,11 +1,20 @@
 #include "collisions.h"
 
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <algorithm>
 
 #include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/geometric.hpp>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #define LIMITE_ESQ_ALVO -10.0
 #define LIMITE_DIR_ALVO 10.0
@@ -26,76 +35,562 @@
 #define ALTURA_BALAS 0.8
 
 
-/* Função com teste de colisão ponto-cubo, responsável por impedir que um alvo seja desenhado, caso seja acertado por uma bala. */
-void destroi_alvos(Bala vetor_balas[], Alvo vetor_alvos[])
+/* Converte uma coordenada do mundo (x ou z) no índice da coluna correspondente da grade.
+Coordenadas fora dos limites são presas à primeira ou à última coluna. */
+static int coluna_grade(const GradeColisao& grade, float coordenada)
+{
+    int coluna = (int)floorf((coordenada - LIMITE_MIN_GRADE)/TAMANHO_CELULA_GRADE);
+
+    if (coluna < 0)
+        coluna = 0;
+    else if (coluna >= grade.colunas)
+        coluna = grade.colunas - 1;
+
+    return coluna;
+}
+
+static void retira_da_celula(std::vector<int>& celula, int id)
+{
+    for (size_t k = 0; k < celula.size(); k++)
+        if (celula[k] == id)
+        {
+            celula[k] = celula.back();
+            celula.pop_back();
+            return;
+        }
+}
+
+void inicializa_grade(GradeColisao& grade, int quantidade)
+{
+    grade.colunas = (int)ceil((LIMITE_MAX_GRADE - LIMITE_MIN_GRADE)/TAMANHO_CELULA_GRADE);
+    grade.celulas.assign(grade.colunas*grade.colunas, std::vector<int>());
+    grade.intervalos.assign(quantidade, IntervaloGrade());
+}
+
+void remove_da_grade(GradeColisao& grade, int id)
+{
+    IntervaloGrade& antigo = grade.intervalos[id];
+    if (antigo.x0 < 0)
+        return;
+
+    for (int cz = antigo.z0; cz <= antigo.z1; cz++)
+        for (int cx = antigo.x0; cx <= antigo.x1; cx++)
+            retira_da_celula(grade.celulas[cz*grade.colunas + cx], id);
+
+    antigo = IntervaloGrade();
+}
+
+void atualiza_grade(GradeColisao& grade, int id, glm::vec4 bbox_minimo, glm::vec4 bbox_maximo)
+{
+    IntervaloGrade novo;
+    novo.x0 = coluna_grade(grade, bbox_minimo.x);
+    novo.z0 = coluna_grade(grade, bbox_minimo.z);
+    novo.x1 = coluna_grade(grade, bbox_maximo.x);
+    novo.z1 = coluna_grade(grade, bbox_maximo.z);
+
+    IntervaloGrade& antigo = grade.intervalos[id];
+    if (antigo.x0 == novo.x0 && antigo.z0 == novo.z0 && antigo.x1 == novo.x1 && antigo.z1 == novo.z1)
+        return; /* O objeto continua nas mesmas células, nada a fazer. */
+
+    remove_da_grade(grade, id);
+
+    for (int cz = novo.z0; cz <= novo.z1; cz++)
+        for (int cx = novo.x0; cx <= novo.x1; cx++)
+            grade.celulas[cz*grade.colunas + cx].push_back(id);
+
+    grade.intervalos[id] = novo;
+}
+
+const std::vector<int>& consulta_grade(const GradeColisao& grade, float x, float z)
+{
+    return grade.celulas[coluna_grade(grade, z)*grade.colunas + coluna_grade(grade, x)];
+}
+
+void constroi_grade_objetos(GradeColisao& grade, ObjetoCenario vetor_objetos[], int quantidade_objetos)
+{
+    inicializa_grade(grade, quantidade_objetos);
+    for (int j = 0; j < quantidade_objetos; j++)
+        atualiza_grade(grade, j, vetor_objetos[j].bbox_minimo, vetor_objetos[j].bbox_maximo);
+}
+
+void atualiza_grade_alvos(GradeColisao& grade, Alvo vetor_alvos[], int quantidade_alvos)
+{
+    if ((int)grade.intervalos.size() != quantidade_alvos)
+        inicializa_grade(grade, quantidade_alvos);
+
+    for (int j = 0; j < quantidade_alvos; j++)
+    {
+        if (vetor_alvos[j].dano < MAXIMO_DANO)
+            atualiza_grade(grade, j, vetor_alvos[j].bbox_minimo, vetor_alvos[j].bbox_maximo);
+        else
+            remove_da_grade(grade, j);
+    }
+}
+
+void atualiza_grade_esferas(GradeColisao& grade, Esfera vetor_esferas[], int quantidade_esferas)
+{
+    if ((int)grade.intervalos.size() != quantidade_esferas)
+        inicializa_grade(grade, quantidade_esferas);
+
+    for (int j = 0; j < quantidade_esferas; j++)
+    {
+        if (vetor_esferas[j].dano < MAXIMO_DANO)
+        {
+            glm::vec4 raio = glm::vec4(RAIO_ESFERAS, RAIO_ESFERAS, RAIO_ESFERAS, 0.0f);
+            glm::vec4 centro = glm::vec4(vetor_esferas[j].centro_x, vetor_esferas[j].centro_y, vetor_esferas[j].centro_z, 0.0f);
+            atualiza_grade(grade, j, centro - raio, centro + raio);
+        }
+        else
+            remove_da_grade(grade, j);
+    }
+}
+
+/* Acrescenta a "candidatos" o conteúdo das células cobertas pelo retângulo que envolve o segmento.
+Retorna true se mais de uma célula foi visitada (e, portanto, pode haver índices repetidos). */
+static bool acrescenta_celulas_segmento(const GradeColisao& grade, float x0, float z0, float x1, float z1, std::vector<int>& candidatos)
+{
+    int cx0 = coluna_grade(grade, fminf(x0, x1));
+    int cx1 = coluna_grade(grade, fmaxf(x0, x1));
+    int cz0 = coluna_grade(grade, fminf(z0, z1));
+    int cz1 = coluna_grade(grade, fmaxf(z0, z1));
+
+    for (int cz = cz0; cz <= cz1; cz++)
+        for (int cx = cx0; cx <= cx1; cx++)
+        {
+            const std::vector<int>& celula = grade.celulas[cz*grade.colunas + cx];
+            candidatos.insert(candidatos.end(), celula.begin(), celula.end());
+        }
+
+    return cx0 != cx1 || cz0 != cz1;
+}
+
+static void remove_repetidos(std::vector<int>& candidatos)
+{
+    std::sort(candidatos.begin(), candidatos.end());
+    candidatos.erase(std::unique(candidatos.begin(), candidatos.end()), candidatos.end());
+}
+
+void consulta_grade_segmento(const GradeColisao& grade, float x0, float z0, float x1, float z1, std::vector<int>& candidatos)
+{
+    candidatos.clear();
+
+    /* Objetos que ocupam mais de uma célula aparecem repetidos. */
+    if (acrescenta_celulas_segmento(grade, x0, z0, x1, z1, candidatos))
+        remove_repetidos(candidatos);
+}
+
+bool intersecta_segmento_aabb(glm::vec4 inicio, glm::vec4 fim, glm::vec4 bbox_minimo, glm::vec4 bbox_maximo, float& t_entrada)
+{
+    float t_min = 0.0f;
+    float t_max = 1.0f;
+
+    for (int eixo = 0; eixo < 3; eixo++)
+    {
+        float deslocamento = fim[eixo] - inicio[eixo];
+
+        if (deslocamento == 0.0f)
+        {
+            /* Segmento paralelo às faces deste eixo: basta estar entre elas. */
+            if (inicio[eixo] < bbox_minimo[eixo] || inicio[eixo] > bbox_maximo[eixo])
+                return false;
+            continue;
+        }
+
+        float t_a = (bbox_minimo[eixo] - inicio[eixo])/deslocamento;
+        float t_b = (bbox_maximo[eixo] - inicio[eixo])/deslocamento;
+        if (t_a > t_b)
+            std::swap(t_a, t_b);
+
+        t_min = fmaxf(t_min, t_a);
+        t_max = fminf(t_max, t_b);
+        if (t_min > t_max)
+            return false;
+    }
+
+    t_entrada = t_min;
+    return true;
+}
+
+/* Em vez de transformar os 8 cantos, transformamos o centro da caixa e projetamos as meias-extensões
+nos eixos do mundo usando o valor absoluto de cada coeficiente da parte linear da matriz. */
+void calcula_aabb_mundo(const glm::mat4& modelo, glm::vec4 bbox_minimo_local, glm::vec4 bbox_maximo_local, glm::vec4& bbox_minimo, glm::vec4& bbox_maximo)
+{
+    glm::vec3 centro_local = 0.5f*glm::vec3(bbox_minimo_local + bbox_maximo_local);
+    glm::vec3 meia_local = 0.5f*glm::vec3(bbox_maximo_local - bbox_minimo_local);
+
+    glm::vec3 centro = glm::vec3(modelo*glm::vec4(centro_local, 1.0f));
+    glm::vec3 meia = glm::vec3(0.0f);
+    for (int coluna = 0; coluna < 3; coluna++)
+        meia += glm::abs(glm::vec3(modelo[coluna]))*meia_local[coluna];
+
+    bbox_minimo = glm::vec4(centro - meia, 0.0f);
+    bbox_maximo = glm::vec4(centro + meia, 0.0f);
+}
+
+bool intersecta_segmento_esfera(glm::vec4 inicio, glm::vec4 fim, glm::vec4 centro, float raio, float& t_entrada)
+{
+    glm::vec3 d = glm::vec3(fim - inicio);
+    glm::vec3 m = glm::vec3(inicio - centro);
+
+    float c = glm::dot(m, m) - raio*raio;
+    if (c <= 0.0f)
+    {
+        /* O segmento começa dentro da esfera. */
+        t_entrada = 0.0f;
+        return true;
+    }
+
+    float a = glm::dot(d, d);
+    float b = glm::dot(m, d);
+    if (a == 0.0f || b >= 0.0f)
+        return false; /* Segmento degenerado fora da esfera, ou afastando-se dela. */
+
+    float discriminante = b*b - a*c;
+    if (discriminante < 0.0f)
+        return false;
+
+    float t = (-b - sqrtf(discriminante))/a;
+    if (t > 1.0f)
+        return false;
+
+    t_entrada = t;
+    return true;
+}
+
+void inicializa_balas(Balas& balas, int quantidade)
+{
+    /* Arredondamos para um múltiplo do lote, para que o teste vetorizado nunca leia fora dos vetores. */
+    int capacidade = (quantidade + LARGURA_LOTE_BALAS - 1)/LARGURA_LOTE_BALAS*LARGURA_LOTE_BALAS;
+
+    balas.quantidade = quantidade;
+    balas.x.assign(capacidade, 0.0f);
+    balas.y.assign(capacidade, ALTURA_BALAS);
+    balas.z.assign(capacidade, 0.0f);
+    balas.x_anterior.assign(capacidade, 0.0f);
+    balas.y_anterior.assign(capacidade, ALTURA_BALAS);
+    balas.z_anterior.assign(capacidade, 0.0f);
+    balas.desenhar.assign(capacidade, 0);
+    balas.atingiu_cenario.assign(capacidade, 0);
+    balas.direcao.assign(capacidade, glm::vec4(0.0f,0.0f,0.0f,0.0f));
+    balas.eixo_rotacao_normalizado.assign(capacidade, glm::vec4(0.0f,0.0f,0.0f,0.0f));
+    balas.angulo_rotacao.assign(capacidade, 0.0f);
+}
+
+int testa_lote_balas_aabb(const Balas& balas, int primeira, glm::vec4 bbox_minimo, glm::vec4 bbox_maximo)
+{
+    const float* atuais[3] = { &balas.x[primeira], &balas.y[primeira], &balas.z[primeira] };
+    const float* anteriores[3] = { &balas.x_anterior[primeira], &balas.y_anterior[primeira], &balas.z_anterior[primeira] };
+
+#if defined(__AVX2__)
+    /* 8 balas por instrução. */
+    __m256i em_voo = _mm256_loadu_si256((const __m256i*)&balas.desenhar[primeira]);
+    __m256 sobrepoe = _mm256_castsi256_ps(_mm256_cmpgt_epi32(em_voo, _mm256_setzero_si256()));
+
+    for (int eixo = 0; eixo < 3; eixo++)
+    {
+        __m256 atual = _mm256_loadu_ps(atuais[eixo]);
+        __m256 anterior = _mm256_loadu_ps(anteriores[eixo]);
+        __m256 minimo = _mm256_min_ps(atual, anterior);
+        __m256 maximo = _mm256_max_ps(atual, anterior);
+        sobrepoe = _mm256_and_ps(sobrepoe, _mm256_cmp_ps(minimo, _mm256_set1_ps(bbox_maximo[eixo]), _CMP_LE_OQ));
+        sobrepoe = _mm256_and_ps(sobrepoe, _mm256_cmp_ps(maximo, _mm256_set1_ps(bbox_minimo[eixo]), _CMP_GE_OQ));
+    }
+
+    return _mm256_movemask_ps(sobrepoe);
+
+#elif defined(__SSE2__)
+    /* Duas metades de 4 balas. */
+    int mascara = 0;
+    for (int metade = 0; metade < 2; metade++)
+    {
+        int deslocamento = 4*metade;
+        __m128i em_voo = _mm_loadu_si128((const __m128i*)&balas.desenhar[primeira + deslocamento]);
+        __m128 sobrepoe = _mm_castsi128_ps(_mm_cmpgt_epi32(em_voo, _mm_setzero_si128()));
+
+        for (int eixo = 0; eixo < 3; eixo++)
+        {
+            __m128 atual = _mm_loadu_ps(atuais[eixo] + deslocamento);
+            __m128 anterior = _mm_loadu_ps(anteriores[eixo] + deslocamento);
+            __m128 minimo = _mm_min_ps(atual, anterior);
+            __m128 maximo = _mm_max_ps(atual, anterior);
+            sobrepoe = _mm_and_ps(sobrepoe, _mm_cmple_ps(minimo, _mm_set1_ps(bbox_maximo[eixo])));
+            sobrepoe = _mm_and_ps(sobrepoe, _mm_cmpge_ps(maximo, _mm_set1_ps(bbox_minimo[eixo])));
+        }
+
+        mascara |= _mm_movemask_ps(sobrepoe) << deslocamento;
+    }
+
+    return mascara;
+
+#else
+    /* Versão escalar, para arquiteturas sem SSE2 (por exemplo, ARM). */
+    int mascara = 0;
+    for (int k = 0; k < LARGURA_LOTE_BALAS; k++)
+    {
+        bool sobrepoe = balas.desenhar[primeira + k] > 0;
+        for (int eixo = 0; eixo < 3 && sobrepoe; eixo++)
+        {
+            float minimo = fminf(atuais[eixo][k], anteriores[eixo][k]);
+            float maximo = fmaxf(atuais[eixo][k], anteriores[eixo][k]);
+            sobrepoe = minimo <= bbox_maximo[eixo] && maximo >= bbox_minimo[eixo];
+        }
+        if (sobrepoe)
+            mascara |= 1 << k;
+    }
+
+    return mascara;
+#endif
+}
+
+static glm::vec4 inicio_segmento(const Balas& balas, int i)
+{
+    return glm::vec4(balas.x_anterior[i], balas.y_anterior[i], balas.z_anterior[i], 1.0f);
+}
+
+static glm::vec4 fim_segmento(const Balas& balas, int i)
+{
+    return glm::vec4(balas.x[i], balas.y[i], balas.z[i], 1.0f);
+}
+
+/* Reúne em "candidatos" (sem repetição) os objetos das células cobertas pelos segmentos das balas em voo
+do lote que começa em "primeira". Retorna false se nenhuma bala do lote está em voo. */
+static bool candidatos_lote(const GradeColisao& grade, const Balas& balas, int primeira, std::vector<int>& candidatos)
+{
+    candidatos.clear();
+
+    bool alguma_em_voo = false;
+    for (int i = primeira; i < primeira + LARGURA_LOTE_BALAS; i++)
+    {
+        if (!balas.desenhar[i])
+            continue;
+        alguma_em_voo = true;
+        acrescenta_celulas_segmento(grade, balas.x_anterior[i], balas.z_anterior[i], balas.x[i], balas.z[i], candidatos);
+    }
+
+    remove_repetidos(candidatos);
+    return alguma_em_voo;
+}
+
+/* Somente a face frontal do alvo, com espessura ESPESSURA_ALVOS, é atingível. */
+static glm::vec4 frente_minimo_alvo(const Alvo& alvo)
+{
+    glm::vec4 frente_minimo = alvo.bbox_minimo;
+    frente_minimo.z = alvo.bbox_maximo.z-ESPESSURA_ALVOS;
+    return frente_minimo;
+}
+
+/* Primeiro alvo intacto atingido pela bala i ao longo do seu segmento (no empate, o de menor índice), ou -1. */
+static int primeiro_alvo(const Balas& balas, int i, const Alvo vetor_alvos[], const std::vector<int>& candidatos)
+{
+    glm::vec4 inicio = inicio_segmento(balas, i);
+    glm::vec4 fim = fim_segmento(balas, i);
+
+    int atingido = -1;
+    float t_atingido = 2.0f;
+    for (size_t k = 0; k < candidatos.size(); k++)
+    {
+        int j = candidatos[k];
+        float t;
+        if (vetor_alvos[j].dano < MAXIMO_DANO &&
+            intersecta_segmento_aabb(inicio, fim, frente_minimo_alvo(vetor_alvos[j]), vetor_alvos[j].bbox_maximo, t) &&
+            (t < t_atingido || (t == t_atingido && j < atingido)))
+        {
+            atingido = j;
+            t_atingido = t;
+        }
+    }
+    return atingido;
+}
+
+/* Análoga à anterior, para as esferas. */
+static int primeira_esfera(const Balas& balas, int i, const Esfera vetor_esferas[], const std::vector<int>& candidatos)
+{
+    glm::vec4 inicio = inicio_segmento(balas, i);
+    glm::vec4 fim = fim_segmento(balas, i);
+
+    int atingida = -1;
+    float t_atingida = 2.0f;
+    for (size_t k = 0; k < candidatos.size(); k++)
+    {
+        int j = candidatos[k];
+        glm::vec4 centro = glm::vec4(vetor_esferas[j].centro_x, vetor_esferas[j].centro_y, vetor_esferas[j].centro_z, 1.0f);
+        float t;
+        if (vetor_esferas[j].dano < MAXIMO_DANO &&
+            intersecta_segmento_esfera(inicio, fim, centro, RAIO_ESFERAS, t) &&
+            (t < t_atingida || (t == t_atingida && j < atingida)))
+        {
+            atingida = j;
+            t_atingida = t;
+        }
+    }
+    return atingida;
+}
+
+/* Função com teste de colisão segmento-cubo, responsável por impedir que um alvo seja desenhado, caso seja acertado por uma bala. */
+void destroi_alvos(Balas& balas, Alvo vetor_alvos[], GradeColisao& grade_alvos)
 {
-    for (int i = 0; i < QUANTIDADE_BALAS; i++)
+    std::vector<int> candidatos;
+
+    for (int primeira = 0; primeira < balas.quantidade; primeira += LARGURA_LOTE_BALAS)
     {
-        for (int j = 0; j < QUANTIDADE_ALVOS; j++)
+        if (!candidatos_lote(grade_alvos, balas, primeira, candidatos))
+            continue;
+
+        /* Fase vetorizada: o primeiro alvo atingido por cada bala do lote. */
+        int atingido[LARGURA_LOTE_BALAS];
+        float t_atingido[LARGURA_LOTE_BALAS];
+        for (int k = 0; k < LARGURA_LOTE_BALAS; k++)
         {
-            if (vetor_balas[i].desenhar == true && vetor_alvos[j].dano < MAXIMO_DANO)
+            atingido[k] = -1;
+            t_atingido[k] = 2.0f;
+        }
+
+        for (size_t c = 0; c < candidatos.size(); c++)
+        {
+            int j = candidatos[c];
+            if (vetor_alvos[j].dano >= MAXIMO_DANO)
+                continue;
+
+            glm::vec4 frente_minimo = frente_minimo_alvo(vetor_alvos[j]);
+            int mascara = testa_lote_balas_aabb(balas, primeira, frente_minimo, vetor_alvos[j].bbox_maximo);
+
+            for (int k = 0; mascara != 0; k++, mascara >>= 1)
             {
-                if (vetor_balas[i].x >= vetor_alvos[j].bbox_minimo.x &&
-                    vetor_balas[i].x <= vetor_alvos[j].bbox_maximo.x &&
-                    vetor_balas[i].y >= vetor_alvos[j].bbox_minimo.y &&
-                    vetor_balas[i].y <= vetor_alvos[j].bbox_maximo.y &&
-                    vetor_balas[i].z <= vetor_alvos[j].bbox_maximo.z &&
-                    vetor_balas[i].z >= vetor_alvos[j].bbox_maximo.z-ESPESSURA_ALVOS)
-                    {
-                        vetor_alvos[j].dano += 1;
-                        vetor_balas[i].desenhar = false;
-                    }
+                float t;
+                int i = primeira + k;
+                if ((mascara & 1) &&
+                    intersecta_segmento_aabb(inicio_segmento(balas, i), fim_segmento(balas, i), frente_minimo, vetor_alvos[j].bbox_maximo, t) &&
+                    (t < t_atingido[k] || (t == t_atingido[k] && j < atingido[k])))
+                {
+                    atingido[k] = j;
+                    t_atingido[k] = t;
+                }
             }
         }
+
+        /* Aplicamos os acertos na ordem das balas. Se uma bala anterior do mesmo lote já destruiu
+        o alvo escolhido, procuramos o próximo alvo ao longo do segmento, como no teste bala a bala. */
+        for (int k = 0; k < LARGURA_LOTE_BALAS; k++)
+        {
+            int i = primeira + k;
+            int j = atingido[k];
+            if (j >= 0 && vetor_alvos[j].dano >= MAXIMO_DANO)
+                j = primeiro_alvo(balas, i, vetor_alvos, candidatos);
+            if (j < 0)
+                continue;
+
+            vetor_alvos[j].dano += 1;
+            balas.desenhar[i] = 0;
+            if (vetor_alvos[j].dano >= MAXIMO_DANO)
+                remove_da_grade(grade_alvos, j);
+        }
     }
 }
 
-/* Função com teste de colisão ponto-cubo, responsável por impedir que uma bala seja desenhada, caso atinja um objeto do cenário.*/
-void destroi_balas(Bala vetor_balas[], ObjetoCenario vetor_objetos[]){
-    for (int i = 0; i < QUANTIDADE_BALAS; i++)
+/* Função com teste de colisão segmento-cubo, responsável por impedir que uma bala seja desenhada, caso atinja um objeto do cenário.*/
+void destroi_balas(Balas& balas, ObjetoCenario vetor_objetos[], const GradeColisao& grade_objetos){
+    std::vector<int> candidatos;
+
+    for (int primeira = 0; primeira < balas.quantidade; primeira += LARGURA_LOTE_BALAS)
     {
-        for (int j = 0; j < QUANTIDADE_OBJETOS; j++)
+        if (!candidatos_lote(grade_objetos, balas, primeira, candidatos))
+            continue;
+
+        float t_impacto[LARGURA_LOTE_BALAS];
+        for (int k = 0; k < LARGURA_LOTE_BALAS; k++)
+            t_impacto[k] = 2.0f;
+
+        for (size_t c = 0; c < candidatos.size(); c++)
         {
-            if (vetor_balas[i].desenhar == true)
+            int j = candidatos[c];
+            int mascara = testa_lote_balas_aabb(balas, primeira, vetor_objetos[j].bbox_minimo, vetor_objetos[j].bbox_maximo);
+
+            for (int k = 0; mascara != 0; k++, mascara >>= 1)
             {
-                if (vetor_balas[i].x >= vetor_objetos[j].bbox_minimo.x &&
-                    vetor_balas[i].x <= vetor_objetos[j].bbox_maximo.x &&
-                    vetor_balas[i].y >= vetor_objetos[j].bbox_minimo.y &&
-                    vetor_balas[i].y <= vetor_objetos[j].bbox_maximo.y &&
-                    vetor_balas[i].z >= vetor_objetos[j].bbox_minimo.z &&
-                    vetor_balas[i].z <= vetor_objetos[j].bbox_maximo.z)
-                    {
-                        vetor_balas[i].desenhar = false;
-                        vetor_balas[i].x = 0.0;
-                        vetor_balas[i].y = 0.0;
-                        vetor_balas[i].z = 0.0;
-                    }
+                float t;
+                int i = primeira + k;
+                if ((mascara & 1) && !balas.atingiu_cenario[i] &&
+                    intersecta_segmento_aabb(inicio_segmento(balas, i), fim_segmento(balas, i), vetor_objetos[j].bbox_minimo, vetor_objetos[j].bbox_maximo, t) &&
+                    t < t_impacto[k])
+                    t_impacto[k] = t;
             }
         }
+
+        for (int k = 0; k < LARGURA_LOTE_BALAS; k++)
+        {
+            if (t_impacto[k] > 1.0f)
+                continue;
+
+            /* Recuamos a bala até o ponto de impacto: os testes com alvos e esferas que vêm a seguir
+            só consideram o trecho do caminho anterior ao objeto do cenário. */
+            int i = primeira + k;
+            glm::vec4 inicio = inicio_segmento(balas, i);
+            glm::vec4 impacto = inicio + t_impacto[k]*(fim_segmento(balas, i) - inicio);
+            balas.x[i] = impacto.x;
+            balas.y[i] = impacto.y;
+            balas.z[i] = impacto.z;
+            balas.atingiu_cenario[i] = 1;
+        }
     }
 }
 
-/* Função com teste de colisão ponto-esfera, responsável por verificar se uma esfera do cenário deve ser destruída.*/
-void destroi_esferas(Bala vetor_balas[], Esfera vetor_esferas[])
+/* Função com teste de colisão segmento-esfera, responsável por verificar se uma esfera do cenário deve ser destruída.*/
+void destroi_esferas(Balas& balas, Esfera vetor_esferas[], GradeColisao& grade_esferas)
 {
-    for (int i = 0; i < QUANTIDADE_BALAS; i++)
+    std::vector<int> candidatos;
+
+    for (int primeira = 0; primeira < balas.quantidade; primeira += LARGURA_LOTE_BALAS)
     {
-        for (int j = 0; j < QUANTIDADE_ALVOS; j++)
+        if (!candidatos_lote(grade_esferas, balas, primeira, candidatos))
+            continue;
+
+        int atingida[LARGURA_LOTE_BALAS];
+        float t_atingida[LARGURA_LOTE_BALAS];
+        for (int k = 0; k < LARGURA_LOTE_BALAS; k++)
+        {
+            atingida[k] = -1;
+            t_atingida[k] = 2.0f;
+        }
+
+        for (size_t c = 0; c < candidatos.size(); c++)
         {
-            if (vetor_balas[i].desenhar == true && vetor_esferas[j].dano < MAXIMO_DANO)
+            int j = candidatos[c];
+            if (vetor_esferas[j].dano >= MAXIMO_DANO)
+                continue;
+
+            /* A fase vetorizada usa o cubo que envolve a esfera. */
+            glm::vec4 centro = glm::vec4(vetor_esferas[j].centro_x, vetor_esferas[j].centro_y, vetor_esferas[j].centro_z, 1.0f);
+            glm::vec4 raio = glm::vec4(RAIO_ESFERAS, RAIO_ESFERAS, RAIO_ESFERAS, 0.0f);
+            int mascara = testa_lote_balas_aabb(balas, primeira, centro - raio, centro + raio);
+
+            for (int k = 0; mascara != 0; k++, mascara >>= 1)
             {
-                if (vetor_balas[i].x >= vetor_esferas[j].centro_x-RAIO_ESFERAS &&
-                    vetor_balas[i].x <= vetor_esferas[j].centro_x+RAIO_ESFERAS &&
-                    vetor_balas[i].y >= vetor_esferas[j].centro_y-RAIO_ESFERAS &&
-                    vetor_balas[i].y <= vetor_esferas[j].centro_y+RAIO_ESFERAS &&
-                    vetor_balas[i].z <= vetor_esferas[j].centro_z+RAIO_ESFERAS &&
-                    vetor_balas[i].z >= vetor_esferas[j].centro_z-RAIO_ESFERAS)
-                    {
-                        vetor_esferas[j].dano += 1;
-                        vetor_balas[i].desenhar = false;
-                    }
+                float t;
+                int i = primeira + k;
+                if ((mascara & 1) &&
+                    intersecta_segmento_esfera(inicio_segmento(balas, i), fim_segmento(balas, i), centro, RAIO_ESFERAS, t) &&
+                    (t < t_atingida[k] || (t == t_atingida[k] && j < atingida[k])))
+                {
+                    atingida[k] = j;
+                    t_atingida[k] = t;
+                }
             }
         }
+
+        for (int k = 0; k < LARGURA_LOTE_BALAS; k++)
+        {
+            int i = primeira + k;
+            int j = atingida[k];
+            if (j >= 0 && vetor_esferas[j].dano >= MAXIMO_DANO)
+                j = primeira_esfera(balas, i, vetor_esferas, candidatos);
+            if (j < 0)
+                continue;
+
+            vetor_esferas[j].dano += 1;
+            balas.desenhar[i] = 0;
+            if (vetor_esferas[j].dano >= MAXIMO_DANO)
+                remove_da_grade(grade_esferas, j);
+        }
     }
 }
 
@@ -0,0 +1,99 @@
+// Compressão das texturas do jogo em BC1, antes da primeira execução.
+//
+// Para cada imagem usada pelo jogo, grava o cache "X.texcache" ao lado da
+// imagem (veja LoadTexture() em texture.cpp), com o mesmo tamanho usado pelo
+// jogo (TAMANHO_TEXTURAS em main.cpp) e todos os níveis de mipmap, para que o
+// jogo somente mapeie os caches em memória e os envie para a GPU. Caches já
+// válidos são mantidos. Também imprime, para cada imagem, o tempo gasto, o
+// tamanho da textura em RGB8 e em BC1 e o PSNR do nível 0 comprimido em
+// relação à imagem original reamostrada.
+//
+// Uso: make comprime_texturas
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+#include "texture.h"
+
+#define TAMANHO_TEXTURAS 1024
+
+static const char* ARQUIVOS[] =
+{
+    "data/textura_piso.jpg",
+    "data/textB1!.png",
+    "data/textura_bala.jpg",
+    "data/glocktexture.png",
+    "data/skybox.jpeg",
+    "data/telainicio.jpg",
+    "data/trofeu_textura.png",
+    "data/skybox_trofeu.jpg",
+    "data/WoodenCrate_Crate_BaseColor.png",
+    "data/barreira.jpg",
+    "data/PalletPlywood_Base_Color.png",
+};
+
+/* PSNR, em dB, do nível 0 da textura comprimida em relação à imagem original. */
+static double psnr(const char* arquivo, const TextureData& comprimida)
+{
+    LoadedImage imagem;
+    DecodeImage(arquivo, imagem);
+    ResizeImage(imagem, TAMANHO_TEXTURAS, TAMANHO_TEXTURAS);
+
+    /* Mesma orientação usada por LoadTexture(). */
+    std::vector<unsigned char> original((size_t)TAMANHO_TEXTURAS * TAMANHO_TEXTURAS * 4);
+    ExpandImageRGBA(imagem, true, original.data());
+    FreeDecodedImage(imagem);
+
+    std::vector<unsigned char> descomprimida(original.size());
+    DecompressBC1(comprimida.data, TAMANHO_TEXTURAS, TAMANHO_TEXTURAS, descomprimida.data());
+
+    /* Somente os canais RGB; o alfa é sempre 255. */
+    double soma = 0.0;
+    for (size_t i = 0; i < descomprimida.size(); i++)
+    {
+        if (i % 4 == 3)
+            continue;
+        double diferenca = (double)descomprimida[i] - original[i];
+        soma += diferenca * diferenca;
+    }
+
+    double mse = soma / (descomprimida.size() / 4 * 3);
+    return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+int main()
+{
+    size_t total_rgb8 = 0;
+    size_t total_bc1 = 0;
+
+    printf("%-45s %12s %10s %10s %8s\n", "arquivo", "tempo", "RGB8", "BC1", "PSNR");
+    for (size_t k = 0; k < sizeof(ARQUIVOS)/sizeof(ARQUIVOS[0]); k++)
+    {
+        FILE* teste = fopen(ARQUIVOS[k], "rb");
+        if (teste == NULL)
+        {
+            printf("%-45s (arquivo ausente)\n", ARQUIVOS[k]);
+            continue;
+        }
+        fclose(teste);
+
+        TextureData textura;
+        LoadTexture(ARQUIVOS[k], TAMANHO_TEXTURAS, TEXTURE_FORMAT_BC1, textura);
+
+        size_t rgb8 = 0;
+        for (size_t i = 0; i < textura.levels.size(); i++)
+            rgb8 += TextureLevelSize(TEXTURE_FORMAT_RGB8, textura.levels[i].width, textura.levels[i].height);
+        total_rgb8 += rgb8;
+        total_bc1 += textura.size;
+
+        printf("%-45s %9.1f ms %7.1f MB %7.1f MB %5.1f dB%s\n", ARQUIVOS[k], 1000.0*textura.load_time,
+               rgb8/1048576.0, textura.size/1048576.0, psnr(ARQUIVOS[k], textura),
+               textura.from_cache ? " (cache ja existia)" : "");
+        UnloadTexture(textura);
+    }
+    printf("%-45s %12s %7.1f MB %7.1f MB\n", "total", "", total_rgb8/1048576.0, total_bc1/1048576.0);
+
+    return 0;
+}
@@ -0,0 +1,340 @@
+// Simulação do jogo sem janela e sem contexto OpenGL.
+//
+// Executa a mesma lógica do jogo (alvos, esferas, balas, colisões e fim de jogo,
+// veja simulation.cpp) em passos fixos de PASSO_SIMULACAO segundos, com a entrada
+// do jogador lida de um roteiro em vez do teclado e do mouse, e imprime quantos
+// passos por segundo foram executados. Serve para testes de carga e de regressão
+// em máquinas sem tela ou sem GPU: além do desempenho, imprime o estado final e
+// uma assinatura dele, que deve ser a mesma em todas as execuções com o mesmo
+// roteiro e o mesmo número de passos.
+//
+// Das malhas, somente as bounding boxes são lidas (com a tinyobjloader), para que
+// as colisões com o cenário sejam as mesmas do jogo.
+//
+// Uso: headless [passos] [roteiro]
+//
+// O roteiro é um arquivo texto com uma linha por trecho:
+//
+//     <passos> <teclas> [theta phi]
+//
+// onde <teclas> é qualquer combinação de W, A, S e D (movimento) e F (dispara no
+// primeiro passo do trecho), ou "-" para nenhuma tecla. theta e phi são os ângulos
+// da câmera, como g_CameraTheta e g_CameraPhi em main.cpp, e valem até serem
+// alterados. Linhas iniciadas por '#' são ignoradas. O roteiro é repetido até
+// completar o número de passos pedido. Sem roteiro, é usado ROTEIRO_PADRAO.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/geometric.hpp>
+
+#include "tiny_obj_loader.h"
+
+#include "collisions.h"
+#include "simulation.h"
+#include "scene.h"
+
+#define PASSOS_PADRAO 1000000
+#define DIRETORIO_DADOS "../../data/"
+
+/* Valores iniciais de g_CameraTheta, g_CameraPhi e g_CameraDistance em main.cpp. */
+#define THETA_INICIAL 34.6f
+#define PHI_INICIAL 0.0f
+#define DISTANCIA_CAMERA 2.5f
+
+/* Anda pela área inicial atirando nos alvos à frente e nas esferas acima. */
+static const char* ROTEIRO_PADRAO =
+    "60 F 34.6 0.0\n"
+    "60 W\n"
+    "30 AF 34.4 0.05\n"
+    "60 A\n"
+    "30 F 34.8 0.1\n"
+    "60 D\n"
+    "30 DF 34.6 0.6\n"
+    "60 S\n"
+    "30 F 34.2 0.0\n"
+    "30 -\n";
+
+typedef struct
+{
+    int passos;
+    bool frente;
+    bool tras;
+    bool direita;
+    bool esquerda;
+    bool disparar;
+
+    bool muda_camera;
+    float theta;
+    float phi;
+
+} TrechoRoteiro;
+
+static double agora()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::vector<TrechoRoteiro> le_roteiro(std::istream& entrada, const char* nome)
+{
+    std::vector<TrechoRoteiro> roteiro;
+    std::string linha;
+    int numero_linha = 0;
+    while (std::getline(entrada, linha))
+    {
+        numero_linha++;
+        if (!linha.empty() && linha[linha.size()-1] == '\r')
+            linha.erase(linha.size()-1);
+        if (linha.empty() || linha[0] == '#')
+            continue;
+
+        std::istringstream campos(linha);
+        TrechoRoteiro trecho = TrechoRoteiro();
+        std::string teclas;
+        if (!(campos >> trecho.passos >> teclas) || trecho.passos <= 0)
+        {
+            fprintf(stderr, "ERROR: %s:%d: linha invalida no roteiro: \"%s\".\n", nome, numero_linha, linha.c_str());
+            std::exit(EXIT_FAILURE);
+        }
+
+        for (size_t i = 0; i < teclas.size(); i++)
+        {
+            switch (teclas[i])
+            {
+                case 'W': case 'w': trecho.frente = true; break;
+                case 'S': case 's': trecho.tras = true; break;
+                case 'D': case 'd': trecho.direita = true; break;
+                case 'A': case 'a': trecho.esquerda = true; break;
+                case 'F': case 'f': trecho.disparar = true; break;
+                case '-': break;
+                default:
+                    fprintf(stderr, "ERROR: %s:%d: tecla desconhecida '%c' no roteiro.\n", nome, numero_linha, teclas[i]);
+                    std::exit(EXIT_FAILURE);
+            }
+        }
+
+        if (campos >> trecho.theta >> trecho.phi)
+            trecho.muda_camera = true;
+
+        roteiro.push_back(trecho);
+    }
+
+    if (roteiro.empty())
+    {
+        fprintf(stderr, "ERROR: roteiro \"%s\" vazio.\n", nome);
+        std::exit(EXIT_FAILURE);
+    }
+    return roteiro;
+}
+
+/* Vetores "view", "u" e "w" da câmera em primeira pessoa, calculados como em main.cpp. */
+static void orienta_camera(EntradaSimulacao& entrada, float theta, float phi)
+{
+    glm::vec4 view = DISTANCIA_CAMERA*glm::vec4(cosf(phi)*sinf(theta), sinf(phi), cosf(phi)*cosf(theta), 0.0f);
+    glm::vec3 w = -glm::normalize(glm::vec3(view));
+    glm::vec3 u = glm::normalize(glm::cross(glm::vec3(0.0f,1.0f,0.0f), w));
+    entrada.direcao_camera = view;
+    entrada.vetor_w = glm::vec4(w, 0.0f);
+    entrada.vetor_u = glm::vec4(u, 0.0f);
+}
+
+/* Bounding box local do objeto "nome" do arquivo OBJ, calculada como em BuildTrianglesAndAddToVirtualScene(). */
+static void carrega_bbox_modelo(const char* arquivo, const char* nome, glm::vec4& bbox_minimo, glm::vec4& bbox_maximo)
+{
+    std::string caminho = std::string(DIRETORIO_DADOS) + arquivo;
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string err;
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, caminho.c_str(), DIRETORIO_DADOS, true))
+    {
+        fprintf(stderr, "ERROR: nao foi possivel carregar \"%s\".\n%s\n", caminho.c_str(), err.c_str());
+        std::exit(EXIT_FAILURE);
+    }
+
+    for (size_t shape = 0; shape < shapes.size(); shape++)
+    {
+        if (shapes[shape].name != nome)
+            continue;
+
+        glm::vec3 minimo = glm::vec3(FLT_MAX);
+        glm::vec3 maximo = glm::vec3(-FLT_MAX);
+        const std::vector<tinyobj::index_t>& indices = shapes[shape].mesh.indices;
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            const float* vertice = &attrib.vertices[3*indices[i].vertex_index];
+            glm::vec3 ponto = glm::vec3(vertice[0], vertice[1], vertice[2]);
+            minimo = glm::min(minimo, ponto);
+            maximo = glm::max(maximo, ponto);
+        }
+        bbox_minimo = glm::vec4(minimo, 1.0f);
+        bbox_maximo = glm::vec4(maximo, 1.0f);
+        return;
+    }
+
+    fprintf(stderr, "ERROR: objeto \"%s\" nao encontrado em \"%s\".\n", nome, caminho.c_str());
+    std::exit(EXIT_FAILURE);
+}
+
+/* Assinatura FNV-1a do estado final, para comparar execuções. */
+static unsigned int assinatura(unsigned int hash, const void* dados, size_t tamanho)
+{
+    const unsigned char* bytes = (const unsigned char*)dados;
+    for (size_t i = 0; i < tamanho; i++)
+        hash = (hash ^ bytes[i])*16777619u;
+    return hash;
+}
+
+static unsigned int assinatura_estado(const EstadoSimulacao& estado)
+{
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < QUANTIDADE_ALVOS; i++)
+    {
+        hash = assinatura(hash, &estado.alvos[i].x, sizeof(float));
+        hash = assinatura(hash, &estado.alvos[i].z, sizeof(float));
+        hash = assinatura(hash, &estado.alvos[i].dano, sizeof(estado.alvos[i].dano));
+    }
+    for (int i = 0; i < QUANTIDADE_ESFERAS; i++)
+    {
+        hash = assinatura(hash, &estado.esferas[i].centro_x, sizeof(float));
+        hash = assinatura(hash, &estado.esferas[i].dano, sizeof(estado.esferas[i].dano));
+    }
+    for (int i = 0; i < estado.balas.quantidade; i++)
+    {
+        hash = assinatura(hash, &estado.balas.desenhar[i], sizeof(estado.balas.desenhar[i]));
+        hash = assinatura(hash, &estado.balas.x[i], sizeof(float));
+        hash = assinatura(hash, &estado.balas.y[i], sizeof(float));
+        hash = assinatura(hash, &estado.balas.z[i], sizeof(float));
+    }
+    hash = assinatura(hash, &estado.posicao_jogador, sizeof(estado.posicao_jogador));
+    return hash;
+}
+
+int main(int argc, char* argv[])
+{
+    long long total_passos = PASSOS_PADRAO;
+    if (argc > 1)
+    {
+        total_passos = atoll(argv[1]);
+        if (total_passos <= 0)
+        {
+            fprintf(stderr, "ERROR: numero de passos invalido: \"%s\".\nUso: %s [passos] [roteiro]\n", argv[1], argv[0]);
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    std::vector<TrechoRoteiro> roteiro;
+    if (argc > 2)
+    {
+        std::ifstream arquivo(argv[2]);
+        if (!arquivo)
+        {
+            fprintf(stderr, "ERROR: nao foi possivel abrir o roteiro \"%s\".\n", argv[2]);
+            std::exit(EXIT_FAILURE);
+        }
+        roteiro = le_roteiro(arquivo, argv[2]);
+    }
+    else
+    {
+        std::istringstream padrao(ROTEIRO_PADRAO);
+        roteiro = le_roteiro(padrao, "ROTEIRO_PADRAO");
+    }
+
+    // Bounding boxes locais dos modelos, das quais são derivadas as do cenário e as dos alvos.
+    glm::vec4 bbox_minimo_modelos[QUANTIDADE_MODELOS_CENARIO];
+    glm::vec4 bbox_maximo_modelos[QUANTIDADE_MODELOS_CENARIO];
+    for (int i = 0; i < QUANTIDADE_MODELOS_CENARIO; i++)
+        carrega_bbox_modelo(ARQUIVO_MODELOS_CENARIO[i], NOME_MODELOS_CENARIO[i], bbox_minimo_modelos[i], bbox_maximo_modelos[i]);
+
+    std::vector<ItemEstatico> itens;
+    ObjetoCenario vetor_objetos[QUANTIDADE_OBJETOS];
+    monta_cena_estatica(itens);
+    calcula_bboxes_cenario(itens, bbox_minimo_modelos, bbox_maximo_modelos, vetor_objetos);
+
+    EstadoSimulacao estado;
+    carrega_bbox_modelo("poligono1.obj", "Cube", estado.bbox_minimo_alvo, estado.bbox_maximo_alvo);
+    estado.bbox_minimo_alvo.w = 0.0f;
+    estado.bbox_maximo_alvo.w = 0.0f;
+    inicializa_simulacao(estado, glm::vec4(0.0f,0.55f,4.5f,1.0f));
+    constroi_cenario_simulacao(estado, vetor_objetos);
+
+    EntradaSimulacao entrada;
+    orienta_camera(entrada, THETA_INICIAL, PHI_INICIAL);
+
+    long long passo_fim_jogo = -1;
+    long long disparos = 0;
+    size_t trecho = 0;
+    int passos_trecho = 0;
+
+    double inicio = agora();
+    for (long long passo = 0; passo < total_passos; passo++)
+    {
+        const TrechoRoteiro& atual = roteiro[trecho];
+        if (passos_trecho == 0)
+        {
+            entrada.frente = atual.frente;
+            entrada.tras = atual.tras;
+            entrada.direita = atual.direita;
+            entrada.esquerda = atual.esquerda;
+            entrada.disparar = atual.disparar;
+            if (atual.muda_camera)
+                orienta_camera(entrada, atual.theta, atual.phi);
+            if (atual.disparar)
+                disparos++;
+        }
+
+        passo_simulacao(estado, entrada, PASSO_SIMULACAO);
+
+        if (estado.fim_jogo && passo_fim_jogo < 0)
+            passo_fim_jogo = passo + 1;
+
+        if (++passos_trecho == atual.passos)
+        {
+            passos_trecho = 0;
+            trecho = (trecho + 1) % roteiro.size();
+        }
+    }
+    double duracao = agora() - inicio;
+
+    int alvos_atingidos = 0;
+    for (int i = 0; i < QUANTIDADE_ALVOS; i++)
+        if (estado.alvos[i].dano >= MAXIMO_DANO)
+            alvos_atingidos++;
+
+    int esferas_atingidas = 0;
+    for (int i = 0; i < QUANTIDADE_ESFERAS; i++)
+        if (estado.esferas[i].dano >= MAXIMO_DANO)
+            esferas_atingidas++;
+
+    int balas_ativas = 0;
+    for (int i = 0; i < estado.balas.quantidade; i++)
+        if (estado.balas.desenhar[i])
+            balas_ativas++;
+
+    printf("Passos:            %lld (%.1f s de jogo a %d Hz), %lld disparos\n",
+           total_passos, total_passos*PASSO_SIMULACAO, FREQUENCIA_SIMULACAO, disparos);
+    printf("Tempo:             %.3f s\n", duracao);
+    printf("Desempenho:        %.0f passos/s (%.3f us por passo)\n", total_passos/duracao, 1e6*duracao/total_passos);
+    printf("Alvos atingidos:   %d de %d\n", alvos_atingidos, QUANTIDADE_ALVOS);
+    printf("Esferas atingidas: %d de %d\n", esferas_atingidas, QUANTIDADE_ESFERAS);
+    printf("Balas ativas:      %d\n", balas_ativas);
+    if (passo_fim_jogo >= 0)
+        printf("Fim de jogo:       passo %lld\n", passo_fim_jogo);
+    else
+        printf("Fim de jogo:       nao alcancado\n");
+    printf("Jogador:           (%.3f, %.3f, %.3f)\n", estado.posicao_jogador.x, estado.posicao_jogador.y, estado.posicao_jogador.z);
+    printf("Assinatura:        %08x\n", assinatura_estado(estado));
+
+    return 0;
+}
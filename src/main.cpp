@@ -16,8 +16,10 @@
 //    #include <cstdio> // Em C++
 //
 #include <cmath>
+#include <cstddef>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 // Headers abaixo são específicos de C++
 #include <map>
@@ -37,6 +39,7 @@
 // Headers da biblioteca GLM: criação de matrizes e vetores.
 #include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
+#include <glm/matrix.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 // Headers da biblioteca para carregar modelos obj
@@ -49,63 +52,10 @@
 #include "matrices.h"
 
 #include "collisions.h"
-
-// Estrutura que representa um modelo geométrico carregado a partir de um
-// arquivo ".obj". Veja https://en.wikipedia.org/wiki/Wavefront_.obj_file .
-struct ObjModel
-{
-    tinyobj::attrib_t                 attrib;
-    std::vector<tinyobj::shape_t>     shapes;
-    std::vector<tinyobj::material_t>  materials;
-
-    // Este construtor lê o modelo de um arquivo utilizando a biblioteca tinyobjloader.
-    // Veja: https://github.com/syoyo/tinyobjloader
-    ObjModel(const char* filename, const char* basepath = NULL, bool triangulate = true)
-    {
-        printf("Carregando objetos do arquivo \"%s\"...\n", filename);
-
-        // Se basepath == NULL, então setamos basepath como o dirname do
-        // filename, para que os arquivos MTL sejam corretamente carregados caso
-        // estejam no mesmo diretório dos arquivos OBJ.
-        std::string fullpath(filename);
-        std::string dirname;
-        if (basepath == NULL)
-        {
-            auto i = fullpath.find_last_of("/");
-            if (i != std::string::npos)
-            {
-                dirname = fullpath.substr(0, i+1);
-                basepath = dirname.c_str();
-            }
-        }
-
-        std::string err;
-        bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filename, basepath, triangulate);
-
-        if (!err.empty())
-            fprintf(stderr, "\n%s\n", err.c_str());
-
-        if (!ret)
-            throw std::runtime_error("Erro ao carregar modelo.");
-
-        for (size_t shape = 0; shape < shapes.size(); ++shape)
-        {
-            if (shapes[shape].name.empty())
-            {
-                fprintf(stderr,
-                        "*********************************************\n"
-                        "Erro: Objeto sem nome dentro do arquivo '%s'.\n"
-                        "Veja https://www.inf.ufrgs.br/~eslgastal/fcg-faq-etc.html#Modelos-3D-no-formato-OBJ .\n"
-                        "*********************************************\n",
-                    filename);
-                throw std::runtime_error("Objeto sem nome.");
-            }
-            printf("- Objeto '%s'\n", shapes[shape].name.c_str());
-        }
-
-        printf("OK.\n");
-    }
-};
+#include "simulation.h"
+#include "scene.h"
+#include "mesh.h"
+#include "assets.h"
 
 // Declaração de funções utilizadas para pilha de matrizes de modelagem.
 void PushMatrix(glm::mat4 M);
@@ -113,11 +63,31 @@ void PopMatrix(glm::mat4& M);
 
 // Declaração de várias funções utilizadas em main().  Essas estão definidas
 // logo após a definição de main() neste arquivo.
-void BuildTrianglesAndAddToVirtualScene(ObjModel*); // Constrói representação de um ObjModel como malha de triângulos para renderização
-void ComputeNormals(ObjModel* model); // Computa normais de um ObjModel, caso não existam.
+int BuildTrianglesAndAddToVirtualScene(ObjModel*, unsigned int vertex_format = VERTEX_FORMAT_DEFAULT); // Constrói representação de um ObjModel como malha de triângulos para renderização
+int AddMeshToVirtualScene(const MeshArrays& mesh, const PackedVertices& vertices); // Envia os vértices de uma malha para a GPU e inclui os seus objetos na cena virtual
 void LoadShadersFromFiles(); // Carrega os shaders de vértice e fragmento, criando um programa de GPU
-void LoadTextureImage(const char* filename); // Função que carrega imagens de textura
-void DrawVirtualObject(const char* object_name); // Desenha um objeto armazenado em g_VirtualScene
+GLuint CreateCameraUniformBuffer(); // Cria um uniform buffer object com os dados de uma câmera
+void UploadCameraUniforms(GLuint buffer, const glm::mat4& view, const glm::mat4& projection); // Atualiza os dados de câmera de um uniform buffer object
+bool HasOpenGLExtension(const char* name); // Verifica se o driver oferece uma extensão da OpenGL
+void CreateTextureArray(int size, int num_layers, int format); // Cria o array de texturas usado por todos os materiais
+void CreateTextureStreamer(int num_textures, int format, int budget_mb, int min_layers); // Cria o array de texturas com as camadas que cabem no orçamento
+void SetStreamedTexture(int texture, TextureData& data); // Entrega ao streaming uma textura já carregada
+void RequestTextures(const int* textures, int num_textures); // Marca texturas como usadas neste quadro, tornando-as residentes
+void UpdateTextureStreaming(); // Envia para a GPU os níveis de mipmap pendentes das texturas em uso
+void PrintTextureStreamingReport(); // Estatísticas de residência das texturas
+void CreateMaterialBuffer(const struct Material* materials, int num_materials); // Envia a tabela de materiais para a GPU
+void UpdateMaterialBuffer(); // Atualiza as camadas e os níveis de mipmap da tabela de materiais na GPU
+int GetVirtualObject(const char* object_name); // Retorna o handle de um objeto de g_VirtualScene a partir do seu nome
+void DrawVirtualObject(int object_handle); // Desenha um objeto armazenado em g_VirtualScene
+void SetModelUniforms(const glm::mat4& model); // Envia as matrizes de modelagem e das normais de um desenho não instanciado
+void EnableInstancing(int object_handle); // Cria o buffer de matrizes por instância de um objeto
+void UploadInstances(int object_handle, const std::vector<glm::mat4>& models); // Envia as matrizes por instância de um objeto para a GPU
+void QueueVirtualObject(int object_handle, int object_id, const glm::mat4& model, unsigned int flags = 0); // Inclui o desenho de um objeto na fila de desenho
+void QueueVirtualObjectInstanced(int object_handle, int object_id, size_t num_instances, size_t first_instance = 0, unsigned int flags = 0); // Inclui várias instâncias de um objeto na fila de desenho
+void SubmitRenderQueue(); // Desenha os objetos da fila de desenho, ordenados para minimizar as trocas de estado
+int SelectLevelOfDetail(int object_handle, const glm::mat4& model); // Escolhe o nível de detalhe de um objeto de acordo com o seu tamanho na tela
+void ExtractFrustumPlanes(const glm::mat4& projection_view); // Calcula os planos do frustum de visualização da câmera
+bool IsObjectVisible(int object_handle, const glm::mat4& model); // Testa a bounding box de um objeto contra o frustum de visualização
 GLuint LoadShader_Vertex(const char* filename);   // Carrega um vertex shader
 GLuint LoadShader_Fragment(const char* filename); // Carrega um fragment shader
 void LoadShader(const char* filename, GLuint shader_id); // Função utilizada pelas duas acima
@@ -130,6 +100,7 @@ void TextRendering_Init();
 float TextRendering_LineHeight(GLFWwindow* window);
 float TextRendering_CharWidth(GLFWwindow* window);
 void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f);
+void TextRendering_Flush(); // Desenha todos os textos do quadro de uma só vez
 void TextReFndering_PrintMatrix(GLFWwindow* window, glm::mat4 M, float x, float y, float scale = 1.0f);
 void TextRendering_PrintVector(GLFWwindow* window, glm::vec4 vF, float x, float y, float scale = 1.0f);
 void TextRendering_PrintMatrixVectorProduct(GLFWwindow* window, glm::mat4 M, glm::vec4 v, float x, float y, float scale = 1.0f);
@@ -163,15 +134,33 @@ struct SceneObject
     GLuint       vertex_array_object_id; // ID do VAO onde estão armazenados os atributos do modelo
     glm::vec3    bbox_min; // Axis-Aligned Bounding Box do objeto
     glm::vec3    bbox_max;
+    GLuint       instance_buffer_id = 0; // ID do VBO com os InstanceData por instância. Veja EnableInstancing()
+    size_t       instance_capacity = 0; // Número de instâncias que cabem no VBO acima
+    int          num_lods = 0;       // Número de níveis de detalhe, que ocupam os handles seguintes. Veja SelectLevelOfDetail()
+    float        lod_error = 0.0f;   // Nos níveis de detalhe: distância máxima até o objeto original, nas coordenadas do modelo
+};
+
+// Dados de cada instância no buffer de instâncias de um objeto: a matriz de
+// modelagem e a matriz das normais (veja Matrix_Normal() em matrices.h), que
+// é calculada uma vez por instância em UploadInstances().
+struct InstanceData
+{
+    glm::mat4 model;
+    glm::mat3 normal_matrix;
 };
 
 // Abaixo definimos variáveis globais utilizadas em várias funções do código.
 
-// A cena virtual é uma lista de objetos nomeados, guardados em um dicionário
-// (map).  Veja dentro da função BuildTrianglesAndAddToVirtualScene() como que são incluídos
-// objetos dentro da variável g_VirtualScene, e veja na função main() como
-// estes são acessados.
-std::map<std::string, SceneObject> g_VirtualScene;
+// A cena virtual é uma lista de objetos guardados em um vetor. Cada objeto é
+// identificado pelo seu índice no vetor (handle), que nunca muda depois que o
+// objeto é incluído. Veja dentro da função BuildTrianglesAndAddToVirtualScene()
+// como que são incluídos objetos dentro da variável g_VirtualScene, e veja na
+// função main() como os handles são obtidos a partir dos nomes, uma única vez.
+std::vector<SceneObject> g_VirtualScene;
+
+// Dicionário (map) que associa o nome de cada objeto ao seu handle. Usado
+// somente durante o carregamento, pela função GetVirtualObject().
+std::map<std::string, int> g_VirtualSceneHandles;
 
 // Pilha que guardará as matrizes de modelagem.
 std::stack<glm::mat4>  g_MatrixStack;
@@ -179,6 +168,62 @@ std::stack<glm::mat4>  g_MatrixStack;
 // Razão de proporção da janela (largura/altura). Veja função FramebufferSizeCallback().
 float g_ScreenRatio = 1.0f;
 
+// Altura da janela, em pixels. Veja função FramebufferSizeCallback().
+int g_ScreenHeight = 1;
+
+// Estado da câmera usado por SelectLevelOfDetail(), atualizado a cada quadro
+// junto com a matriz de projeção. Na projeção perspectiva, g_LodPixelsPerUnit é
+// o número de pixels ocupados por uma unidade de comprimento à distância 1 da
+// câmera; na ortográfica, a qualquer distância.
+#define LOD_MAX_PIXEL_ERROR 1.0f // Maior erro, em pixels, aceito ao trocar um objeto por um nível de detalhe
+glm::vec4 g_LodCameraPosition = glm::vec4(0.0f,0.0f,0.0f,1.0f);
+float     g_LodPixelsPerUnit = 1.0f;
+bool      g_LodPerspective = true;
+
+// Planos do frustum de visualização, no sistema de coordenadas do mundo,
+// extraídos a cada quadro da matriz "projection * view" por
+// ExtractFrustumPlanes(). Cada plano é guardado como (a,b,c,d), com a normal
+// (a,b,c) apontando para dentro do frustum. Os contadores abaixo são zerados
+// junto com os planos e indicam quantos objetos (ou instâncias) testados por
+// IsObjectVisible() no quadro foram enviados para a GPU ou descartados.
+glm::vec4 g_FrustumPlanes[6];
+int       g_ObjectsSubmitted = 0;
+int       g_ObjectsCulled = 0;
+
+// Fila de desenho. As funções desenha_*() não desenham diretamente: elas
+// incluem os objetos na fila com QueueVirtualObject() e
+// QueueVirtualObjectInstanced(), e SubmitRenderQueue() desenha a fila
+// ordenada pela chave de cada item. A chave agrupa os desenhos que usam o
+// mesmo estado da OpenGL (primeiro os bits RENDER_*, depois o VAO, o
+// "object_id" do shader, que escolhe as texturas, e o objeto, que define a
+// bounding box) e, dentro de cada grupo, ordena os objetos da frente para
+// trás, para que o teste de profundidade descarte mais fragmentos.
+#define RENDER_NO_CULL_FACE 1 // Desenha sem backface culling (objetos vistos por dentro ou abertos)
+#define RENDER_BACKGROUND   2 // Desenha depois de todos os outros objetos (skybox)
+#define RENDER_DEPTH_RANGE  64.0f // Distâncias até a câmera maiores que esta ficam com a mesma chave
+
+struct RenderItem
+{
+    uint64_t     key;
+    int          object_handle;
+    int          object_id;      // Valor da variável "object_id" do shader (PLANE, ALVO, ...)
+    unsigned int flags;          // Bits RENDER_*
+    glm::mat4    model;          // Somente nos desenhos não instanciados
+    size_t       num_instances;  // 0 nos desenhos não instanciados
+    size_t       first_instance;
+};
+
+std::vector<RenderItem> g_RenderQueue;
+
+// Estatísticas da fila de desenho, acumuladas por SubmitRenderQueue() e
+// zeradas a cada quadro em main(): número de desenhos, de trocas de estado
+// (VAO, uniforms, backface culling, atributos por instância) efetivamente
+// feitas, e de trocas economizadas pela ordenação, isto é, a diferença para
+// as trocas da mesma fila na ordem em que os objetos foram incluídos.
+int g_RenderDraws = 0;
+int g_RenderStateChanges = 0;
+int g_RenderStateChangesSaved = 0;
+
 // Ângulos de Euler que controlam a rotação de um dos cubos da cena virtual
 float g_AngleX = 0.0f;
 float g_AngleY = 0.0f;
@@ -221,51 +266,16 @@ int tecla_A_pressionada = 0;
 int tecla_S_pressionada = 0;
 int tecla_D_pressionada = 0;
 
-#define VELOCIDADE_CAMERA 2.5
-#define ESPESSURA_JOGADOR 0.25
-
-#define LIMITE_ESQUERDA -15.0
-#define LIMITE_DIREITA 15.0
-#define LIMITE_FUNDO -15.0
-#define LIMITE_FRENTE 15.0
-#define LIMITE_CIMA 15.0
-#define LIMITE_BAIXO -15.0
-
-#define LIMITE_ESQ_ALVO -10.0
-#define LIMITE_DIR_ALVO 10.0
-
-#define LIMITE_ESQ_ESFERA -10.0
-#define LIMITE_DIR_ESFERA 10.0
-
-#define DIRECAO_ESQUERDA 0
-#define DIRECAO_DIREITA 1
-#define ESPESSURA_ALVOS 0.50
-#define VELOCIDADE_ALVOS 3
-#define QUANTIDADE_ALVOS 15
-#define MAXIMO_DANO 1
-
-#define TEMPO_ALVO_BEZIER 2
-#define NUM_ALVOS_NAOLINEARES 11
-
-#define VELOCIDADE_BALAS 6
-#define QUANTIDADE_BALAS 50
-#define ALTURA_BALAS 0.8
-
-#define QUANTIDADE_OBJETOS 12
-
+/* As constantes da simulação (velocidades, limites e quantidades de alvos, balas e
+esferas) ficam em simulation.h e collisions.h. */
 #define TARGET_FPS 60
 
-#define ALTURA_ESFERAS 5.0
-#define QUANTIDADE_ESFERAS 4
-#define VELOCIDADE_ESFERAS 5
-#define RAIO_ESFERAS 0.5
-
 #define PLANE 0
 #define ALVO 1
 #define ARMA 2
 #define BULLET 3
 #define SKYBOX 4
-#define MIRA 255
+#define MIRA 12
 #define TELA_INICIO 5
 #define TROFEU 6
 #define SKYBOX_TROFEU 7
@@ -273,14 +283,48 @@ int tecla_D_pressionada = 0;
 #define BARREIRAS 9
 #define PALETE 10
 #define ESFERA 11
+#define QUANTIDADE_MATERIAIS 13 /* MATERIAL_COUNT em shader_fragment.glsl */
+
+/* Camadas do array de texturas, na ordem dos AddImageJob() em main(). Todas as
+imagens são reamostradas para TAMANHO_TEXTURAS x TAMANHO_TEXTURAS pixels, o
+tamanho da maior parte das imagens do jogo; as maiores (o piso e o troféu) são
+reduzidas, e as menores, ampliadas. */
+#define TEXTURA_PISO 0
+#define TEXTURA_ALVO 1
+#define TEXTURA_BALA 2
+#define TEXTURA_ARMA 3
+#define TEXTURA_SKYBOX 4
+#define TEXTURA_TELA_INICIO 5
+#define TEXTURA_TROFEU 6
+#define TEXTURA_SKYBOX_TROFEU 7
+#define TEXTURA_CAIXA 8
+#define TEXTURA_BARREIRA 9
+#define TEXTURA_PALETE 10
+#define QUANTIDADE_TEXTURAS 11
+#define TAMANHO_TEXTURAS 1024
+
+/* Texturas usadas em cada fase do jogo. As que a fase atual não usa podem ser
+removidas da GPU para dar lugar às dela (veja RequestTextures()). */
+const int texturas_tela_inicio[] = { TEXTURA_TELA_INICIO };
+const int texturas_jogo[] = { TEXTURA_PISO, TEXTURA_ALVO, TEXTURA_BALA, TEXTURA_ARMA, TEXTURA_SKYBOX,
+                              TEXTURA_CAIXA, TEXTURA_BARREIRA, TEXTURA_PALETE };
+const int texturas_fim[] = { TEXTURA_TROFEU, TEXTURA_SKYBOX_TROFEU };
+#define QUANTIDADE(v) ((int)(sizeof(v)/sizeof((v)[0])))
 /* NOVAS VARIÁVEIS GLOBAIS ABAIXO. */
 
 double t_now;
 double t_prev;
-double delta_t;
 
-glm::vec4 bbox_minimo_novo = glm::vec4(0.0f,0.0f,0.0f,0.0f);
-glm::vec4 bbox_maximo_novo = glm::vec4(0.0f,0.0f,0.0f,0.0f);
+/* Handles dos objetos da cena virtual desenhados pelo jogo, obtidos após o carregamento dos modelos. */
+int objeto_plano;
+int objeto_alvo;
+int objeto_bala;
+int objeto_arma;
+int objeto_esfera;
+int objeto_trofeu;
+int objeto_caixa;
+int objeto_barreira;
+int objeto_palete;
 
 /* NOVAS VARIAVEIS GLOBAIS ACIMA */
 
@@ -293,638 +337,377 @@ bool g_ShowInfoText = true;
 // Variáveis que definem um programa de GPU (shaders). Veja função LoadShadersFromFiles().
 GLuint g_GpuProgramID = 0;
 GLint g_model_uniform;
-GLint g_view_uniform;
-GLint g_projection_uniform;
+GLint g_normal_matrix_uniform;
 GLint g_object_id_uniform;
 GLint g_bbox_min_uniform;
 GLint g_bbox_max_uniform;
-
-// Número de texturas carregadas pela função LoadTextureImage()
-GLuint g_NumLoadedTextures = 0;
-
-/* NOVAS FUNÇÕES DO TRABALHO FINAL ABAIXO */
-
-void tela_inicio()
+GLint g_instanced_uniform;
+
+// Dados de câmera compartilhados por "shader_vertex.glsl" e
+// "shader_fragment.glsl" através do bloco de uniforms "Camera", com layout
+// std140: cada mat4 são quatro colunas vec4 consecutivas, e todos os membros
+// ficam alinhados a 16 bytes, o que coincide com a disposição desta
+// estrutura em C++. Há dois uniform buffer objects: o da câmera do jogo,
+// atualizado uma vez por quadro em main(), e o do HUD e da tela inicial, com
+// matrizes identidade, enviado uma única vez. Trocar de um para o outro é
+// um único glBindBufferBase() no ponto CAMERA_UNIFORM_BINDING.
+#define CAMERA_UNIFORM_BINDING 0
+
+struct CameraUniforms
 {
-    glm::mat4 view = Matrix_Identity();
-    glm::mat4 projection = Matrix_Identity();
-    glm::mat4 model = Matrix_Rotate_X(1.570796237f);
-    glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-    glUniformMatrix4fv(g_view_uniform       , 1 , GL_FALSE , glm::value_ptr(view));
-    glUniformMatrix4fv(g_projection_uniform , 1 , GL_FALSE , glm::value_ptr(projection));
-    glUniform1i(g_object_id_uniform, TELA_INICIO);
-    DrawVirtualObject("the_plane");
-}
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 view_inverse;
+    glm::vec4 camera_position; // Origem do sistema de coordenadas da câmera, no mundo
+};
 
-void inicializa_alvos(Alvo vetor_alvos[])
-{
-    vetor_alvos[0].x = 0.0f;
-    vetor_alvos[0].y = 0.5f;
-    vetor_alvos[0].z = 0.0f;
+GLuint g_CameraUniformBuffer = 0;
+GLuint g_HudUniformBuffer = 0;
 
-    vetor_alvos[1].x = -8.0f;
-    vetor_alvos[1].y = 0.5f;
-    vetor_alvos[1].z = 6.0f;
+// Materiais. Todas as texturas ficam nas camadas de um único
+// GL_TEXTURE_2D_ARRAY (veja CreateTextureArray()), amostrado pela variável
+// "TextureArray" de "shader_fragment.glsl" na unidade de textura 0, e o
+// material de cada objeto vem de uma tabela, no bloco de uniforms
+// "Materials" (layout std140), indexada pela variável "object_id". Assim o
+// shader não tem um caso para cada objeto, a unidade de textura nunca muda
+// entre desenhos, e incluir uma nova textura é incluir uma camada e uma
+// entrada na tabela. A camada de cada textura é escolhida pelo streaming de
+// texturas (veja StreamedTexture abaixo). As constantes abaixo são repetidas
+// no shader.
+#define MATERIAL_UNIFORM_BINDING 1
 
-    vetor_alvos[2].x = -8.0f;
-    vetor_alvos[2].y = 0.5f;
-    vetor_alvos[2].z = 8.0f;
+#define MAPPING_TEXCOORDS 0 // Coordenadas de textura do arquivo OBJ
+#define MAPPING_SPHERE    1 // Projeção esférica em torno do centro da bounding box (skybox)
 
-    vetor_alvos[3].x = 3.2f;
-    vetor_alvos[3].y = 0.95f;
-    vetor_alvos[3].z = 11.5f;
+#define SHADING_LAMBERT 0 // Cor difusa vezes o termo de Lambert
+#define SHADING_UNLIT   1 // Somente a cor difusa, sem iluminação
+#define SHADING_GOURAUD 2 // Cor calculada por vértice em "shader_vertex.glsl"
 
-    vetor_alvos[4].x = 1.2f;
-    vetor_alvos[4].y = 0.95f;
-    vetor_alvos[4].z = 11.5f;
+#define NO_TEXTURE -1
 
-    vetor_alvos[5].x = -1.2f;
-    vetor_alvos[5].y = 0.95f;
-    vetor_alvos[5].z = 11.5f;
+struct Material
+{
+    glm::vec4 color;          // Refletância difusa; multiplica a cor da textura, se houver
+    int32_t   texture_layer;  // Na tabela do jogo, a textura; na cópia da GPU, a sua camada do array de texturas. NO_TEXTURE se não houver
+    int32_t   mapping;        // MAPPING_*
+    int32_t   shading;        // SHADING_*
+    float     min_lod;        // Nível de mipmap mais detalhado já enviado para a GPU (preenchido por UpdateMaterialBuffer())
+};
 
-    vetor_alvos[6].x = -3.2f;
-    vetor_alvos[6].y = 0.95f;
-    vetor_alvos[6].z = 11.5f;
+// As texturas são comprimidas em BC1 (veja texture.h) quando o driver oferece
+// a extensão GL_EXT_texture_compression_s3tc, que não faz parte do núcleo da
+// OpenGL 3.3 e por isso não é declarada por glad.h. Sem ela, ficam em RGB8.
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+
+GLuint g_TextureArray = 0;
+int g_TextureArrayFormat = TEXTURE_FORMAT_RGB8;
+int g_TextureArraySize = 0; // Largura e altura do nível 0 das camadas
+GLuint g_MaterialUniformBuffer = 0;
+std::vector<Material> g_Materials; // Tabela de materiais, com as texturas (e não as camadas) de cada material
+
+// Streaming de texturas. Todas as texturas ficam na memória principal (ou nos
+// seus caches mapeados em memória), mas somente as usadas pela fase atual do
+// jogo ficam na GPU: o array de texturas tem somente as camadas que cabem em
+// TEXTURE_BUDGET_MB, e cada textura ocupa uma camada enquanto é usada. Quando
+// uma textura é pedida (RequestTextures()) e não está residente, ela recebe
+// uma camada livre ou a da textura há mais tempo sem uso, e os seus níveis de
+// mipmap menores são enviados imediatamente; os maiores são enviados depois,
+// do menos para o mais detalhado, até TEXTURE_STREAMING_BYTES_PER_FRAME por
+// quadro, através de pixel buffer objects (UpdateTextureStreaming()). Até lá,
+// o shader usa o nível mais detalhado já enviado (Material::min_lod).
+#define TEXTURE_BUDGET_MB                 24              // Memória de vídeo para o array de texturas
+#define TEXTURE_STREAMING_BYTES_PER_FRAME (2*1024*1024)   // Pelo menos um nível é enviado por quadro, mesmo se maior
+#define TEXTURE_STREAMING_MIN_SIZE        64              // Níveis até este tamanho são enviados assim que a textura é pedida
+#define TEXTURE_STREAMING_BUFFERS         3               // PBOs usados em rodízio
+
+struct StreamedTexture
+{
+    TextureData data;               // Todos os níveis de mipmap (veja LoadTexture() em texture.cpp)
+    int         first_level = 0;    // Nível de "data" enviado ao nível 0 do array (os maiores não cabem nas camadas)
+    int         layer = -1;         // Camada do array de texturas, ou -1 se a textura não está residente
+    int         resident_level = 0; // Nível de "data" mais detalhado já enviado; data.levels.size() se nenhum
+    long long   requested_frame = -1; // Último quadro em que a textura foi pedida
+};
 
-    vetor_alvos[7].x = -2.8f;
-    vetor_alvos[7].y = 0.5f;
-    vetor_alvos[7].z = 1.0f;
+std::vector<StreamedTexture> g_StreamedTextures;
+std::vector<int> g_TextureLayers; // Textura em cada camada do array de texturas, ou -1
+GLuint g_TextureUploadBuffers[TEXTURE_STREAMING_BUFFERS];
+int g_NextTextureUploadBuffer = 0;
+long long g_TextureFrame = 0;
 
-    vetor_alvos[8].x = -1.0f;
-    vetor_alvos[8].y = 0.5f;
-    vetor_alvos[8].z = -1.9f;
+// Estatísticas do streaming de texturas (veja PrintTextureStreamingReport())
+long long g_TextureLoads = 0;         // Vezes em que uma textura não residente recebeu uma camada
+long long g_TextureEvictions = 0;     // Vezes em que uma textura perdeu a sua camada para outra
+long long g_TextureFailedRequests = 0; // Pedidos sem camada disponível (orçamento menor que as texturas de uma fase)
+long long g_TextureLevelsStreamed = 0;
+size_t g_TextureBytesDirect = 0;      // Bytes enviados diretamente, quando a textura é pedida
+size_t g_TextureBytesStreamed = 0;    // Bytes enviados através dos PBOs
 
-    vetor_alvos[9].x = 0.1f;
-    vetor_alvos[9].y = 0.5f;
-    vetor_alvos[9].z = -1.9f;
+/* NOVAS FUNÇÕES DO TRABALHO FINAL ABAIXO */
 
-    vetor_alvos[10].x = 2.4f;
-    vetor_alvos[10].y = 0.5f;
-    vetor_alvos[10].z = -1.6f;
+/* Material de cada objeto desenhado pelo jogo, na posição do seu identificador (object_id).
+O alvo e a tela inicial têm texturas escuras, que são clareadas pela cor do material. */
+const Material tabela_materiais[QUANTIDADE_MATERIAIS] =
+{
+    /* PLANE */         { glm::vec4(1.0f,1.0f,1.0f,1.0f),       TEXTURA_PISO,          MAPPING_TEXCOORDS, SHADING_LAMBERT, 0 },
+    /* ALVO */          { glm::vec4(100.0f,100.0f,100.0f,1.0f), TEXTURA_ALVO,          MAPPING_TEXCOORDS, SHADING_LAMBERT, 0 },
+    /* ARMA */          { glm::vec4(1.0f,1.0f,1.0f,1.0f),       TEXTURA_ARMA,          MAPPING_TEXCOORDS, SHADING_LAMBERT, 0 },
+    /* BULLET */        { glm::vec4(1.0f,1.0f,1.0f,1.0f),       TEXTURA_BALA,          MAPPING_TEXCOORDS, SHADING_LAMBERT, 0 },
+    /* SKYBOX */        { glm::vec4(1.0f,1.0f,1.0f,1.0f),       TEXTURA_SKYBOX,        MAPPING_SPHERE,    SHADING_UNLIT,   0 },
+    /* TELA_INICIO */   { glm::vec4(100.0f,100.0f,100.0f,1.0f), TEXTURA_TELA_INICIO,   MAPPING_TEXCOORDS, SHADING_LAMBERT, 0 },
+    /* TROFEU */        { glm::vec4(1.0f,1.0f,1.0f,1.0f),       TEXTURA_TROFEU,        MAPPING_TEXCOORDS, SHADING_LAMBERT, 0 },
+    /* SKYBOX_TROFEU */ { glm::vec4(1.0f,1.0f,1.0f,1.0f),       TEXTURA_SKYBOX_TROFEU, MAPPING_SPHERE,    SHADING_UNLIT,   0 },
+    /* CAIXA */         { glm::vec4(1.0f,1.0f,1.0f,1.0f),       TEXTURA_CAIXA,         MAPPING_TEXCOORDS, SHADING_LAMBERT, 0 },
+    /* BARREIRAS */     { glm::vec4(1.0f,1.0f,1.0f,1.0f),       TEXTURA_BARREIRA,      MAPPING_TEXCOORDS, SHADING_LAMBERT, 0 },
+    /* PALETE */        { glm::vec4(1.0f,1.0f,1.0f,1.0f),       TEXTURA_PALETE,        MAPPING_TEXCOORDS, SHADING_LAMBERT, 0 },
+    /* ESFERA */        { glm::vec4(0.8f,0.4f,0.08f,1.0f),      NO_TEXTURE,            MAPPING_TEXCOORDS, SHADING_GOURAUD, 0 },
+    /* MIRA */          { glm::vec4(0.0f,255.0f,0.0f,1.0f),     NO_TEXTURE,            MAPPING_TEXCOORDS, SHADING_LAMBERT, 0 },
+};
 
-     for (int i = NUM_ALVOS_NAOLINEARES; i < QUANTIDADE_ALVOS; i++)
-    {
-        if (i % 2 == 0)
-            vetor_alvos[i].direcao = DIRECAO_DIREITA;
-        else
-            vetor_alvos[i].direcao = DIRECAO_ESQUERDA;
-        vetor_alvos[i].x = 0.0f;
-        vetor_alvos[i].y = 0.5f;
-        vetor_alvos[i].z = -3.0f*(i-NUM_ALVOS_NAOLINEARES);
-    }
+void tela_inicio()
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UNIFORM_BINDING, g_HudUniformBuffer);
+    glm::mat4 model = Matrix_Rotate_X(1.570796237f);
+    SetModelUniforms(model);
+    glUniform1i(g_object_id_uniform, TELA_INICIO);
+    DrawVirtualObject(objeto_plano);
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UNIFORM_BINDING, g_CameraUniformBuffer);
 }
 
 void desenha_chao()
 {
     // Desenhamos o plano do chão
     glm::mat4 model = Matrix_Translate(0.0f,0.0f,0.0f)*Matrix_Scale(20.0f,5.0f,20.0f);
-    glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-    glUniform1i(g_object_id_uniform, PLANE);
-    DrawVirtualObject("the_plane");
+    if (IsObjectVisible(objeto_plano, model))
+        QueueVirtualObject(objeto_plano, PLANE, model);
 }
 
-void desenha_alvos(Alvo vetor_alvos[])
+/* Os alvos são desenhados com uma única chamada instanciada, somente com as instâncias
+que estão dentro do frustum de visualização. As bounding boxes dos alvos usadas nas
+colisões são calculadas pela simulação (veja simulation.cpp). */
+void desenha_alvos(const QuadroSimulacao& quadro)
 {
-    glm::mat4 model = Matrix_Identity(); // Transformação identidade de modelagem
+    static std::vector<glm::mat4> modelos;
+    modelos.clear();
+
     for (int i = 0; i < QUANTIDADE_ALVOS; i++)
     {
-        if (vetor_alvos[i].dano < MAXIMO_DANO)
+        if (quadro.alvo_visivel[i])
         {
-            model = Matrix_Translate(vetor_alvos[i].x,vetor_alvos[i].y,vetor_alvos[i].z)*Matrix_Scale(0.1f,0.1f,0.01f);
-            glm::mat4 model_scale = Matrix_Scale(0.1f,0.1f,0.01f);
-            if(i == 0 || (i>=3 && i<=6)){
-                model = model * Matrix_Rotate_Y(3.14);
-            }
-            else if(i == 1 || i== 2){
-                model =  model * Matrix_Rotate_Y(1.57) * Matrix_Scale(10.0f, 1.0f,0.8f);
-                model_scale = Matrix_Scale(0.1f,0.1f,0.08f);
-            }
-            glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, ALVO);
-            DrawVirtualObject("Cube");
-
-
-            vetor_alvos[i].bbox_minimo = model_scale*bbox_minimo_novo;
-            vetor_alvos[i].bbox_maximo = model_scale*bbox_maximo_novo;
-
-            vetor_alvos[i].bbox_minimo.x += vetor_alvos[i].x;
-            vetor_alvos[i].bbox_minimo.y += vetor_alvos[i].y;
-            vetor_alvos[i].bbox_minimo.z += vetor_alvos[i].z;
-
-            vetor_alvos[i].bbox_maximo.x += vetor_alvos[i].x;
-            vetor_alvos[i].bbox_maximo.y += vetor_alvos[i].y;
-            vetor_alvos[i].bbox_maximo.z += vetor_alvos[i].z;
-
+            glm::mat4 model = modelo_alvo(i, quadro.posicao_alvos[i]);
+            if (IsObjectVisible(objeto_alvo, model))
+                modelos.push_back(model);
         }
     }
+    UploadInstances(objeto_alvo, modelos);
+    QueueVirtualObjectInstanced(objeto_alvo, ALVO, modelos.size());
 }
 
-void dispara_balas(Bala vetor_balas[])
+/* As balas são desenhadas com uma única chamada instanciada, qualquer que seja a quantidade. */
+void desenha_balas(const QuadroSimulacao& quadro)
 {
-    for (int i = 0; i < QUANTIDADE_BALAS; i++)
-        if (vetor_balas[i].desenhar == false)
-        {
-            vetor_balas[i].desenhar = true;
-            vetor_balas[i].x = camera_position_c.x;
-            vetor_balas[i].y = camera_position_c.y;
-            vetor_balas[i].z = camera_position_c.z;
-
-            vetor_balas[i].direcao.x = camera_view_vector.x;
-            vetor_balas[i].direcao.y = camera_view_vector.y;
-            vetor_balas[i].direcao.z = camera_view_vector.z;
+    static std::vector<glm::mat4> modelos;
+    modelos.clear();
 
-            glm::vec4 eixo_rotacao = crossproduct(glm::vec4(0.0f,1.0f,0.0f,0.0f),camera_view_vector);
-            vetor_balas[i].eixo_rotacao_normalizado = normalize(eixo_rotacao);
-            glm::vec4 view_normalizado = normalize(camera_view_vector);
-            float cosseno_rotacao = dotproduct(view_normalizado,glm::vec4(0.0f,1.0f,0.0f,0.0f));
-
-            vetor_balas[i].angulo_rotacao = acosf(cosseno_rotacao);
-            break;
-        }
-}
-
-void desenha_balas(Bala vetor_balas[])
-{
-    glm::mat4 model = Matrix_Identity(); // Transformação identidade de modelagem
-    for (int i = 0; i < QUANTIDADE_BALAS; i++)
+    for (size_t i = 0; i < quadro.posicao_balas.size(); i++)
     {
-        if (vetor_balas[i].desenhar == true)
-        {
-            vetor_balas[i].x += VELOCIDADE_BALAS*vetor_balas[i].direcao.x*delta_t;
-            vetor_balas[i].y += VELOCIDADE_BALAS*vetor_balas[i].direcao.y*delta_t;
-            vetor_balas[i].z += VELOCIDADE_BALAS*vetor_balas[i].direcao.z*delta_t;
-
-            model = Matrix_Translate(vetor_balas[i].x,vetor_balas[i].y,vetor_balas[i].z)
-            *Matrix_Scale(0.03f,0.03f,0.03f)
-            *Matrix_Rotate(vetor_balas[i].angulo_rotacao,vetor_balas[i].eixo_rotacao_normalizado);
-            glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, BULLET);
-            DrawVirtualObject("Bullet");
-        }
+        glm::vec4 posicao = quadro.posicao_balas[i];
+        glm::mat4 model = Matrix_Translate(posicao.x,posicao.y,posicao.z)
+        *Matrix_Scale(0.03f,0.03f,0.03f)
+        *Matrix_Rotate(quadro.angulo_rotacao_balas[i],quadro.eixo_rotacao_balas[i]);
+        if (IsObjectVisible(objeto_bala, model))
+            modelos.push_back(model);
     }
+    UploadInstances(objeto_bala, modelos);
+    QueueVirtualObjectInstanced(objeto_bala, BULLET, modelos.size());
 }
 
 void desenha_skybox(int id_objeto)
 {
     glm::mat4 model;
     model = Matrix_Scale(15.0f,15.0f,15.0f);
-    glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-    glUniform1i(g_object_id_uniform, id_objeto);
-    glDisable(GL_CULL_FACE);
-    DrawVirtualObject("the_sphere");
-    glEnable(GL_CULL_FACE);
-}
-
-void desenha_caixas(ObjetoCenario vetor_objetos[]){
-    glm::mat4 model;
-
-    model = Matrix_Scale(0.15f, 0.15f, 0.15f);
-            PushMatrix(model);
-                model = Matrix_Translate(-4.2f, 0.0f, 1.5f) * model;
-                PushMatrix(model);
-                    model = model*Matrix_Rotate_Y(0.785f);
-                    glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-                    glUniform1i(g_object_id_uniform, CAIXA);
-                    DrawVirtualObject("Crate_Plane.005");
-                    vetor_objetos[0].bbox_minimo =  Matrix_Scale(0.15f, 0.15f, 0.15f)*bbox_minimo_novo;
-                    vetor_objetos[0].bbox_maximo = Matrix_Scale(0.15f, 0.15f, 0.15f) *bbox_maximo_novo;
-
-                    vetor_objetos[0].bbox_minimo.x += (-4.2);
-                    vetor_objetos[0].bbox_minimo.y += 0.0f;
-                    vetor_objetos[0].bbox_minimo.z += 1.5f;
-
-                    vetor_objetos[0].bbox_maximo.x += (-4.2);
-                    vetor_objetos[0].bbox_maximo.y += 0.0f;
-                    vetor_objetos[0].bbox_maximo.z += 1.5f;
-                   //printf("%f, %f, %f, %f, %f, %f\n", vetor_objetos[0].bbox_minimo.x, vetor_objetos[0].bbox_maximo.x, vetor_objetos[0].bbox_minimo.y, vetor_objetos[0].bbox_maximo.y, vetor_objetos[0].bbox_minimo.z, vetor_objetos[0].bbox_maximo.z);
-
-                PopMatrix(model);
-                PushMatrix(model);
-                    model = model * Matrix_Translate(0.0f, 5.0f, 0.0f);
-                    glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-                    glUniform1i(g_object_id_uniform, CAIXA);
-                    DrawVirtualObject("Crate_Plane.005");
-                    vetor_objetos[1].bbox_minimo = Matrix_Scale(0.15f, 0.15f, 0.15f)*bbox_minimo_novo;
-                    vetor_objetos[1].bbox_maximo = Matrix_Scale(0.15f, 0.15f, 0.15f)*bbox_maximo_novo;
-
-                    vetor_objetos[1].bbox_minimo.x += (-4.2);
-                    vetor_objetos[1].bbox_minimo.y += 0.75f;
-                    vetor_objetos[1].bbox_minimo.z += 1.5f;
-
-                    vetor_objetos[1].bbox_maximo.x += (-4.2);
-                    vetor_objetos[1].bbox_maximo.y += 0.75f;
-                    vetor_objetos[1].bbox_maximo.z += 1.5f;
-
-                PopMatrix(model);
-            PopMatrix(model);
-            PushMatrix(model);
-                model = Matrix_Translate(2.0f, 0.0f, 1.5f) * model * Matrix_Scale(1.0f, 2.0f, 1.0f);
-                glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-                glUniform1i(g_object_id_uniform, CAIXA);
-                DrawVirtualObject("Crate_Plane.005");
-                vetor_objetos[2].bbox_minimo = Matrix_Scale(0.15f, 0.3f, 0.15f)*bbox_minimo_novo;
-                vetor_objetos[2].bbox_maximo = Matrix_Scale(0.15f, 0.3f, 0.15f)*bbox_maximo_novo;
-
-
-                    vetor_objetos[2].bbox_minimo.x += 2.0f;
-                    vetor_objetos[2].bbox_minimo.y += 0.0f;
-                    vetor_objetos[2].bbox_minimo.z += 1.5f;
-
-                    vetor_objetos[2].bbox_maximo.x += 2.0f;
-                    vetor_objetos[2].bbox_maximo.y += 0.0f;
-                    vetor_objetos[2].bbox_maximo.z += 1.5f;
-                    //printf("%f, %f, %f, %f, %f, %f\n", vetor_objetos[2].bbox_minimo.x, vetor_objetos[2].bbox_maximo.x, vetor_objetos[2].bbox_minimo.y, vetor_objetos[2].bbox_maximo.y, vetor_objetos[2].bbox_minimo.z, vetor_objetos[2].bbox_maximo.z);
-
-            PopMatrix(model);
-
-        PushMatrix(model);
-            model = Matrix_Translate(-1.4f, 0.0f, -1.0f) * model * Matrix_Rotate_Y(-0.2);
-            glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, CAIXA);
-            DrawVirtualObject("Crate_Plane.005");
-            vetor_objetos[3].bbox_minimo = Matrix_Scale(0.15f, 0.3f, 0.15f)*bbox_minimo_novo;
-            vetor_objetos[3].bbox_maximo = Matrix_Scale(0.15f, 0.3f, 0.15f)*bbox_maximo_novo;
-
-
-            vetor_objetos[3].bbox_minimo.x += -1.4f;
-            vetor_objetos[3].bbox_minimo.y += 0.0f;
-            vetor_objetos[3].bbox_minimo.z += -1.0f;
-
-            vetor_objetos[3].bbox_maximo.x += -1.4f;
-            vetor_objetos[3].bbox_maximo.y += 0.0f;
-            vetor_objetos[3].bbox_maximo.z += -1.0f;
-        PopMatrix(model);
-
-        PushMatrix(model);
-            model =  Matrix_Translate(2.2f, 0.0f, -0.8f) * model * Matrix_Rotate_Y(-0.4) * Matrix_Scale(3.0f, 0.5f, 1.0f);
-            glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, CAIXA);
-            DrawVirtualObject("Crate_Plane.005");
-            vetor_objetos[4].bbox_minimo = Matrix_Scale(0.45f, 0.075f, 0.15f)*bbox_minimo_novo;
-            vetor_objetos[4].bbox_maximo = Matrix_Scale(0.45f, 0.075f, 0.15f)*bbox_maximo_novo;
-
-
-
-            vetor_objetos[4].bbox_minimo.x += 2.2f;
-            vetor_objetos[4].bbox_minimo.y += 0.0f;
-            vetor_objetos[4].bbox_minimo.z += -0.8f;
-
-            vetor_objetos[4].bbox_maximo.x += 2.2f;
-            vetor_objetos[4].bbox_maximo.y += 0.0f;
-            vetor_objetos[4].bbox_maximo.z += -0.8f;
-        PopMatrix(model);
-
-        PushMatrix(model);
-            model = Matrix_Translate(-7.5f, 0.0f, 6.7f) * model * Matrix_Scale(0.8f, 0.8f, 0.8f) * Matrix_Rotate_Y(0.1);
-            glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, CAIXA);
-            DrawVirtualObject("Crate_Plane.005");
-            vetor_objetos[5].bbox_minimo = Matrix_Scale(0.15f, 0.15f, 0.15f)*bbox_minimo_novo;
-            vetor_objetos[5].bbox_maximo = Matrix_Scale(0.15f, 0.15f, 0.15f)*bbox_maximo_novo;
-
-            vetor_objetos[5].bbox_minimo.x += -7.5f;
-            vetor_objetos[5].bbox_minimo.y += 0.0f;
-            vetor_objetos[5].bbox_minimo.z += 6.7f;
-
-            vetor_objetos[5].bbox_maximo.x += -7.5f;
-            vetor_objetos[5].bbox_maximo.y += 0.0f;
-            vetor_objetos[5].bbox_maximo.z += 6.7f;
-        PopMatrix(model);
-
-        PushMatrix(model);
-            model =  Matrix_Translate(-7.5f, 0.0f, 5.2f) * model * Matrix_Scale(0.8f, 0.8f, 0.8f) * Matrix_Rotate_Y(-0.21);
-            glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, CAIXA);
-            DrawVirtualObject("Crate_Plane.005");
-            vetor_objetos[6].bbox_minimo = model*bbox_minimo_novo;
-            vetor_objetos[6].bbox_maximo = model*bbox_maximo_novo;
-
-            vetor_objetos[6].bbox_minimo.x += -7.5f;
-            vetor_objetos[6].bbox_minimo.y += 0.0f;
-            vetor_objetos[6].bbox_minimo.z += 5.2f;
-
-            vetor_objetos[6].bbox_maximo.x += -7.5f;
-            vetor_objetos[6].bbox_maximo.y += 0.0f;
-            vetor_objetos[6].bbox_maximo.z += 5.2f;
-        PopMatrix(model);
-}
-
-void desenha_barreiras(ObjetoCenario vetor_objetos[]){
-
-    glm::mat4 model;
-
-    model = Matrix_Scale(0.007f, 0.007f, 0.007f) * Matrix_Rotate_X(29.85f);
-        PushMatrix(model);
-            model = Matrix_Translate(-2.7f, 0.0f, 1.6f) * model;
-            glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, BARREIRAS);
-            DrawVirtualObject("ConcreteConstructionBarrier");
-            vetor_objetos[7].bbox_minimo = Matrix_Scale(0.007f, 0.014f, 0.007f)*bbox_minimo_novo;
-            vetor_objetos[7].bbox_maximo = Matrix_Scale(0.007f, 0.014f, 0.007f)*bbox_maximo_novo;
-
-            vetor_objetos[7].bbox_minimo.x += -2.7f;
-            vetor_objetos[7].bbox_minimo.y += 0.0f;
-            vetor_objetos[7].bbox_minimo.z += 1.2f;
-
-            vetor_objetos[7].bbox_maximo.x += -2.7f;
-            vetor_objetos[7].bbox_maximo.y += -0.2f;
-            vetor_objetos[7].bbox_maximo.z += 1.2f;
-
-            //printf("%f, %f, %f\n", camera_position_c.x, camera_position_c.y, camera_position_c.z);
-            //printf("%f, %f, %f, %f, %f, %f\n", vetor_objetos[7].bbox_minimo.x, vetor_objetos[7].bbox_maximo.x, vetor_objetos[7].bbox_minimo.y, vetor_objetos[7].bbox_maximo.y, vetor_objetos[7].bbox_minimo.z, vetor_objetos[7].bbox_maximo.z);
-
-        PopMatrix(model);
-        PushMatrix(model);
-            model = model * Matrix_Scale(3.5f, 0.8f, 0.8f);
-            model = Matrix_Translate(-1.05f, 0.0f, 3.7f) * model;
-            glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, BARREIRAS);
-            DrawVirtualObject("ConcreteConstructionBarrier");
-        PopMatrix(model);
-
-        PushMatrix(model);
-            model = model * Matrix_Scale(3.5f, 0.8f, 0.8f);
-            model = Matrix_Translate(-1.05f, 0.0f, 7.5f) * model;
-            glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, BARREIRAS);
-            DrawVirtualObject("ConcreteConstructionBarrier");
-        PopMatrix(model);
-
-        PushMatrix(model);
-            model = model  * Matrix_Rotate_Z(1.57f) * Matrix_Scale(1.8f, 0.8f, 0.8f);
-            model = Matrix_Translate(-4.4f, 0.0f, 5.5f) * model;
-            glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, BARREIRAS);
-            DrawVirtualObject("ConcreteConstructionBarrier");
-        PopMatrix(model);
-
-        PushMatrix(model);
-            model = model  * Matrix_Rotate_Z(1.57f) * Matrix_Scale(1.8f, 0.8f, 0.8f);
-            model = Matrix_Translate(2.6f, 0.0f, 5.5f) * model;
-            glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, BARREIRAS);
-            DrawVirtualObject("ConcreteConstructionBarrier");
-        PopMatrix(model);
-
-        PushMatrix(model);
-            model = Matrix_Translate(3.5f, 0.0f, 11.0f) * model * Matrix_Scale(1.0f, 1.0f, 3.0f);
-            glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, BARREIRAS);
-            DrawVirtualObject("ConcreteConstructionBarrier");
-            vetor_objetos[8].bbox_minimo = Matrix_Scale(0.007f, 0.021f, 0.007f)*bbox_minimo_novo;
-            vetor_objetos[8].bbox_maximo = Matrix_Scale(0.007f, 0.021f, 0.007f)*bbox_maximo_novo;
-
-
-            vetor_objetos[8].bbox_minimo.x += 3.5f;
-            vetor_objetos[8].bbox_minimo.y += 0.0f;
-            vetor_objetos[8].bbox_minimo.z += 10.6f;
-
-            vetor_objetos[8].bbox_maximo.x += 3.5f;
-            vetor_objetos[8].bbox_maximo.y += 0.5f;
-            vetor_objetos[8].bbox_maximo.z += 10.4f;
-        PopMatrix(model);
-
-
+    QueueVirtualObject(objeto_esfera, id_objeto, model, RENDER_NO_CULL_FACE | RENDER_BACKGROUND);
 }
 
+/* Lote da cena estática: todas as instâncias de um mesmo modelo, cujas matrizes de
+modelagem ficam no buffer de instâncias do modelo (veja UploadInstances()). Somente as
+instâncias dentro do frustum de visualização ficam no buffer, agrupadas por nível de
+detalhe quando o modelo os tem. */
+typedef struct
+{
+    int objeto;
+    int id_objeto;
 
-void desenha_paletes(ObjetoCenario vetor_objetos[]){
+    std::vector<glm::mat4> modelos;
+    std::vector<int> niveis;             /* Nível de detalhe de cada instância; -1 se está fora do frustum */
+    std::vector<size_t> quantidade_nivel; /* Número de instâncias de cada nível no buffer */
 
-        glm::mat4 model;
-     /* DESENHO PALETA */
-        model = Matrix_Translate(0.0f, 0.0f, -1.0f);
-        glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, PALETE);
-        DrawVirtualObject("PalletPlywoodNew_LOD0");
-        vetor_objetos[9].bbox_minimo = bbox_minimo_novo;
-        vetor_objetos[9].bbox_maximo = bbox_maximo_novo;
+} LoteEstatico;
 
+std::vector<LoteEstatico> cena_estatica;
 
-        vetor_objetos[9].bbox_minimo.x += 0.0f;
-        vetor_objetos[9].bbox_minimo.y += 0.0f;
-        vetor_objetos[9].bbox_minimo.z += -1.0f;
+/* Calcula uma única vez, no carregamento, as matrizes de modelagem e as bounding boxes
+das caixas, barreiras e paletes, que nunca se movem (veja monta_cena_estatica() em scene.cpp).
+As matrizes são enviadas para a GPU aqui mesmo, e a cena estática passa a ser desenhada com
+uma chamada por modelo. */
+void prepara_cena_estatica(ObjetoCenario vetor_objetos[])
+{
+    // Handle e identificador usado pelo shader de cada modelo da cena estática (MODELO_* em scene.h).
+    const int objetos_modelos[QUANTIDADE_MODELOS_CENARIO] = { objeto_caixa, objeto_barreira, objeto_palete };
+    const int ids_modelos[QUANTIDADE_MODELOS_CENARIO] = { CAIXA, BARREIRAS, PALETE };
 
-            vetor_objetos[9].bbox_maximo.x += 0.0f;
-            vetor_objetos[9].bbox_maximo.y += 0.0f;
-            vetor_objetos[9].bbox_maximo.z += -1.0f;
+    std::vector<ItemEstatico> itens;
+    monta_cena_estatica(itens);
 
-        model = Matrix_Translate(0.0f, 0.0f, 12.0f) * Matrix_Scale(4.0f, 0.8f, 1.5f);
-        glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, PALETE);
-        DrawVirtualObject("PalletPlywoodNew_LOD0");
-        vetor_objetos[10].bbox_minimo = Matrix_Scale(4.0f, 0.8f, 1.5f)*bbox_minimo_novo;
-        vetor_objetos[10].bbox_maximo = Matrix_Scale(4.0f, 0.8f, 1.5f)*bbox_maximo_novo;
+    glm::vec4 bbox_minimo_modelos[QUANTIDADE_MODELOS_CENARIO];
+    glm::vec4 bbox_maximo_modelos[QUANTIDADE_MODELOS_CENARIO];
+    for (int i = 0; i < QUANTIDADE_MODELOS_CENARIO; i++)
+    {
+        bbox_minimo_modelos[i] = glm::vec4(g_VirtualScene[objetos_modelos[i]].bbox_min, 1.0f);
+        bbox_maximo_modelos[i] = glm::vec4(g_VirtualScene[objetos_modelos[i]].bbox_max, 1.0f);
+    }
+    calcula_bboxes_cenario(itens, bbox_minimo_modelos, bbox_maximo_modelos, vetor_objetos);
 
-        vetor_objetos[10].bbox_minimo.x += 0.0f;
-        vetor_objetos[10].bbox_minimo.y += 0.0f;
-        vetor_objetos[10].bbox_minimo.z += 12.0f;
+    // Agrupamos os itens consecutivos de um mesmo modelo em um lote instanciado.
+    cena_estatica.clear();
+    size_t inicio = 0;
+    while (inicio < itens.size())
+    {
+        std::vector<glm::mat4> modelos;
+        size_t fim = inicio;
+        while (fim < itens.size() && itens[fim].modelo == itens[inicio].modelo)
+            modelos.push_back(itens[fim++].model);
+
+        int objeto = objetos_modelos[itens[inicio].modelo];
+        EnableInstancing(objeto);
+        UploadInstances(objeto, modelos);
+
+        LoteEstatico lote;
+        lote.objeto = objeto;
+        lote.id_objeto = ids_modelos[itens[inicio].modelo];
+        lote.modelos = modelos;
+        lote.niveis.assign(modelos.size(), 0);
+        lote.quantidade_nivel.assign(g_VirtualScene[objeto].num_lods + 1, 0);
+        lote.quantidade_nivel[0] = modelos.size();
+        cena_estatica.push_back(lote);
+
+        inicio = fim;
+    }
+}
 
-            vetor_objetos[10].bbox_maximo.x += 0.0f;
-            vetor_objetos[10].bbox_maximo.y += 0.0f;
-            vetor_objetos[10].bbox_maximo.z += 12.0f;
+/* Cada modelo é desenhado com uma chamada por nível de detalhe usado. A cada quadro, as
+instâncias fora do frustum de visualização são descartadas e o nível das demais é
+escolhido por SelectLevelOfDetail(); as matrizes só são reenviadas para a GPU, agrupadas
+por nível, quando alguma instância muda de nível, entra ou sai do frustum. */
+void desenha_cena_estatica()
+{
+    for (size_t i = 0; i < cena_estatica.size(); i++)
+    {
+        LoteEstatico& lote = cena_estatica[i];
 
-        model = Matrix_Translate(-7.5f, 0.6f, 6.0f) * Matrix_Scale(0.3f, 0.4f, 1.0f) * Matrix_Rotate_Y(1.57f);
-        glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, PALETE);
-        DrawVirtualObject("PalletPlywoodNew_LOD0");
-        vetor_objetos[11].bbox_minimo = Matrix_Scale(0.3f, 0.4f, 1.0f)*bbox_minimo_novo;
-        vetor_objetos[11].bbox_maximo = Matrix_Scale(0.3f, 0.4f, 1.0f)*bbox_maximo_novo;
+        int quantidade_niveis = (int)lote.quantidade_nivel.size();
+        bool mudou = false;
+        for (size_t j = 0; j < lote.modelos.size(); j++)
+        {
+            int nivel = -1;
+            if (IsObjectVisible(lote.objeto, lote.modelos[j]))
+                nivel = SelectLevelOfDetail(lote.objeto, lote.modelos[j]) - lote.objeto;
+            mudou = mudou || nivel != lote.niveis[j];
+            lote.niveis[j] = nivel;
+        }
 
-        vetor_objetos[11].bbox_minimo.x += -7.5f;
-        vetor_objetos[11].bbox_minimo.y += 0.6f;
-        vetor_objetos[11].bbox_minimo.z += 6.0f;
+        if (mudou)
+        {
+            static std::vector<glm::mat4> agrupados;
+            agrupados.clear();
+            for (int nivel = 0; nivel < quantidade_niveis; nivel++)
+            {
+                lote.quantidade_nivel[nivel] = 0;
+                for (size_t j = 0; j < lote.modelos.size(); j++)
+                {
+                    if (lote.niveis[j] == nivel)
+                    {
+                        agrupados.push_back(lote.modelos[j]);
+                        lote.quantidade_nivel[nivel]++;
+                    }
+                }
+            }
+            UploadInstances(lote.objeto, agrupados);
+        }
 
-        vetor_objetos[11].bbox_maximo.x += -7.5f;
-        vetor_objetos[11].bbox_maximo.y += 0.6f;
-        vetor_objetos[11].bbox_maximo.z += 6.0f;
+        size_t primeira = 0;
+        for (int nivel = 0; nivel < quantidade_niveis; nivel++)
+        {
+            QueueVirtualObjectInstanced(lote.objeto + nivel, lote.id_objeto, lote.quantidade_nivel[nivel], primeira);
+            primeira += lote.quantidade_nivel[nivel];
+        }
+    }
 }
 
 
 
 void desenha_hud()
 {
-    glm::mat4 model, view, projection;
+    glm::mat4 model;
     glDisable(GL_DEPTH_TEST);
+    /* O HUD é desenhado com as matrizes view e projection identidade do seu próprio UBO. */
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UNIFORM_BINDING, g_HudUniformBuffer);
     /* DESENHO DA ARMA */
     model = Matrix_Translate(0.75f,-0.70f,0.0f)*Matrix_Scale(-0.12f,0.12f,0.12f)*Matrix_Rotate_X(-0.1f)*Matrix_Rotate_Y(-15.3f);
-    view = Matrix_Identity();
-    projection = Matrix_Identity();
-    glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-    glUniformMatrix4fv(g_view_uniform       , 1 , GL_FALSE , glm::value_ptr(view));
-    glUniformMatrix4fv(g_projection_uniform , 1 , GL_FALSE , glm::value_ptr(projection));
+    SetModelUniforms(model);
     glUniform1i(g_object_id_uniform, ARMA);
-    DrawVirtualObject("Cube_Cube.001");
+    DrawVirtualObject(objeto_arma);
     /* DESENHO DA MIRA */
     glUniform1i(g_object_id_uniform, MIRA);
-    view = Matrix_Identity();
-    projection = Matrix_Identity();
-    glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-    glUniformMatrix4fv(g_view_uniform       , 1 , GL_FALSE , glm::value_ptr(view));
-    glUniformMatrix4fv(g_projection_uniform , 1 , GL_FALSE , glm::value_ptr(projection));
     /* PARTE ESQUERDA DA MIRA */
     model = Matrix_Translate(-0.02f,0.0f,0.0f)*Matrix_Scale(-0.012f,0.007f,0.1f)*Matrix_Rotate_X(-1.570796237f)*Matrix_Rotate_Y(-1.570796237f);
-    glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-    DrawVirtualObject("the_plane");
+    SetModelUniforms(model);
+    DrawVirtualObject(objeto_plano);
     /* PARTE DIREITA DA MIRA */
     model = Matrix_Translate(0.02f,0.0f,0.0f)*Matrix_Scale(-0.012f,0.007f,0.1f)*Matrix_Rotate_X(-1.570796237f)*Matrix_Rotate_Y(-1.570796237f);
-    glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-    DrawVirtualObject("the_plane");
+    SetModelUniforms(model);
+    DrawVirtualObject(objeto_plano);
     /* PARTE SUPERIOR DA MIRA */
     model = Matrix_Translate(0.0f,0.038f,0.0f)*Matrix_Scale(-0.0038f,0.022f,0.1f)*Matrix_Rotate_X(-1.570796237f)*Matrix_Rotate_Y(-1.570796237f);
-    glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-    DrawVirtualObject("the_plane");
+    SetModelUniforms(model);
+    DrawVirtualObject(objeto_plano);
     /* PARTE INFERIOR DA MIRA */
     model = Matrix_Translate(0.0f,-0.038f,0.0f)*Matrix_Scale(-0.0038f,0.022f,0.1f)*Matrix_Rotate_X(-1.570796237f)*Matrix_Rotate_Y(-1.570796237f);
-    glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-    DrawVirtualObject("the_plane");
+    SetModelUniforms(model);
+    DrawVirtualObject(objeto_plano);
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UNIFORM_BINDING, g_CameraUniformBuffer);
     glEnable(GL_DEPTH_TEST);
 }
 
-void inicializa_esferas(Esfera vetor_esferas[])
+/* As esferas são desenhadas com uma única chamada instanciada, somente com as que estão
+dentro do frustum de visualização. */
+void desenha_esferas(const QuadroSimulacao& quadro)
 {
-    for (int i = 0; i < QUANTIDADE_ALVOS; i++)
-    {
-        if (i % 2 == 0)
-            vetor_esferas[i].direcao = DIRECAO_DIREITA;
-        else
-            vetor_esferas[i].direcao = DIRECAO_ESQUERDA;
-        vetor_esferas[i].centro_x = 0.0f;
-        vetor_esferas[i].centro_y = ALTURA_ESFERAS;
-        vetor_esferas[i].centro_z = -3.0f*i;
-    }
-}
+    static std::vector<glm::mat4> modelos;
+    modelos.clear();
 
-void desenha_esferas(Esfera vetor_esferas[])
-{
-    glm::mat4 model = Matrix_Identity(); // Transformação identidade de modelagem
     for (int i = 0; i < QUANTIDADE_ESFERAS; i++)
     {
-        if (vetor_esferas[i].dano < MAXIMO_DANO)
+        if (quadro.esfera_visivel[i])
         {
-            model = Matrix_Translate(vetor_esferas[i].centro_x,vetor_esferas[i].centro_y,vetor_esferas[i].centro_z)*Matrix_Scale(RAIO_ESFERAS,RAIO_ESFERAS,RAIO_ESFERAS);
-            glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, ESFERA);
-            DrawVirtualObject("the_sphere");
+            glm::vec4 centro = quadro.centro_esferas[i];
+            glm::mat4 model = Matrix_Translate(centro.x,centro.y,centro.z)*Matrix_Scale(RAIO_ESFERAS,RAIO_ESFERAS,RAIO_ESFERAS);
+            if (IsObjectVisible(objeto_esfera, model))
+                modelos.push_back(model);
         }
     }
+    UploadInstances(objeto_esfera, modelos);
+    QueueVirtualObjectInstanced(objeto_esfera, ESFERA, modelos.size());
 }
 
 void desenha_trofeu()
 {
     glm::mat4 model;
     model = Matrix_Translate(0.0f,-0.5f,0.0f)*Matrix_Scale(4.0f,4.0f,4.0f)*Matrix_Rotate_Y(-3.14159265359f);
-    glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-    glUniform1i(g_object_id_uniform, TROFEU);
-    glDisable(GL_CULL_FACE);
-    DrawVirtualObject("Cup");
-    glEnable(GL_CULL_FACE);
-}
-
-bool verifica_fim(Alvo vetor_alvos[], Esfera vetor_esferas[])
-{
-    int i = 0;
-    for(i = 0; i < QUANTIDADE_ALVOS; i++)
-        if (vetor_alvos[i].dano < MAXIMO_DANO)
-            break;
-
-    if (i != QUANTIDADE_ALVOS)
-        return false;
-
-     for(i = 0; i < QUANTIDADE_ESFERAS; i++)
-        if (vetor_esferas[i].dano < MAXIMO_DANO)
-            break;
-
-     if (i != QUANTIDADE_ESFERAS)
-        return false;
-
-    return true;
-}
-
-/* Função para controlar a movimentação dos alvos no cenário, com teste de colisão
-envolvendo os pontos extremos do cenário e o ponto no qual o alvo se encontra. */
-void controla_alvos(Alvo vetor_alvos[], double t, glm::vec4 vetor_bezier_alvo, double delta_t)
-{
-    vetor_alvos[0].x = vetor_bezier_alvo.x;
-    vetor_alvos[0].z = vetor_bezier_alvo.z;
-
-    for (int i = NUM_ALVOS_NAOLINEARES; i < QUANTIDADE_ALVOS; i++)
-    {
-        if (vetor_alvos[i].x >= LIMITE_DIR_ALVO) /* Inverte o sentido da direção do alvo para a esquerda, caso ele atinja o limite direito. */
-            vetor_alvos[i].direcao = DIRECAO_ESQUERDA;
-
-        else if (vetor_alvos[i].x <= LIMITE_ESQ_ALVO) /* Inverte o sentido da direção do alvo para a direita, caso ele atinja o limite esquerdo. */
-            vetor_alvos[i].direcao = DIRECAO_DIREITA;
-
-        if (vetor_alvos[i].direcao == DIRECAO_DIREITA)
-            vetor_alvos[i].x += vetor_alvos[i].velocidade_alvo*delta_t;
-
-        else if (vetor_alvos[i].direcao == DIRECAO_ESQUERDA)
-            vetor_alvos[i].x -= vetor_alvos[i].velocidade_alvo*delta_t;
-    }
-}
-
-/* Função para controlar a movimentação das esferas no cenário, com teste de colisão
-envolvendo os pontos extremos do cenário e o ponto no qual a esfera se encontra. */
-void controla_esferas(Esfera vetor_esferas[], double delta_t)
-{
-    for (int i = 0; i < QUANTIDADE_ALVOS; i++)
-    {
-        if (vetor_esferas[i].centro_x >= LIMITE_DIR_ESFERA) /* Inverte o sentido da direção da esfera para a esquerda, caso ela atinja o limite direito. */
-            vetor_esferas[i].direcao = DIRECAO_ESQUERDA;
-
-        else if (vetor_esferas[i].centro_x <= LIMITE_ESQ_ESFERA) /* Inverte o sentido da direção da esfera para a direita, caso ela atinja o limite esquerdo. */
-            vetor_esferas[i].direcao = DIRECAO_DIREITA;
-
-        if (vetor_esferas[i].direcao == DIRECAO_DIREITA)
-            vetor_esferas[i].centro_x += vetor_esferas[i].velocidade_esfera*delta_t;
-
-        else if (vetor_esferas[i].direcao == DIRECAO_ESQUERDA)
-            vetor_esferas[i].centro_x -= vetor_esferas[i].velocidade_esfera*delta_t;
-    }
-}
-
-void controla_balas(Bala vetor_balas[])
-{
-    for (int i = 0; i < QUANTIDADE_BALAS; i++)
-    {
-        if (vetor_balas[i].z >= LIMITE_FRENTE ||
-            vetor_balas[i].z <= LIMITE_FUNDO ||
-            vetor_balas[i].x <= LIMITE_ESQUERDA ||
-            vetor_balas[i].x >= LIMITE_DIREITA ||
-            vetor_balas[i].y >= LIMITE_CIMA ||
-            vetor_balas[i].y <= LIMITE_BAIXO)
-            {
-                vetor_balas[i].desenhar = false;
-                vetor_balas[i].x = 0.0;
-                vetor_balas[i].y = 0.0;
-                vetor_balas[i].z = 0.0;
-            }
-    }
-}
-
-void check_bbox(ObjetoCenario vetor_objetos[]){
-    for (int i = 0; i < QUANTIDADE_OBJETOS; i++)
-        {
-            float aux;
-            if(vetor_objetos[i].bbox_minimo.x > vetor_objetos[i].bbox_maximo.x){
-                aux = vetor_objetos[i].bbox_maximo.x;
-                vetor_objetos[i].bbox_maximo.x = vetor_objetos[i].bbox_minimo.x;
-                vetor_objetos[i].bbox_minimo.x = aux;
-            }
-            if(vetor_objetos[i].bbox_minimo.y > vetor_objetos[i].bbox_maximo.y){
-                aux = vetor_objetos[i].bbox_maximo.y;
-                vetor_objetos[i].bbox_maximo.y = vetor_objetos[i].bbox_minimo.y;
-                vetor_objetos[i].bbox_minimo.y = aux;
-            }
-            if(vetor_objetos[i].bbox_minimo.z > vetor_objetos[i].bbox_maximo.z){
-                aux = vetor_objetos[i].bbox_maximo.z;
-                vetor_objetos[i].bbox_maximo.z = vetor_objetos[i].bbox_minimo.z;
-                vetor_objetos[i].bbox_minimo.z = aux;
-            }
-
-        }
-
-
+    if (IsObjectVisible(objeto_trofeu, model))
+        QueueVirtualObject(SelectLevelOfDetail(objeto_trofeu, model), TROFEU, model, RENDER_NO_CULL_FACE);
 }
 
 int main(int argc, char* argv[])
@@ -1000,63 +783,124 @@ int main(int argc, char* argv[])
     //
     LoadShadersFromFiles();
 
-    // Carregamos duas imagens para serem utilizadas como textura
-    LoadTextureImage("../../data/textura_piso.jpg");    // TextureImage0
-    LoadTextureImage("../../data/textB1!.png"); // TextureImage1
-    LoadTextureImage("../../data/textura_bala.jpg"); // TextureImage2
-    LoadTextureImage("../../data/glocktexture.png"); // TextureImage3
-    LoadTextureImage("../../data/skybox.jpeg"); // TextureImage4
-    LoadTextureImage("../../data/telainicio.jpg"); // TextureImage5
-    LoadTextureImage("../../data/trofeu_textura.png"); // TextureImage6
-    LoadTextureImage("../../data/skybox_trofeu.jpg"); // TextureImage7
-    LoadTextureImage("../../data/WoodenCrate_Crate_BaseColor.png"); // TextureImage8
-    LoadTextureImage("../../data/barreira.jpg"); // TextureImage9
-    LoadTextureImage("../../data/PalletPlywood_Base_Color.png"); // TextureImage10
-
-    // Construímos a representação de objetos geométricos através de malhas de triângulos
-
-    ObjModel piso("../../data/piso.obj");
-    ComputeNormals(&piso);
-    BuildTrianglesAndAddToVirtualScene(&piso);
-
-    ObjModel target("../../data/poligono1.obj");
-    ComputeNormals(&target);
-    BuildTrianglesAndAddToVirtualScene(&target);
-
-    ObjModel bullet("../../data/bullet.obj");
-    ComputeNormals(&bullet);
-    BuildTrianglesAndAddToVirtualScene(&bullet);
-
-    ObjModel arma("../../data/glock.obj");
-    ComputeNormals(&arma);
-    BuildTrianglesAndAddToVirtualScene(&arma);
-
-    ObjModel spheremodel("../../data/sphere.obj");
-    ComputeNormals(&spheremodel);
-    BuildTrianglesAndAddToVirtualScene(&spheremodel);
-
-    ObjModel trofeu("../../data/Cup.obj");
-    ComputeNormals(&trofeu);
-    BuildTrianglesAndAddToVirtualScene(&trofeu);
-
-    ObjModel caixa("../../data/WoodenCrate.obj");
-    ComputeNormals(&caixa);
-    BuildTrianglesAndAddToVirtualScene(&caixa);
-
-    ObjModel barreira("../../data/barreira.obj");
-    ComputeNormals(&barreira);
-    BuildTrianglesAndAddToVirtualScene(&barreira);
-
-    ObjModel palete("../../data/PalletPlywoodNew_GameReady_LODs.obj");
-    ComputeNormals(&palete);
-    BuildTrianglesAndAddToVirtualScene(&palete);
+    // Criamos os uniform buffer objects com os dados de câmera (veja
+    // CameraUniforms). O do HUD tem sempre as matrizes identidade.
+    g_CameraUniformBuffer = CreateCameraUniformBuffer();
+    g_HudUniformBuffer = CreateCameraUniformBuffer();
+    UploadCameraUniforms(g_HudUniformBuffer, Matrix_Identity(), Matrix_Identity());
+
+    // Criamos o array de texturas, com as camadas que cabem no orçamento de
+    // memória de vídeo, reduzidas se preciso para que caibam as texturas de
+    // uma fase do jogo, e enviamos a tabela de materiais. As camadas são preenchidas pelo
+    // streaming de texturas à medida que cada fase as pede.
+    bool has_bc1 = HasOpenGLExtension("GL_EXT_texture_compression_s3tc") &&
+                   (HasOpenGLExtension("GL_EXT_texture_sRGB") || HasOpenGLExtension("GL_EXT_texture_compression_s3tc_srgb"));
+    int texturas_por_fase = std::max(QUANTIDADE(texturas_tela_inicio), std::max(QUANTIDADE(texturas_jogo), QUANTIDADE(texturas_fim)));
+    CreateTextureStreamer(QUANTIDADE_TEXTURAS, has_bc1 ? TEXTURE_FORMAT_BC1 : TEXTURE_FORMAT_RGB8, TEXTURE_BUDGET_MB, texturas_por_fase);
+    CreateMaterialBuffer(tabela_materiais, QUANTIDADE_MATERIAIS);
+
+    // Carregamos as imagens de textura e as malhas. A leitura e a decodificação
+    // dos arquivos são feitas em paralelo por threads auxiliares (veja AssetLoader
+    // em assets.h); esta thread, que possui o contexto OpenGL, somente envia para
+    // a GPU cada malha que fica pronta, e entrega cada textura ao streaming de
+    // texturas, que as envia para a GPU quando forem usadas. Na primeira
+    // execução cada OBJ é lido e um cache binário é gravado ao seu lado; nas
+    // seguintes, somente o cache é lido (veja LoadMesh() em mesh.cpp). O mesmo
+    // vale para as texturas comprimidas em BC1, já com todos os níveis de
+    // mipmap (veja LoadTexture() em texture.cpp).
+    AssetLoader loader;
+    AddImageJob(loader, "../../data/textura_piso.jpg", TEXTURA_PISO, TAMANHO_TEXTURAS, g_TextureArrayFormat);
+    AddImageJob(loader, "../../data/textB1!.png", TEXTURA_ALVO, TAMANHO_TEXTURAS, g_TextureArrayFormat);
+    AddImageJob(loader, "../../data/textura_bala.jpg", TEXTURA_BALA, TAMANHO_TEXTURAS, g_TextureArrayFormat);
+    AddImageJob(loader, "../../data/glocktexture.png", TEXTURA_ARMA, TAMANHO_TEXTURAS, g_TextureArrayFormat);
+    AddImageJob(loader, "../../data/skybox.jpeg", TEXTURA_SKYBOX, TAMANHO_TEXTURAS, g_TextureArrayFormat);
+    AddImageJob(loader, "../../data/telainicio.jpg", TEXTURA_TELA_INICIO, TAMANHO_TEXTURAS, g_TextureArrayFormat);
+    AddImageJob(loader, "../../data/trofeu_textura.png", TEXTURA_TROFEU, TAMANHO_TEXTURAS, g_TextureArrayFormat);
+    AddImageJob(loader, "../../data/skybox_trofeu.jpg", TEXTURA_SKYBOX_TROFEU, TAMANHO_TEXTURAS, g_TextureArrayFormat);
+    AddImageJob(loader, "../../data/WoodenCrate_Crate_BaseColor.png", TEXTURA_CAIXA, TAMANHO_TEXTURAS, g_TextureArrayFormat);
+    AddImageJob(loader, "../../data/barreira.jpg", TEXTURA_BARREIRA, TAMANHO_TEXTURAS, g_TextureArrayFormat);
+    AddImageJob(loader, "../../data/PalletPlywood_Base_Color.png", TEXTURA_PALETE, TAMANHO_TEXTURAS, g_TextureArrayFormat);
+    AddMeshJob(loader, "../../data/piso.obj");
+    AddMeshJob(loader, "../../data/poligono1.obj");
+    AddMeshJob(loader, "../../data/bullet.obj", VERTEX_FORMAT_DEFAULT | VERTEX_HALF_POSITIONS);
+    AddMeshJob(loader, "../../data/glock.obj", VERTEX_FORMAT_DEFAULT | VERTEX_HALF_POSITIONS);
+    AddMeshJob(loader, "../../data/sphere.obj", VERTEX_FORMAT_DEFAULT | VERTEX_HALF_POSITIONS);
+    AddMeshJob(loader, "../../data/Cup.obj");
+    AddMeshJob(loader, "../../data/WoodenCrate.obj");
+    AddMeshJob(loader, "../../data/barreira.obj");
+    AddMeshJob(loader, "../../data/PalletPlywoodNew_GameReady_LODs.obj");
+    StartAssetLoader(loader);
+
+    double upload_time = 0.0;
+    while (AssetJob* job = WaitFinishedAsset(loader))
+    {
+        // Os erros das threads auxiliares são informados aqui, depois que
+        // elas terminam, para que std::exit() não as encontre em execução.
+        if (!job->error.empty())
+        {
+            std::string error = job->error;
+            StopAssetLoader(loader);
+            fprintf(stderr, "ERROR: %s\n", error.c_str());
+            std::exit(EXIT_FAILURE);
+        }
+
+        double upload_start = glfwGetTime();
+        if (job->kind == ASSET_IMAGE)
+        {
+            printf("Imagem \"%s\" lida %s em %.1f ms (%lu niveis, %.1f MB).\n", job->filename.c_str(),
+                   job->texture.from_cache ? "do cache" :
+                   job->texture_format == TEXTURE_FORMAT_BC1 ? "e comprimida (cache gravado)" : "sem compressao",
+                   1000.0*job->load_time, (unsigned long)job->texture.levels.size(), job->texture.size/1048576.0);
+            SetStreamedTexture(job->texture_index, job->texture);
+        }
+        else
+        {
+            printf("Malha \"%s\" lida %s em %.1f ms (%lu objetos, %lu vertices de %lu bytes, %lu indices).\n", job->filename.c_str(),
+                   job->mesh.from_cache ? "do cache" : "do OBJ (cache gravado)", 1000.0*job->load_time,
+                   (unsigned long)job->mesh.arrays.shapes.size(),
+                   (unsigned long)job->vertices.num_vertices, (unsigned long)job->vertices.stride,
+                   (unsigned long)job->mesh.arrays.num_indices);
+            AddMeshToVirtualScene(job->mesh.arrays, job->vertices);
+            UnloadMesh(job->mesh);
+            job->vertices = PackedVertices();
+        }
+        upload_time += glfwGetTime() - upload_start;
+    }
+    PrintAssetLoadingReport(loader, upload_time);
+    StopAssetLoader(loader);
 
     if ( argc > 1 )
     {
-        ObjModel model(argv[1]);
-        BuildTrianglesAndAddToVirtualScene(&model);
+        // O construtor de ObjModel lança std::runtime_error em caso de erro.
+        try
+        {
+            ObjModel model(argv[1]);
+            BuildTrianglesAndAddToVirtualScene(&model);
+        }
+        catch (const std::exception& e)
+        {
+            fprintf(stderr, "ERROR: %s\n", e.what());
+            std::exit(EXIT_FAILURE);
+        }
     }
 
+    // Obtemos os handles dos objetos desenhados pelo jogo. Esta é a única busca por nome;
+    // durante o laço de renderização os objetos são acessados diretamente pelo handle.
+    objeto_plano = GetVirtualObject("the_plane");
+    objeto_alvo = GetVirtualObject("Cube");
+    objeto_bala = GetVirtualObject("Bullet");
+    objeto_arma = GetVirtualObject("Cube_Cube.001");
+    objeto_esfera = GetVirtualObject("the_sphere");
+    objeto_trofeu = GetVirtualObject("Cup");
+    objeto_caixa = GetVirtualObject("Crate_Plane.005");
+    objeto_barreira = GetVirtualObject("ConcreteConstructionBarrier");
+    objeto_palete = GetVirtualObject("PalletPlywoodNew_LOD0");
+
+    // Alvos, balas e esferas são desenhados de forma instanciada (veja QueueVirtualObjectInstanced()).
+    EnableInstancing(objeto_alvo);
+    EnableInstancing(objeto_bala);
+    EnableInstancing(objeto_esfera);
+
     // Inicializamos o código para renderização de texto.
     TextRendering_Init();
 
@@ -1073,63 +917,47 @@ int main(int argc, char* argv[])
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-    Alvo vetor_alvos[QUANTIDADE_ALVOS];
-    inicializa_alvos(vetor_alvos);
-
+    // A cena estática (caixas, barreiras e paletes) e as suas bounding boxes são
+    // calculadas uma única vez, aqui.
     ObjetoCenario vetor_objetos[QUANTIDADE_OBJETOS];
-
-    Esfera vetor_esferas[QUANTIDADE_ESFERAS];
-    inicializa_esferas(vetor_esferas);
-
-    Bala vetor_balas[QUANTIDADE_BALAS];
+    prepara_cena_estatica(vetor_objetos);
+
+    // Estado da simulação em passo fixo (veja simulation.h), avançado por uma thread
+    // auxiliar enquanto este laço desenha o quadro anterior. As bounding boxes dos alvos
+    // são derivadas da bounding box local do modelo "Cube".
+    SimulacaoParalela simulacao;
+    simulacao.estado.bbox_minimo_alvo = glm::vec4(g_VirtualScene[objeto_alvo].bbox_min, 0.0f);
+    simulacao.estado.bbox_maximo_alvo = glm::vec4(g_VirtualScene[objeto_alvo].bbox_max, 0.0f);
+    inicializa_simulacao(simulacao.estado, camera_position_c);
+    constroi_cenario_simulacao(simulacao.estado, vetor_objetos);
+    inicia_simulacao_paralela(simulacao);
+
+    EntradaSimulacao entrada;
     bool disparar = false;
 
-    t_prev = glfwGetTime();
-
-    double tempo_ant = glfwGetTime();
-    double tempo;
-    double delta_tempo;
-    float tempo_alvo;
-    bool direcao = true;
-
-    glm::vec4 ponto1   = glm::vec4(-5.0f,0.0f,8.0f,1.0f);
-    glm::vec4 ponto2   = glm::vec4(9.0f,0.0f,10.0f,1.0f);
-    glm::vec4 ponto3   = glm::vec4(-10.0f,0.0f,10.0f,1.0f);
-    glm::vec4 ponto4   = glm::vec4(4.0f,0.0f,8.0f,1.0f);
+    // Tempos acumulados para o relatório de tempo de quadro impresso ao final da execução.
+    long long quadros_medidos = 0;
+    double soma_simulacao = 0.0;
+    double soma_desenho = 0.0;
+    double soma_espera = 0.0;
+    long long soma_enviados = 0;
+    long long soma_descartados = 0;
+    long long soma_desenhos = 0;
+    long long soma_trocas = 0;
+    long long soma_trocas_economizadas = 0;
 
-    glm::vec4 vetor12;
-    glm::vec4 vetor23;
-    glm::vec4 vetor34;
-    glm::vec4 vetor123;
-    glm::vec4 vetor234;
-    glm::vec4 vetor_bezier_alvo;
+    t_prev = glfwGetTime();
 
     double tempo_fps = glfwGetTime();
 
     // Ficamos em um loop infinito, renderizando, até que o usuário feche a janela
     while (!glfwWindowShouldClose(window))
     {
-        tempo = glfwGetTime();
-        delta_tempo = tempo - tempo_ant;
-        if(delta_tempo > TEMPO_ALVO_BEZIER){
-            tempo_ant = glfwGetTime();
-            direcao = !direcao;
-            delta_tempo = tempo - tempo_ant;
-        }
-        if(!direcao){
-            delta_tempo = TEMPO_ALVO_BEZIER - delta_tempo;
-        }
-
-        tempo_alvo = (float)(delta_tempo/TEMPO_ALVO_BEZIER);
-
-        vetor12 = ponto1 + tempo_alvo*(ponto2 - ponto1);
-        vetor23 = ponto2 + tempo_alvo*(ponto3 - ponto2);
-        vetor34 = ponto3 + tempo_alvo*(ponto4 - ponto3);
-
-        vetor123 = vetor12 + tempo_alvo*(vetor23 - vetor12);
-        vetor234 = vetor23 + tempo_alvo*(vetor34 - vetor23);
-
-        vetor_bezier_alvo = vetor123 + tempo_alvo*(vetor234 - vetor123);
+        // Medimos o tempo real decorrido desde o quadro anterior, que é consumido pela
+        // simulação em passos fixos logo abaixo.
+        t_now = glfwGetTime();
+        double tempo_decorrido = t_now - t_prev;
+        t_prev = t_now;
 
         // Aqui executamos as operações de renderização
 
@@ -1161,6 +989,36 @@ int main(int argc, char* argv[])
         camera_up_vector   = glm::vec4(0.0f,1.0f,0.0f,0.0f); // Vetor "up" fixado para apontar para o "céu" (eito Y global)
         camera_lookat_l    = glm::vec4(0.0f,0.0f,0.0f,1.0f); // Ponto "l", para onde a câmera (look-at) estará sempre olhando
 
+        // Solicitamos à thread auxiliar os passos da simulação correspondentes ao tempo
+        // decorrido e, enquanto eles executam, desenhamos o quadro publicado anteriormente
+        // (posições interpoladas entre os dois últimos passos, inclusive a da câmera).
+        bool simulacao_solicitada = false;
+        double inicio_desenho = glfwGetTime();
+        const QuadroSimulacao& quadro = quadro_simulacao(simulacao);
+        if (iniciar_jogo && !fim_jogo)
+        {
+            entrada.frente = tecla_W_pressionada == 1;
+            entrada.tras = tecla_S_pressionada == 1;
+            entrada.direita = tecla_D_pressionada == 1;
+            entrada.esquerda = tecla_A_pressionada == 1;
+            entrada.direcao_camera = camera_view_vector;
+            entrada.vetor_u = u;
+            entrada.vetor_w = w;
+
+            if(g_LeftMouseButtonPressed && disparar == 0)
+                disparar = true;
+            if(!g_LeftMouseButtonPressed && disparar == true)
+            {
+                disparar = false;
+                entrada.disparar = true;
+            }
+
+            solicita_passos_simulacao(simulacao, entrada, tempo_decorrido);
+            entrada.disparar = false;
+            simulacao_solicitada = true;
+            camera_position_c = quadro.posicao_jogador;
+        }
+
         if (fim_jogo)
         {
             camera_position_c  = glm::vec4(x,y,z,1.0f); // Ponto "c", centro da câmera
@@ -1189,6 +1047,7 @@ int main(int argc, char* argv[])
             // Para definição do field of view (FOV), veja slides 205-215 do documento Aula_09_Projecoes.pdf.
             float field_of_view = 3.141592 / 3.0f;
             projection = Matrix_Perspective(field_of_view, g_ScreenRatio, nearplane, farplane);
+            g_LodPixelsPerUnit = g_ScreenHeight / (2.0f*tanf(field_of_view/2.0f));
         }
         else
         {
@@ -1202,68 +1061,92 @@ int main(int argc, char* argv[])
             float r = t*g_ScreenRatio;
             float l = -r;
             projection = Matrix_Orthographic(l, r, b, t, nearplane, farplane);
+            g_LodPixelsPerUnit = g_ScreenHeight / (t - b);
         }
 
         // Enviamos as matrizes "view" e "projection" para a placa de vídeo
-        // (GPU). Veja o arquivo "shader_vertex.glsl", onde estas são
+        // (GPU), no uniform buffer object da câmera, que fica ligado durante
+        // todo o quadro. Veja o arquivo "shader_vertex.glsl", onde estas são
         // efetivamente aplicadas em todos os pontos.
-        glUniformMatrix4fv(g_view_uniform       , 1 , GL_FALSE , glm::value_ptr(view));
-        glUniformMatrix4fv(g_projection_uniform , 1 , GL_FALSE , glm::value_ptr(projection));
+        UploadCameraUniforms(g_CameraUniformBuffer, view, projection);
+        glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UNIFORM_BINDING, g_CameraUniformBuffer);
+
+        g_LodCameraPosition = camera_position_c;
+        g_LodPerspective = g_UsePerspectiveProjection;
+        ExtractFrustumPlanes(projection * view);
+        g_RenderDraws = 0;
+        g_RenderStateChanges = 0;
+        g_RenderStateChangesSaved = 0;
 
         /* NOVAS CHAMADAS DE FUNÇÕES DO TRABALHO FINAL ABAIXO. */
 
         if (!iniciar_jogo && !fim_jogo)
+        {
+            RequestTextures(texturas_tela_inicio, QUANTIDADE(texturas_tela_inicio));
             tela_inicio();
+        }
 
         if (iniciar_jogo && !fim_jogo)
         {
+            RequestTextures(texturas_jogo, QUANTIDADE(texturas_jogo));
             desenha_chao();
 
-            t_now = glfwGetTime();
-            delta_t = t_now-t_prev;
-            t_prev = t_now;
-
-            controla_esferas(vetor_esferas, delta_t);
-            controla_alvos(vetor_alvos, tempo_alvo, vetor_bezier_alvo, delta_t);
-            desenha_alvos(vetor_alvos);
-            desenha_esferas(vetor_esferas);
-            desenha_caixas(vetor_objetos);
-            desenha_barreiras(vetor_objetos);
-            desenha_paletes(vetor_objetos);
-            check_bbox(vetor_objetos);
-            controla_balas(vetor_balas);
-
-            if(g_LeftMouseButtonPressed && disparar == 0)
-                disparar = true;
-            if(!g_LeftMouseButtonPressed && disparar == true)
-            {
-                disparar = false;
-                dispara_balas(vetor_balas);
-            }
+            desenha_alvos(quadro);
+            desenha_esferas(quadro);
+            desenha_cena_estatica();
 
-            desenha_balas(vetor_balas);
-            destroi_balas(vetor_balas, vetor_objetos);
-            destroi_alvos(vetor_balas,vetor_alvos);
-            destroi_esferas(vetor_balas,vetor_esferas);
+            desenha_balas(quadro);
             desenha_skybox(SKYBOX);
+            SubmitRenderQueue();
             desenha_hud();
 
-            fim_jogo = verifica_fim(vetor_alvos,vetor_esferas);
+            fim_jogo = quadro.fim_jogo;
         }
 
-        if (fim_jogo)
+        /* O troféu começa a ser desenhado no quadro seguinte ao fim do jogo, para que
+        as texturas das duas fases nunca sejam necessárias no mesmo quadro. */
+        else if (fim_jogo)
         {
+            RequestTextures(texturas_fim, QUANTIDADE(texturas_fim));
             desenha_trofeu();
             desenha_skybox(SKYBOX_TROFEU);
+            SubmitRenderQueue();
         }
 
 
         /* NOVAS CHAMADAS DE FUNÇÕES DO TRABALHO FINAL ACIMA. */
 
+        // Enviamos parte dos níveis de mipmap ainda pendentes das texturas
+        // usadas neste quadro; eles serão usados a partir do próximo.
+        UpdateTextureStreaming();
+
         // Imprimimos na tela informação sobre o número de quadros renderizados
         // por segundo (frames per second).
         TextRendering_ShowFramesPerSecond(window);
 
+        // Os textos acima somente foram acumulados; todos são desenhados aqui,
+        // com uma única chamada de desenho.
+        TextRendering_Flush();
+
+        // Esperamos a simulação terminar os passos deste quadro e trocamos os buffers; o
+        // quadro recém calculado será desenhado na próxima iteração.
+        if (simulacao_solicitada)
+        {
+            double inicio_espera = glfwGetTime();
+            aguarda_passos_simulacao(simulacao);
+            double fim_espera = glfwGetTime();
+
+            quadros_medidos++;
+            soma_simulacao += simulacao.duracao_passos;
+            soma_desenho += inicio_espera - inicio_desenho;
+            soma_espera += fim_espera - inicio_espera;
+            soma_enviados += g_ObjectsSubmitted;
+            soma_descartados += g_ObjectsCulled;
+            soma_desenhos += g_RenderDraws;
+            soma_trocas += g_RenderStateChanges;
+            soma_trocas_economizadas += g_RenderStateChangesSaved;
+        }
+
         // O framebuffer onde OpenGL executa as operações de renderização não
         // é o mesmo que está sendo mostrado para o usuário, caso contrário
         // seria possível ver artefatos conhecidos como "screen tearing". A
@@ -1278,57 +1161,6 @@ int main(int argc, char* argv[])
         // pela biblioteca GLFW.
         glfwPollEvents();
 
-        glm::vec4 nova_pos = camera_position_c;
-        glm::vec4 w_normalizado = w;
-        w_normalizado.y = 0.0f;
-        w_normalizado = normalize(w_normalizado);
-
-        if (iniciar_jogo && !fim_jogo)
-        {
-            if (tecla_W_pressionada == 1)
-            {
-                nova_pos.x += delta_t*(-1*w_normalizado.x*VELOCIDADE_CAMERA);
-                //camera_position_c.y += (-1*w.y*VELOCIDADE_CAMERA);
-                nova_pos.z += delta_t*(-1*w_normalizado.z*VELOCIDADE_CAMERA);
-            }
-
-            if (tecla_S_pressionada == 1)
-            {
-                nova_pos.x += delta_t*(w_normalizado.x*VELOCIDADE_CAMERA);
-                //camera_position_c.y += (w.y*VELOCIDADE_CAMERA);
-                nova_pos.z += delta_t*(w_normalizado.z*VELOCIDADE_CAMERA);
-            }
-
-            if (tecla_D_pressionada == 1)
-            {
-                nova_pos.x += delta_t*(u.x*VELOCIDADE_CAMERA);
-                //camera_position_c.y += (u.y*VELOCIDADE_CAMERA);
-                nova_pos.z += delta_t*(u.z*VELOCIDADE_CAMERA);
-            }
-
-            if (tecla_A_pressionada == 1)
-            {
-                nova_pos.x += delta_t*(-1*u.x*VELOCIDADE_CAMERA);
-                //camera_position_c.y += (-1*u.y*VELOCIDADE_CAMERA);
-                nova_pos.z += delta_t*(-1*u.z*VELOCIDADE_CAMERA);
-            }
-            glm::vec4 bbox_jogador_max = nova_pos;
-            bbox_jogador_max.x += ESPESSURA_JOGADOR;
-            bbox_jogador_max.z += ESPESSURA_JOGADOR;
-            glm::vec4 bbox_jogador_min = nova_pos;
-            bbox_jogador_min.x -= ESPESSURA_JOGADOR;
-            bbox_jogador_min.z -= ESPESSURA_JOGADOR;
-            bool parede1 = limita_jogador_plano_x(bbox_jogador_max, bbox_jogador_min, -4.4f);
-            bool parede2 = limita_jogador_plano_x(bbox_jogador_max, bbox_jogador_min, 2.3f);
-            bool parede3 = limita_jogador_plano_z(bbox_jogador_max, bbox_jogador_min, 3.9f);
-            bool parede4 = limita_jogador_plano_z(bbox_jogador_max, bbox_jogador_min, 7.0f);
-            if(!parede1 && !parede2){
-                camera_position_c.x = nova_pos.x;
-            }
-            if(!parede3 && !parede4){
-                camera_position_c.z = nova_pos.z;
-            }
-        }
         while (glfwGetTime() < tempo_fps + 1.0/TARGET_FPS) {
         // TODO: Put the thread to sleep, yield, or simply do nothing
         }
@@ -1336,6 +1168,34 @@ int main(int argc, char* argv[])
 
     }
 
+    encerra_simulacao_paralela(simulacao);
+
+    // Relatório de tempo de quadro: em série, cada quadro custaria simulação + desenho;
+    // com a simulação na thread auxiliar, custa desenho + espera. A diferença é a
+    // parte da simulação que ficou escondida atrás do desenho.
+    if (quadros_medidos > 0)
+    {
+        double simulacao_ms = 1000.0*soma_simulacao/quadros_medidos;
+        double desenho_ms = 1000.0*soma_desenho/quadros_medidos;
+        double espera_ms = 1000.0*soma_espera/quadros_medidos;
+        double sobreposicao_ms = std::max(0.0, simulacao_ms - espera_ms);
+        printf("Tempo de quadro (media de %lld quadros):\n", quadros_medidos);
+        printf("  simulacao (thread auxiliar)  %8.3f ms\n", simulacao_ms);
+        printf("  desenho (thread principal)   %8.3f ms\n", desenho_ms);
+        printf("  espera pela simulacao        %8.3f ms\n", espera_ms);
+        printf("  em serie %8.3f ms | em paralelo %8.3f ms | sobreposicao %8.3f ms (%.0f%% da simulacao)\n",
+               simulacao_ms + desenho_ms, desenho_ms + espera_ms, sobreposicao_ms,
+               simulacao_ms > 0.0 ? 100.0*sobreposicao_ms/simulacao_ms : 0.0);
+        long long testados = soma_enviados + soma_descartados;
+        printf("  frustum culling: %.1f objetos enviados e %.1f descartados por quadro (%.0f%% descartados)\n",
+               (double)soma_enviados/quadros_medidos, (double)soma_descartados/quadros_medidos,
+               testados > 0 ? 100.0*soma_descartados/testados : 0.0);
+        printf("  fila de desenho: %.1f desenhos e %.1f trocas de estado por quadro (%.1f economizadas pela ordenacao)\n",
+               (double)soma_desenhos/quadros_medidos, (double)soma_trocas/quadros_medidos,
+               (double)soma_trocas_economizadas/quadros_medidos);
+    }
+    PrintTextureStreamingReport();
+
     // Finalizamos o uso dos recursos do sistema operacional
     glfwTerminate();
 
@@ -1343,31 +1203,31 @@ int main(int argc, char* argv[])
     return 0;
 }
 
-// Função que carrega uma imagem para ser utilizada como textura
-void LoadTextureImage(const char* filename)
+// Verifica se o driver oferece a extensão "name".
+bool HasOpenGLExtension(const char* name)
 {
-    printf("Carregando imagem \"%s\"... ", filename);
-
-    // Primeiro fazemos a leitura da imagem do disco
-    stbi_set_flip_vertically_on_load(true);
-    int width;
-    int height;
-    int channels;
-    unsigned char *data = stbi_load(filename, &width, &height, &channels, 3);
-
-    if ( data == NULL )
+    GLint num_extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+    for (GLint i = 0; i < num_extensions; ++i)
     {
-        fprintf(stderr, "ERROR: Cannot open image file \"%s\".\n", filename);
-        std::exit(EXIT_FAILURE);
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension != NULL && strcmp(extension, name) == 0)
+            return true;
     }
+    return false;
+}
 
-    printf("OK (%dx%d).\n", width, height);
-
-    // Agora criamos objetos na GPU com OpenGL para armazenar a textura
-    GLuint texture_id;
+// Cria o array de texturas com "num_layers" camadas de size x size pixels no
+// formato "format" (TEXTURE_FORMAT_*), com espaço para todos os níveis de
+// mipmap, e o associa à unidade de textura 0. As camadas são preenchidas
+// pelo streaming de texturas (veja UploadTextureLevel()).
+void CreateTextureArray(int size, int num_layers, int format)
+{
     GLuint sampler_id;
-    glGenTextures(1, &texture_id);
+    glGenTextures(1, &g_TextureArray);
     glGenSamplers(1, &sampler_id);
+    g_TextureArrayFormat = format;
+    g_TextureArraySize = size;
 
     // Veja slides 95-96 do documento Aula_20_Mapeamento_de_Texturas.pdf
     glSamplerParameteri(sampler_id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -1377,63 +1237,354 @@ void LoadTextureImage(const char* filename)
     glSamplerParameteri(sampler_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glSamplerParameteri(sampler_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // Agora enviamos a imagem lida do disco para a GPU
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
-    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
-
-    GLuint textureunit = g_NumLoadedTextures;
-    glActiveTexture(GL_TEXTURE0 + textureunit);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glBindSampler(textureunit, sampler_id);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, g_TextureArray);
+    for (int level = 0; (size >> level) > 0; ++level)
+    {
+        int level_size = size >> level;
+        if (format == TEXTURE_FORMAT_BC1)
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, level_size, level_size, num_layers, 0,
+                                   (GLsizei)(TextureLevelSize(format, level_size, level_size) * num_layers), NULL);
+        else
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_SRGB8, level_size, level_size, num_layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+    glBindSampler(0, sampler_id);
+}
+
+// Bytes de uma camada de size x size pixels, com todos os níveis de mipmap.
+static size_t TextureLayerBytes(int format, int size)
+{
+    size_t bytes = 0;
+    for (; size > 0; size /= 2)
+        bytes += TextureLevelSize(format, size, size);
+    return bytes;
+}
+
+// Cria o array de texturas do streaming, com as camadas que cabem em
+// "budget_mb" megabytes, no máximo uma por textura, e os PBOs usados para
+// enviar os níveis de mipmap. Devem caber pelo menos "min_layers" camadas (o
+// maior número de texturas pedidas em um mesmo quadro): se não couberem com
+// TAMANHO_TEXTURAS x TAMANHO_TEXTURAS pixels, o tamanho das camadas é reduzido
+// à metade até que caibam, e os níveis mais detalhados das texturas não são
+// enviados (veja StreamedTexture::first_level).
+void CreateTextureStreamer(int num_textures, int format, int budget_mb, int min_layers)
+{
+    size_t budget = (size_t)budget_mb << 20;
+    min_layers = std::min(min_layers, num_textures);
+
+    int size = TAMANHO_TEXTURAS;
+    while (size > TEXTURE_STREAMING_MIN_SIZE && min_layers * TextureLayerBytes(format, size) > budget)
+        size /= 2;
+
+    size_t layer_bytes = TextureLayerBytes(format, size);
+    if (min_layers * layer_bytes > budget)
+    {
+        fprintf(stderr, "ERROR: Texture budget of %d MB cannot hold %d layers of %dx%d pixels (%.1f MB).\n",
+                budget_mb, min_layers, size, size, min_layers * layer_bytes / 1048576.0);
+        std::exit(EXIT_FAILURE);
+    }
+    if (size < TAMANHO_TEXTURAS)
+        fprintf(stderr, "WARNING: Texture budget of %d MB cannot hold %d layers of %dx%d pixels; using %dx%d layers.\n",
+                budget_mb, min_layers, TAMANHO_TEXTURAS, TAMANHO_TEXTURAS, size, size);
+
+    int num_layers = std::min((int)(budget / layer_bytes), num_textures);
+
+    CreateTextureArray(size, num_layers, format);
+    g_StreamedTextures.resize(num_textures);
+    g_TextureLayers.assign(num_layers, -1);
+    glGenBuffers(TEXTURE_STREAMING_BUFFERS, g_TextureUploadBuffers);
+
+    printf("Texturas: %d texturas em %d camadas de %dx%d em %s (%.1f MB cada, %.1f MB de %d MB de orcamento).\n",
+           num_textures, num_layers, size, size, format == TEXTURE_FORMAT_BC1 ? "BC1" : "RGB8",
+           layer_bytes/1048576.0, num_layers * layer_bytes/1048576.0, budget_mb);
+}
+
+// Entrega ao streaming a textura "texture", já carregada. Os dados passam a
+// ser do streaming, e "data" fica vazio.
+void SetStreamedTexture(int texture, TextureData& data)
+{
+    StreamedTexture& streamed = g_StreamedTextures[texture];
+    if (streamed.layer >= 0)
+    {
+        g_TextureLayers[streamed.layer] = -1;
+        streamed.layer = -1;
+    }
+    UnloadTexture(streamed.data);
+    std::swap(streamed.data, data);
+    streamed.resident_level = (int)streamed.data.levels.size();
+
+    // Os níveis maiores que as camadas do array nunca são enviados.
+    streamed.first_level = 0;
+    while (streamed.first_level + 1 < (int)streamed.data.levels.size() &&
+           std::max(streamed.data.levels[streamed.first_level].width,
+                    streamed.data.levels[streamed.first_level].height) > g_TextureArraySize)
+        streamed.first_level += 1;
+}
+
+// Envia o nível "level" da textura "texture" para a sua camada do array de
+// texturas, no nível level - first_level do array, diretamente da memória ou
+// através de um PBO. Com o PBO, a cópia
+// para a textura é feita pelo driver de forma assíncrona, e esta função
+// retorna logo depois de copiar os dados para o buffer.
+static void UploadTextureLevel(int texture, int level, bool use_pbo)
+{
+    StreamedTexture& streamed = g_StreamedTextures[texture];
+    const TextureLevel& mip = streamed.data.levels[level];
+    const unsigned char* pixels = streamed.data.data + mip.offset;
+    int array_level = level - streamed.first_level;
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, g_TextureArray);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+
+    if (use_pbo)
+    {
+        // Os PBOs são usados em rodízio, e glBufferData() com NULL descarta o
+        // conteúdo anterior: se o driver ainda estiver lendo o buffer, ele
+        // fornece uma nova região de memória em vez de esperar.
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, g_TextureUploadBuffers[g_NextTextureUploadBuffer]);
+        g_NextTextureUploadBuffer = (g_NextTextureUploadBuffer + 1) % TEXTURE_STREAMING_BUFFERS;
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, mip.size, NULL, GL_STREAM_DRAW);
+        void* buffer = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, mip.size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        memcpy(buffer, pixels, mip.size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        pixels = NULL; // Deslocamento dentro do PBO
+        g_TextureBytesStreamed += mip.size;
+        g_TextureLevelsStreamed += 1;
+    }
+    else
+        g_TextureBytesDirect += mip.size;
+
+    if (streamed.data.format == TEXTURE_FORMAT_BC1)
+        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, array_level, 0, 0, streamed.layer, mip.width, mip.height, 1,
+                                  GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, (GLsizei)mip.size, pixels);
+    else
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, array_level, 0, 0, streamed.layer, mip.width, mip.height, 1,
+                        GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+    if (use_pbo)
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 
-    stbi_image_free(data);
+    streamed.resident_level = level;
+}
+
+// Dá uma camada à textura "texture": uma camada livre ou, se não houver, a da
+// textura há mais tempo sem uso, desde que ela não tenha sido pedida neste
+// quadro. Envia imediatamente os níveis de até TEXTURE_STREAMING_MIN_SIZE
+// pixels, para que a textura possa ser usada já neste quadro.
+static bool MakeTextureResident(int texture)
+{
+    StreamedTexture& streamed = g_StreamedTextures[texture];
+    if (streamed.data.levels.empty())
+        return false;
+
+    int layer = -1;
+    for (size_t i = 0; i < g_TextureLayers.size() && layer < 0; ++i)
+        if (g_TextureLayers[i] < 0)
+            layer = (int)i;
 
-    g_NumLoadedTextures += 1;
+    if (layer < 0)
+    {
+        long long oldest = g_TextureFrame;
+        for (size_t i = 0; i < g_TextureLayers.size(); ++i)
+        {
+            const StreamedTexture& other = g_StreamedTextures[g_TextureLayers[i]];
+            if (other.requested_frame < oldest)
+            {
+                oldest = other.requested_frame;
+                layer = (int)i;
+            }
+        }
+        if (layer < 0)
+        {
+            if (g_TextureFailedRequests++ == 0)
+                fprintf(stderr, "WARNING: No texture array layer available for texture %d.\n", texture);
+            return false;
+        }
+
+        StreamedTexture& evicted = g_StreamedTextures[g_TextureLayers[layer]];
+        evicted.layer = -1;
+        evicted.resident_level = (int)evicted.data.levels.size();
+        g_TextureEvictions += 1;
+    }
+
+    g_TextureLayers[layer] = texture;
+    streamed.layer = layer;
+    streamed.resident_level = (int)streamed.data.levels.size();
+    for (int level = (int)streamed.data.levels.size() - 1; level >= streamed.first_level; --level)
+    {
+        const TextureLevel& mip = streamed.data.levels[level];
+        if (std::max(mip.width, mip.height) > TEXTURE_STREAMING_MIN_SIZE)
+            break;
+        UploadTextureLevel(texture, level, false);
+    }
+    g_TextureLoads += 1;
+    return true;
+}
+
+// Marca as texturas como usadas no quadro atual, o que impede que percam as
+// suas camadas, e torna residentes as que ainda não estão.
+void RequestTextures(const int* textures, int num_textures)
+{
+    bool changed = false;
+    for (int i = 0; i < num_textures; ++i)
+    {
+        StreamedTexture& streamed = g_StreamedTextures[textures[i]];
+        streamed.requested_frame = g_TextureFrame;
+        if (streamed.layer < 0)
+            changed = MakeTextureResident(textures[i]) || changed;
+    }
+    if (changed)
+        UpdateMaterialBuffer();
+}
+
+// Envia os níveis de mipmap pendentes das texturas pedidas neste quadro, até
+// TEXTURE_STREAMING_BYTES_PER_FRAME bytes. A cada passo é enviado o próximo
+// nível da textura menos detalhada no momento, para que todas melhorem juntas.
+void UpdateTextureStreaming()
+{
+    size_t bytes = 0;
+    bool changed = false;
+    while (bytes < TEXTURE_STREAMING_BYTES_PER_FRAME)
+    {
+        int next = -1;
+        for (size_t i = 0; i < g_StreamedTextures.size(); ++i)
+        {
+            const StreamedTexture& streamed = g_StreamedTextures[i];
+            if (streamed.layer >= 0 && streamed.resident_level > streamed.first_level && streamed.requested_frame == g_TextureFrame &&
+                (next < 0 || streamed.resident_level - streamed.first_level >
+                             g_StreamedTextures[next].resident_level - g_StreamedTextures[next].first_level))
+                next = (int)i;
+        }
+        if (next < 0)
+            break;
+
+        StreamedTexture& streamed = g_StreamedTextures[next];
+        UploadTextureLevel(next, streamed.resident_level - 1, true);
+        bytes += streamed.data.levels[streamed.resident_level].size;
+        changed = true;
+    }
+    if (changed)
+        UpdateMaterialBuffer();
+
+    g_TextureFrame += 1;
+}
+
+void PrintTextureStreamingReport()
+{
+    int resident = 0;
+    int complete = 0;
+    for (size_t i = 0; i < g_StreamedTextures.size(); ++i)
+        if (g_StreamedTextures[i].layer >= 0)
+        {
+            resident += 1;
+            if (g_StreamedTextures[i].resident_level == g_StreamedTextures[i].first_level)
+                complete += 1;
+        }
+
+    printf("Streaming de texturas (%lld quadros): %d de %d texturas residentes ao final (%d completas) em %d camadas; "
+           "%lld carregamentos, %lld remocoes, %lld pedidos sem camada; "
+           "%.1f MB enviados ao pedir e %.1f MB em %lld niveis por PBO.\n",
+           g_TextureFrame, resident, (int)g_StreamedTextures.size(), complete, (int)g_TextureLayers.size(),
+           g_TextureLoads, g_TextureEvictions, g_TextureFailedRequests,
+           g_TextureBytesDirect/1048576.0, g_TextureBytesStreamed/1048576.0, g_TextureLevelsStreamed);
+}
+
+// Cria o uniform buffer object com a tabela de materiais, indexada pelo
+// identificador de cada objeto (variável "object_id" dos shaders).
+void CreateMaterialBuffer(const Material* materials, int num_materials)
+{
+    g_Materials.assign(materials, materials + num_materials);
+
+    glGenBuffers(1, &g_MaterialUniformBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, g_MaterialUniformBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, num_materials * sizeof(Material), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_UNIFORM_BINDING, g_MaterialUniformBuffer);
+    UpdateMaterialBuffer();
+
+    // O tamanho do bloco no shader (MATERIAL_COUNT) deve ser o da tabela.
+    GLuint block = glGetUniformBlockIndex(g_GpuProgramID, "Materials");
+    GLint block_size = 0;
+    if (block != GL_INVALID_INDEX)
+        glGetActiveUniformBlockiv(g_GpuProgramID, block, GL_UNIFORM_BLOCK_DATA_SIZE, &block_size);
+    if ((size_t)block_size != num_materials * sizeof(Material))
+    {
+        fprintf(stderr, "ERROR: Uniform block \"Materials\" has %d bytes, but the material table has %d bytes.\n",
+                block_size, (int)(num_materials * sizeof(Material)));
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+// Envia para a GPU a tabela de materiais, trocando a textura de cada material
+// pela camada que ela ocupa no array de texturas e pelo seu nível de mipmap
+// mais detalhado já enviado. Materiais com texturas não residentes são
+// desenhados somente com a sua cor.
+void UpdateMaterialBuffer()
+{
+    std::vector<Material> materials = g_Materials;
+    for (size_t i = 0; i < materials.size(); ++i)
+    {
+        int texture = materials[i].texture_layer;
+        materials[i].texture_layer = NO_TEXTURE;
+        materials[i].min_lod = 0.0f;
+        if (texture >= 0 && texture < (int)g_StreamedTextures.size() && g_StreamedTextures[texture].layer >= 0)
+        {
+            materials[i].texture_layer = g_StreamedTextures[texture].layer;
+            materials[i].min_lod = (float)(g_StreamedTextures[texture].resident_level - g_StreamedTextures[texture].first_level);
+        }
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, g_MaterialUniformBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, materials.size() * sizeof(Material), materials.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// Função que retorna o handle de um objeto armazenado em g_VirtualScene a
+// partir do seu nome. Deve ser chamada somente durante o carregamento.
+int GetVirtualObject(const char* object_name)
+{
+    std::map<std::string, int>::const_iterator it = g_VirtualSceneHandles.find(object_name);
+    if (it == g_VirtualSceneHandles.end())
+    {
+        fprintf(stderr, "ERROR: Object \"%s\" not found in virtual scene.\n", object_name);
+        std::exit(EXIT_FAILURE);
+    }
+    return it->second;
 }
 
 // Função que desenha um objeto armazenado em g_VirtualScene. Veja definição
 // dos objetos na função BuildTrianglesAndAddToVirtualScene().
-void DrawVirtualObject(const char* object_name)
+void DrawVirtualObject(int object_handle)
 {
+    const SceneObject& object = g_VirtualScene[object_handle];
+
     // "Ligamos" o VAO. Informamos que queremos utilizar os atributos de
     // vértices apontados pelo VAO criado pela função BuildTrianglesAndAddToVirtualScene(). Veja
     // comentários detalhados dentro da definição de BuildTrianglesAndAddToVirtualScene().
-    glBindVertexArray(g_VirtualScene[object_name].vertex_array_object_id);
+    glBindVertexArray(object.vertex_array_object_id);
 
     // Setamos as variáveis "bbox_min" e "bbox_max" do fragment shader
     // com os parâmetros da axis-aligned bounding box (AABB) do modelo.
-    glm::vec3 bbox_min = g_VirtualScene[object_name].bbox_min;
-    glm::vec3 bbox_max = g_VirtualScene[object_name].bbox_max;
-
-    /* NOVA ADICAO ABAIXO. */
-
-    bbox_minimo_novo.x = bbox_min.x;
-    bbox_minimo_novo.y = bbox_min.y;
-    bbox_minimo_novo.z = bbox_min.z;
-    bbox_minimo_novo.w = 0.0f;
-
-    bbox_maximo_novo.x = bbox_max.x;
-    bbox_maximo_novo.y = bbox_max.y;
-    bbox_maximo_novo.z = bbox_max.z;
-    bbox_maximo_novo.w = 0.0f;
+    glm::vec3 bbox_min = object.bbox_min;
+    glm::vec3 bbox_max = object.bbox_max;
 
     glUniform4f(g_bbox_min_uniform, bbox_min.x, bbox_min.y, bbox_min.z, 1.0f);
     glUniform4f(g_bbox_max_uniform, bbox_max.x, bbox_max.y, bbox_max.z, 1.0f);
 
     // Pedimos para a GPU rasterizar os vértices dos eixos XYZ
     // apontados pelo VAO como linhas. Veja a definição de
-    // g_VirtualScene[""] dentro da função BuildTrianglesAndAddToVirtualScene(), e veja
+    // g_VirtualScene[] dentro da função BuildTrianglesAndAddToVirtualScene(), e veja
     // a documentação da função glDrawElements() em
     // http://docs.gl/gl3/glDrawElements.
     glDrawElements(
-        g_VirtualScene[object_name].rendering_mode,
-        g_VirtualScene[object_name].num_indices,
+        object.rendering_mode,
+        object.num_indices,
         GL_UNSIGNED_INT,
-        (void*)(g_VirtualScene[object_name].first_index * sizeof(GLuint))
+        (void*)(object.first_index * sizeof(GLuint))
     );
 
     // "Desligamos" o VAO, evitando assim que operações posteriores venham a
@@ -1441,6 +1592,409 @@ void DrawVirtualObject(const char* object_name)
     glBindVertexArray(0);
 }
 
+// Envia as matrizes "model" e "normal_matrix" do shader para um desenho não
+// instanciado. A matriz das normais é calculada aqui, uma vez por desenho.
+void SetModelUniforms(const glm::mat4& model)
+{
+    glm::mat3 normal_matrix = Matrix_Normal(model);
+    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
+    glUniformMatrix3fv(g_normal_matrix_uniform, 1, GL_FALSE, glm::value_ptr(normal_matrix));
+}
+
+// Aponta os atributos por instância (localizações 3 a 9) do VAO "ligado" para
+// o buffer "ligado" em GL_ARRAY_BUFFER, a partir da instância "first_instance".
+static void SetInstanceAttributes(size_t first_instance)
+{
+    size_t start = first_instance * sizeof(InstanceData);
+    for (GLuint column = 0; column < 4; ++column)
+    {
+        GLuint location = 3 + column; // "(location = 3)" em "shader_vertex.glsl"
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void*)(start + offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+    }
+    for (GLuint column = 0; column < 3; ++column)
+    {
+        GLuint location = 7 + column; // "(location = 7)" em "shader_vertex.glsl"
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void*)(start + offsetof(InstanceData, normal_matrix) + column * sizeof(glm::vec3)));
+    }
+}
+
+// Função que cria o buffer de dados por instância (InstanceData) de um objeto
+// e o associa às localizações 3 a 9 ("instance_model" e
+// "instance_normal_matrix" em "shader_vertex.glsl") do VAO do objeto. Note que o VAO é compartilhado por todos os objetos de um
+// mesmo arquivo OBJ; por isso, somente um deles pode ser instanciado. Os
+// níveis de detalhe do objeto usam o mesmo buffer, que deve ser preenchido
+// por UploadInstances() com o handle do objeto original.
+void EnableInstancing(int object_handle)
+{
+    SceneObject& object = g_VirtualScene[object_handle];
+
+    glBindVertexArray(object.vertex_array_object_id);
+
+    // Alocamos espaço para uma instância, de forma que os atributos por instância
+    // sempre apontem para memória válida, mesmo nos desenhos não instanciados.
+    object.instance_capacity = 1;
+    glGenBuffers(1, &object.instance_buffer_id);
+    glBindBuffer(GL_ARRAY_BUFFER, object.instance_buffer_id);
+    glBufferData(GL_ARRAY_BUFFER, object.instance_capacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+
+    // Uma mat4 ocupa quatro localizações consecutivas, uma para cada coluna, e
+    // uma mat3, três. O divisor 1 faz com que cada coluna avance uma vez por
+    // instância, e não uma vez por vértice.
+    SetInstanceAttributes(0);
+    for (GLuint location = 3; location <= 9; ++location)
+    {
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+
+    for (int level = 1; level <= object.num_lods; ++level)
+        g_VirtualScene[object_handle + level].instance_buffer_id = object.instance_buffer_id;
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+// Função que envia para a GPU as matrizes de modelagem das instâncias de um
+// objeto preparado com EnableInstancing(), junto com as matrizes das normais,
+// calculadas aqui (veja InstanceData). Se elas não couberem no buffer, ele é
+// realocado com o dobro do tamanho necessário; caso contrário, descartamos o
+// conteúdo anterior (glBufferData com NULL) para que a GPU não precise esperar
+// o término do desenho do quadro anterior.
+void UploadInstances(int object_handle, const std::vector<glm::mat4>& models)
+{
+    if (models.empty())
+        return;
+
+    SceneObject& object = g_VirtualScene[object_handle];
+
+    static std::vector<InstanceData> instances;
+    instances.resize(models.size());
+    for (size_t i = 0; i < models.size(); ++i)
+    {
+        instances[i].model = models[i];
+        instances[i].normal_matrix = Matrix_Normal(models[i]);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, object.instance_buffer_id);
+    if (models.size() > object.instance_capacity)
+        object.instance_capacity = 2 * models.size();
+    glBufferData(GL_ARRAY_BUFFER, object.instance_capacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(InstanceData), instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Calcula a chave de ordenação de um item da fila de desenho. Dos bits mais
+// significativos para os menos: flags (4 bits), VAO (16 bits), object_id (8
+// bits), handle do objeto (16 bits) e distância até a câmera (20 bits).
+static uint64_t RenderKey(const RenderItem& item, float depth)
+{
+    const SceneObject& object = g_VirtualScene[item.object_handle];
+
+    uint64_t quantized_depth = (uint64_t)(glm::clamp(depth / RENDER_DEPTH_RANGE, 0.0f, 1.0f) * 0xFFFFF);
+
+    return ((uint64_t)(item.flags & 0xF) << 60)
+         | ((uint64_t)(object.vertex_array_object_id & 0xFFFF) << 44)
+         | ((uint64_t)(item.object_id & 0xFF) << 36)
+         | ((uint64_t)(item.object_handle & 0xFFFF) << 20)
+         | quantized_depth;
+}
+
+// Inclui na fila de desenho um objeto de g_VirtualScene, desenhado com a
+// matriz de modelagem "model" e o valor "object_id" na variável do shader de
+// mesmo nome. "flags" é uma combinação dos bits RENDER_*.
+void QueueVirtualObject(int object_handle, int object_id, const glm::mat4& model, unsigned int flags)
+{
+    const SceneObject& object = g_VirtualScene[object_handle];
+
+    RenderItem item;
+    item.object_handle = object_handle;
+    item.object_id = object_id;
+    item.flags = flags;
+    item.model = model;
+    item.num_instances = 0;
+    item.first_instance = 0;
+
+    glm::vec4 center = model * glm::vec4(0.5f*(object.bbox_min + object.bbox_max), 1.0f);
+    item.key = RenderKey(item, glm::length(glm::vec3(center - g_LodCameraPosition)));
+
+    g_RenderQueue.push_back(item);
+}
+
+// Inclui na fila de desenho "num_instances" instâncias de um objeto de
+// g_VirtualScene, a partir da instância "first_instance", com as matrizes
+// enviadas por UploadInstances(). As matrizes só são lidas pela GPU em
+// SubmitRenderQueue(); por isso, o buffer de instâncias do objeto não pode
+// ser alterado entre as duas chamadas.
+void QueueVirtualObjectInstanced(int object_handle, int object_id, size_t num_instances, size_t first_instance, unsigned int flags)
+{
+    if (num_instances == 0)
+        return;
+
+    RenderItem item;
+    item.object_handle = object_handle;
+    item.object_id = object_id;
+    item.flags = flags;
+    item.num_instances = num_instances;
+    item.first_instance = first_instance;
+    item.key = RenderKey(item, 0.0f); // As instâncias estão espalhadas pela cena
+
+    g_RenderQueue.push_back(item);
+}
+
+// Percorre a fila de desenho na ordem atual, fazendo cada troca de estado
+// somente quando o valor muda em relação ao item anterior; o VAO só é
+// "desligado" no final. Retorna o número de trocas de estado. Com "draw"
+// falso, somente conta as trocas, sem nenhuma chamada à OpenGL.
+static int RunRenderQueue(bool draw)
+{
+    GLuint bound_vao = 0;
+    int current_object_id = -1;
+    int current_bbox_handle = -1;
+    bool instanced = false;
+    bool cull_face = true; // Estado definido em main()
+    size_t instance_offset = 0; // Deslocamento dos atributos por instância do VAO ligado
+    int changes = 0;
+
+    for (size_t i = 0; i < g_RenderQueue.size(); ++i)
+    {
+        const RenderItem& item = g_RenderQueue[i];
+        const SceneObject& object = g_VirtualScene[item.object_handle];
+
+        bool item_cull_face = !(item.flags & RENDER_NO_CULL_FACE);
+        if (item_cull_face != cull_face)
+        {
+            if (draw && item_cull_face)
+                glEnable(GL_CULL_FACE);
+            else if (draw)
+                glDisable(GL_CULL_FACE);
+            cull_face = item_cull_face;
+            changes += 1;
+        }
+
+        if (object.vertex_array_object_id != bound_vao)
+        {
+            // O VAO anterior fica com os atributos por instância na posição inicial.
+            if (instance_offset > 0)
+            {
+                if (draw)
+                    SetInstanceAttributes(0);
+                instance_offset = 0;
+                changes += 1;
+            }
+            if (draw)
+                glBindVertexArray(object.vertex_array_object_id);
+            bound_vao = object.vertex_array_object_id;
+            changes += 1;
+        }
+
+        if (item.object_id != current_object_id)
+        {
+            if (draw)
+                glUniform1i(g_object_id_uniform, item.object_id);
+            current_object_id = item.object_id;
+            changes += 1;
+        }
+
+        if (item.object_handle != current_bbox_handle)
+        {
+            if (draw)
+            {
+                glUniform4f(g_bbox_min_uniform, object.bbox_min.x, object.bbox_min.y, object.bbox_min.z, 1.0f);
+                glUniform4f(g_bbox_max_uniform, object.bbox_max.x, object.bbox_max.y, object.bbox_max.z, 1.0f);
+            }
+            current_bbox_handle = item.object_handle;
+            changes += 2;
+        }
+
+        bool item_instanced = item.num_instances > 0;
+        if (item_instanced != instanced)
+        {
+            if (draw)
+                glUniform1i(g_instanced_uniform, item_instanced ? 1 : 0);
+            instanced = item_instanced;
+            changes += 1;
+        }
+
+        if (!item_instanced)
+        {
+            if (!draw)
+                continue;
+            SetModelUniforms(item.model);
+            glDrawElements(
+                object.rendering_mode,
+                object.num_indices,
+                GL_UNSIGNED_INT,
+                (void*)(object.first_index * sizeof(GLuint))
+            );
+        }
+        else
+        {
+            // A OpenGL 3.3 não tem glDrawElementsInstancedBaseInstance(); para
+            // começar em outra instância, deslocamos os atributos por instância.
+            if (item.first_instance != instance_offset)
+            {
+                if (draw)
+                {
+                    glBindBuffer(GL_ARRAY_BUFFER, object.instance_buffer_id);
+                    SetInstanceAttributes(item.first_instance);
+                }
+                instance_offset = item.first_instance;
+                changes += 1;
+            }
+            if (!draw)
+                continue;
+            glDrawElementsInstanced(
+                object.rendering_mode,
+                object.num_indices,
+                GL_UNSIGNED_INT,
+                (void*)(object.first_index * sizeof(GLuint)),
+                (GLsizei)item.num_instances
+            );
+        }
+    }
+
+    if (instance_offset > 0)
+    {
+        if (draw)
+            SetInstanceAttributes(0);
+        changes += 1;
+    }
+    if (instanced)
+    {
+        if (draw)
+            glUniform1i(g_instanced_uniform, 0);
+        changes += 1;
+    }
+    if (!cull_face)
+    {
+        if (draw)
+            glEnable(GL_CULL_FACE);
+        changes += 1;
+    }
+    if (bound_vao != 0)
+    {
+        if (draw)
+            glBindVertexArray(0);
+        changes += 1;
+    }
+    if (draw)
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    return changes;
+}
+
+// Desenha e esvazia a fila de desenho, usando o programa g_GpuProgramID e as
+// matrizes "view" e "projection" já enviadas para ele. Os itens são ordenados
+// pela chave antes de serem desenhados. Para as estatísticas, as trocas de
+// estado da fila na ordem em que os itens foram incluídos são contadas antes
+// da ordenação, com a mesma eliminação de trocas redundantes.
+void SubmitRenderQueue()
+{
+    int unsorted_changes = RunRenderQueue(false);
+
+    std::sort(g_RenderQueue.begin(), g_RenderQueue.end(),
+              [](const RenderItem& a, const RenderItem& b) { return a.key < b.key; });
+
+    int changes = RunRenderQueue(true);
+
+    g_RenderDraws += (int)g_RenderQueue.size();
+    g_RenderStateChanges += changes;
+    g_RenderStateChangesSaved += unsorted_changes - changes;
+    g_RenderQueue.clear();
+}
+
+// Escolhe, entre um objeto e os seus níveis de detalhe (veja GenerateMeshLODs()
+// em mesh.cpp), o mais simples cujo erro projetado na tela não passa de
+// LOD_MAX_PIXEL_ERROR pixels, e retorna o seu handle. O erro de cada nível é
+// uma distância nas coordenadas do modelo; ela é multiplicada pela maior
+// escala da matriz "model" e pelo número de pixels por unidade de comprimento
+// na parte do objeto mais próxima da câmera.
+int SelectLevelOfDetail(int object_handle, const glm::mat4& model)
+{
+    const SceneObject& object = g_VirtualScene[object_handle];
+    if (object.num_lods == 0)
+        return object_handle;
+
+    float scale = std::max(glm::length(glm::vec3(model[0])),
+                  std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+    float pixels_per_unit = g_LodPixelsPerUnit;
+    if (g_LodPerspective)
+    {
+        // Distância da câmera até a esfera que envolve a bounding box do objeto.
+        glm::vec4 center = model * glm::vec4(0.5f*(object.bbox_min + object.bbox_max), 1.0f);
+        float radius = 0.5f * glm::length(object.bbox_max - object.bbox_min) * scale;
+        float distance = glm::length(glm::vec3(center - g_LodCameraPosition)) - radius;
+        if (distance <= 0.0f)
+            return object_handle;
+        pixels_per_unit /= distance;
+    }
+
+    int selected = object_handle;
+    for (int level = 1; level <= object.num_lods; ++level)
+    {
+        if (g_VirtualScene[object_handle + level].lod_error * scale * pixels_per_unit > LOD_MAX_PIXEL_ERROR)
+            break;
+        selected = object_handle + level;
+    }
+    return selected;
+}
+
+// Extrai os seis planos do frustum de visualização da matriz "projection *
+// view" (método de Gribb e Hartmann) e zera os contadores de IsObjectVisible().
+// Um ponto p está dentro do frustum se -w <= x,y,z <= w, onde (x,y,z,w) =
+// M*p; cada uma dessas desigualdades é um plano dado por uma soma ou
+// diferença de linhas de M. Vale para as duas projeções de matrices.h.
+void ExtractFrustumPlanes(const glm::mat4& projection_view)
+{
+    glm::mat4 rows = glm::transpose(projection_view); // rows[i] é a i-ésima linha de M
+
+    g_FrustumPlanes[0] = rows[3] + rows[0]; // Esquerda
+    g_FrustumPlanes[1] = rows[3] - rows[0]; // Direita
+    g_FrustumPlanes[2] = rows[3] + rows[1]; // Baixo
+    g_FrustumPlanes[3] = rows[3] - rows[1]; // Cima
+    g_FrustumPlanes[4] = rows[3] + rows[2]; // Near
+    g_FrustumPlanes[5] = rows[3] - rows[2]; // Far
+
+    g_ObjectsSubmitted = 0;
+    g_ObjectsCulled = 0;
+}
+
+// Testa se a bounding box de um objeto, transformada pela matriz "model",
+// tem alguma parte dentro do frustum de visualização, e atualiza os
+// contadores g_ObjectsSubmitted e g_ObjectsCulled. A bounding box no mundo é
+// a AABB que envolve a bounding box transformada: centro M*c e meias
+// extensões |M|*e. Ela está fora do frustum se estiver inteiramente do lado
+// de fora de algum plano. O teste é conservador: uma caixa perto de um canto
+// do frustum pode ser considerada visível sem estar.
+bool IsObjectVisible(int object_handle, const glm::mat4& model)
+{
+    const SceneObject& object = g_VirtualScene[object_handle];
+
+    glm::vec3 center = glm::vec3(model * glm::vec4(0.5f*(object.bbox_min + object.bbox_max), 1.0f));
+    glm::vec3 half_extent = 0.5f*(object.bbox_max - object.bbox_min);
+    glm::vec3 extent = glm::abs(glm::vec3(model[0])) * half_extent.x
+                     + glm::abs(glm::vec3(model[1])) * half_extent.y
+                     + glm::abs(glm::vec3(model[2])) * half_extent.z;
+
+    for (int i = 0; i < 6; ++i)
+    {
+        glm::vec3 normal = glm::vec3(g_FrustumPlanes[i]);
+        float distance = glm::dot(normal, center) + g_FrustumPlanes[i].w;
+        float radius = glm::dot(glm::abs(normal), extent);
+        if (distance + radius < 0.0f)
+        {
+            g_ObjectsCulled += 1;
+            return false;
+        }
+    }
+
+    g_ObjectsSubmitted += 1;
+    return true;
+}
+
 // Função que carrega os shaders de vértices e de fragmentos que serão
 // utilizados para renderização. Veja slides 180-200 do documento Aula_03_Rendering_Pipeline_Grafico.pdf.
 //
@@ -1478,26 +2032,63 @@ void LoadShadersFromFiles()
     // Utilizaremos estas variáveis para enviar dados para a placa de vídeo
     // (GPU)! Veja arquivo "shader_vertex.glsl" e "shader_fragment.glsl".
     g_model_uniform      = glGetUniformLocation(g_GpuProgramID, "model"); // Variável da matriz "model"
-    g_view_uniform       = glGetUniformLocation(g_GpuProgramID, "view"); // Variável da matriz "view" em shader_vertex.glsl
-    g_projection_uniform = glGetUniformLocation(g_GpuProgramID, "projection"); // Variável da matriz "projection" em shader_vertex.glsl
+    g_normal_matrix_uniform = glGetUniformLocation(g_GpuProgramID, "normal_matrix"); // Variável da matriz "normal_matrix" em shader_vertex.glsl
     g_object_id_uniform  = glGetUniformLocation(g_GpuProgramID, "object_id"); // Variável "object_id" em shader_fragment.glsl
     g_bbox_min_uniform   = glGetUniformLocation(g_GpuProgramID, "bbox_min");
     g_bbox_max_uniform   = glGetUniformLocation(g_GpuProgramID, "bbox_max");
+    g_instanced_uniform  = glGetUniformLocation(g_GpuProgramID, "instanced"); // Variável "instanced" em shader_vertex.glsl
 
-    // Variáveis em "shader_fragment.glsl" para acesso das imagens de textura
+    // Variável em "shader_fragment.glsl" para acesso ao array de texturas
+    // (veja CreateTextureArray()), sempre na unidade de textura 0.
     glUseProgram(g_GpuProgramID);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage0"), 0);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage1"), 1);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage2"), 2);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage3"), 3);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage4"), 4);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage5"), 5);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage6"), 6);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage7"), 7);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage8"), 8);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage9"), 9);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage10"), 10);
+    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureArray"), 0);
     glUseProgram(0);
+
+    // As matrizes "view" e "projection" ficam no bloco de uniforms "Camera",
+    // lido do uniform buffer object ligado ao ponto CAMERA_UNIFORM_BINDING.
+    GLuint camera_block = glGetUniformBlockIndex(g_GpuProgramID, "Camera");
+    if ( camera_block == GL_INVALID_INDEX )
+    {
+        fprintf(stderr, "ERROR: Uniform block \"Camera\" not found in GPU program.\n");
+        std::exit(EXIT_FAILURE);
+    }
+    glUniformBlockBinding(g_GpuProgramID, camera_block, CAMERA_UNIFORM_BINDING);
+
+    // A tabela de materiais fica no bloco "Materials" (veja CreateMaterialBuffer()).
+    GLuint material_block = glGetUniformBlockIndex(g_GpuProgramID, "Materials");
+    if ( material_block == GL_INVALID_INDEX )
+    {
+        fprintf(stderr, "ERROR: Uniform block \"Materials\" not found in GPU program.\n");
+        std::exit(EXIT_FAILURE);
+    }
+    glUniformBlockBinding(g_GpuProgramID, material_block, MATERIAL_UNIFORM_BINDING);
+}
+
+// Cria um uniform buffer object com espaço para um CameraUniforms.
+GLuint CreateCameraUniformBuffer()
+{
+    GLuint buffer_id;
+    glGenBuffers(1, &buffer_id);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer_id);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraUniforms), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    return buffer_id;
+}
+
+// Preenche um uniform buffer object criado por CreateCameraUniformBuffer().
+// A inversa da matriz "view" e a posição da câmera são calculadas aqui, uma
+// vez, e não mais pelos shaders.
+void UploadCameraUniforms(GLuint buffer, const glm::mat4& view, const glm::mat4& projection)
+{
+    CameraUniforms uniforms;
+    uniforms.view = view;
+    uniforms.projection = projection;
+    uniforms.view_inverse = glm::inverse(view);
+    uniforms.camera_position = uniforms.view_inverse[3]; // inverse(view) * (0,0,0,1)
+
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraUniforms), &uniforms);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
 // Função que pega a matriz M e guarda a mesma no topo da pilha
@@ -1520,211 +2111,103 @@ void PopMatrix(glm::mat4& M)
     }
 }
 
-// Função que computa as normais de um ObjModel, caso elas não tenham sido
-// especificadas dentro do arquivo ".obj"
-void ComputeNormals(ObjModel* model)
+// Constrói triângulos para futura renderização a partir de um ObjModel.
+// Retorna o handle do primeiro objeto (shape) incluído; os demais objetos do
+// modelo recebem os handles seguintes, na ordem do arquivo.
+int BuildTrianglesAndAddToVirtualScene(ObjModel* model, unsigned int vertex_format)
 {
-    if ( !model->attrib.normals.empty() )
-        return;
-
-    // Primeiro computamos as normais para todos os TRIÂNGULOS.
-    // Segundo, computamos as normais dos VÉRTICES através do método proposto
-    // por Gouraud, onde a normal de cada vértice vai ser a média das normais de
-    // todas as faces que compartilham este vértice.
-
-    size_t num_vertices = model->attrib.vertices.size() / 3;
+    MeshData mesh;
+    BuildMeshData(model, mesh);
+    OptimizeMeshData(mesh);
+    GenerateMeshLODs(mesh);
+    MeshArrays arrays = GetMeshArrays(mesh);
+
+    PackedVertices vertices;
+    PackVertices(arrays, vertex_format, vertices);
+    return AddMeshToVirtualScene(arrays, vertices);
+}
 
-    std::vector<int> num_triangles_per_vertex(num_vertices, 0);
-    std::vector<glm::vec4> vertex_normals(num_vertices, glm::vec4(0.0f,0.0f,0.0f,0.0f));
+// Associa um atributo dos vértices intercalados (veja PackVertices() em
+// mesh.cpp) a uma localização do vertex shader. O VBO deve estar "ligado".
+static void SetVertexAttribute(GLuint location, const VertexAttribute& attribute, size_t stride)
+{
+    if (attribute.components == 0)
+        return;
 
-    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+    GLenum    type = GL_FLOAT;
+    GLboolean normalized = GL_FALSE;
+    switch (attribute.type)
     {
-        size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
-
-        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
-        {
-            assert(model->shapes[shape].mesh.num_face_vertices[triangle] == 3);
-
-            glm::vec4  vertices[3];
-            for (size_t vertex = 0; vertex < 3; ++vertex)
-            {
-                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
-                const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
-                const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
-                const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
-                vertices[vertex] = glm::vec4(vx,vy,vz,1.0);
-            }
-
-            const glm::vec4  a = vertices[0];
-            const glm::vec4  b = vertices[1];
-            const glm::vec4  c = vertices[2];
-
-            const glm::vec4  n = crossproduct(b-a,c-a);
-
-            for (size_t vertex = 0; vertex < 3; ++vertex)
-            {
-                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
-                num_triangles_per_vertex[idx.vertex_index] += 1;
-                vertex_normals[idx.vertex_index] += n;
-                model->shapes[shape].mesh.indices[3*triangle + vertex].normal_index = idx.vertex_index;
-            }
-        }
+        case VERTEX_ATTRIBUTE_HALF:    type = GL_HALF_FLOAT; break;
+        case VERTEX_ATTRIBUTE_SNORM16: type = GL_SHORT; normalized = GL_TRUE; break;
+        case VERTEX_ATTRIBUTE_UNORM16: type = GL_UNSIGNED_SHORT; normalized = GL_TRUE; break;
     }
 
-    model->attrib.normals.resize( 3*num_vertices );
-
-    for (size_t i = 0; i < vertex_normals.size(); ++i)
-    {
-        glm::vec4 n = vertex_normals[i] / (float)num_triangles_per_vertex[i];
-        n /= norm(n);
-        model->attrib.normals[3*i + 0] = n.x;
-        model->attrib.normals[3*i + 1] = n.y;
-        model->attrib.normals[3*i + 2] = n.z;
-    }
+    // Componentes não fornecidos são completados pela OpenGL com (0,0,0,1):
+    // as posições com três componentes recebem w = 1.
+    glVertexAttribPointer(location, attribute.components, type, normalized, (GLsizei)stride, (void*)attribute.offset);
+    glEnableVertexAttribArray(location);
 }
 
-// Constrói triângulos para futura renderização a partir de um ObjModel.
-void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
+// Cria um VAO com os vértices intercalados de uma malha (veja PackVertices()
+// em mesh.cpp) e os seus índices, e inclui cada um dos seus objetos em
+// g_VirtualScene. Retorna o handle do primeiro objeto incluído.
+int AddMeshToVirtualScene(const MeshArrays& mesh, const PackedVertices& vertices)
 {
+    int first_handle = (int)g_VirtualScene.size();
+
     GLuint vertex_array_object_id;
     glGenVertexArrays(1, &vertex_array_object_id);
     glBindVertexArray(vertex_array_object_id);
 
-    std::vector<GLuint> indices;
-    std::vector<float>  model_coefficients;
-    std::vector<float>  normal_coefficients;
-    std::vector<float>  texture_coefficients;
-
-    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+    for (size_t shape = 0; shape < mesh.shapes.size(); ++shape)
     {
-        size_t first_index = indices.size();
-        size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
-
-        const float minval = std::numeric_limits<float>::min();
-        const float maxval = std::numeric_limits<float>::max();
-
-        glm::vec3 bbox_min = glm::vec3(maxval,maxval,maxval);
-        glm::vec3 bbox_max = glm::vec3(minval,minval,minval);
-
-        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
-        {
-            assert(model->shapes[shape].mesh.num_face_vertices[triangle] == 3);
-
-            for (size_t vertex = 0; vertex < 3; ++vertex)
-            {
-                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
-
-                indices.push_back(first_index + 3*triangle + vertex);
-
-                const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
-                const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
-                const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
-                //printf("tri %d vert %d = (%.2f, %.2f, %.2f)\n", (int)triangle, (int)vertex, vx, vy, vz);
-                model_coefficients.push_back( vx ); // X
-                model_coefficients.push_back( vy ); // Y
-                model_coefficients.push_back( vz ); // Z
-                model_coefficients.push_back( 1.0f ); // W
-
-                bbox_min.x = std::min(bbox_min.x, vx);
-                bbox_min.y = std::min(bbox_min.y, vy);
-                bbox_min.z = std::min(bbox_min.z, vz);
-                bbox_max.x = std::max(bbox_max.x, vx);
-                bbox_max.y = std::max(bbox_max.y, vy);
-                bbox_max.z = std::max(bbox_max.z, vz);
-
-                // Inspecionando o código da tinyobjloader, o aluno Bernardo
-                // Sulzbach (2017/1) apontou que a maneira correta de testar se
-                // existem normais e coordenadas de textura no ObjModel é
-                // comparando se o índice retornado é -1. Fazemos isso abaixo.
-
-                if ( idx.normal_index != -1 )
-                {
-                    const float nx = model->attrib.normals[3*idx.normal_index + 0];
-                    const float ny = model->attrib.normals[3*idx.normal_index + 1];
-                    const float nz = model->attrib.normals[3*idx.normal_index + 2];
-                    normal_coefficients.push_back( nx ); // X
-                    normal_coefficients.push_back( ny ); // Y
-                    normal_coefficients.push_back( nz ); // Z
-                    normal_coefficients.push_back( 0.0f ); // W
-                }
-
-                if ( idx.texcoord_index != -1 )
-                {
-                    const float u = model->attrib.texcoords[2*idx.texcoord_index + 0];
-                    const float v = model->attrib.texcoords[2*idx.texcoord_index + 1];
-                    texture_coefficients.push_back( u );
-                    texture_coefficients.push_back( v );
-                }
-            }
-        }
-
-        size_t last_index = indices.size() - 1;
-
         SceneObject theobject;
-        theobject.name           = model->shapes[shape].name;
-        theobject.first_index    = first_index; // Primeiro índice
-        theobject.num_indices    = last_index - first_index + 1; // Número de indices
+        theobject.name           = mesh.shapes[shape].name;
+        theobject.first_index    = mesh.shapes[shape].first_index; // Primeiro índice
+        theobject.num_indices    = mesh.shapes[shape].num_indices; // Número de indices
         theobject.rendering_mode = GL_TRIANGLES;       // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
         theobject.vertex_array_object_id = vertex_array_object_id;
 
-        theobject.bbox_min = bbox_min;
-        theobject.bbox_max = bbox_max;
+        theobject.bbox_min = mesh.shapes[shape].bbox_min;
+        theobject.bbox_max = mesh.shapes[shape].bbox_max;
+        theobject.lod_error = mesh.shapes[shape].lod_error;
 
-        g_VirtualScene[model->shapes[shape].name] = theobject;
-    }
-
-    GLuint VBO_model_coefficients_id;
-    glGenBuffers(1, &VBO_model_coefficients_id);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_model_coefficients_id);
-    glBufferData(GL_ARRAY_BUFFER, model_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, model_coefficients.size() * sizeof(float), model_coefficients.data());
-    GLuint location = 0; // "(location = 0)" em "shader_vertex.glsl"
-    GLint  number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-    glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(location);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+        // Os níveis de detalhe vêm logo depois do objeto original (veja
+        // GenerateMeshLODs() em mesh.cpp) e ocupam os handles seguintes.
+        if (mesh.shapes[shape].lod_level > 0)
+            g_VirtualScene[g_VirtualScene.size() - mesh.shapes[shape].lod_level].num_lods += 1;
 
-    if ( !normal_coefficients.empty() )
-    {
-        GLuint VBO_normal_coefficients_id;
-        glGenBuffers(1, &VBO_normal_coefficients_id);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_normal_coefficients_id);
-        glBufferData(GL_ARRAY_BUFFER, normal_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, normal_coefficients.size() * sizeof(float), normal_coefficients.data());
-        location = 1; // "(location = 1)" em "shader_vertex.glsl"
-        number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-        glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-        glEnableVertexAttribArray(location);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        g_VirtualSceneHandles[mesh.shapes[shape].name] = (int)g_VirtualScene.size();
+        g_VirtualScene.push_back(theobject);
     }
 
-    if ( !texture_coefficients.empty() )
-    {
-        GLuint VBO_texture_coefficients_id;
-        glGenBuffers(1, &VBO_texture_coefficients_id);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_texture_coefficients_id);
-        glBufferData(GL_ARRAY_BUFFER, texture_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, texture_coefficients.size() * sizeof(float), texture_coefficients.data());
-        location = 2; // "(location = 1)" em "shader_vertex.glsl"
-        number_of_dimensions = 2; // vec2 em "shader_vertex.glsl"
-        glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-        glEnableVertexAttribArray(location);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-    }
+    // Um único VBO com todos os atributos de cada vértice lado a lado, de
+    // forma que a GPU busque um vértice inteiro de uma só vez.
+    GLuint VBO_vertices_id;
+    glGenBuffers(1, &VBO_vertices_id);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_vertices_id);
+    glBufferData(GL_ARRAY_BUFFER, vertices.data.size(), vertices.data.data(), GL_STATIC_DRAW);
+    SetVertexAttribute(0, vertices.position, vertices.stride);  // "(location = 0)" em "shader_vertex.glsl"
+    SetVertexAttribute(1, vertices.normal, vertices.stride);    // "(location = 1)" em "shader_vertex.glsl"
+    SetVertexAttribute(2, vertices.texcoords, vertices.stride); // "(location = 2)" em "shader_vertex.glsl"
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     GLuint indices_id;
     glGenBuffers(1, &indices_id);
 
     // "Ligamos" o buffer. Note que o tipo agora é GL_ELEMENT_ARRAY_BUFFER.
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices_id);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(GLuint), indices.data());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.num_indices * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, mesh.num_indices * sizeof(GLuint), mesh.indices);
     // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); // XXX Errado!
     //
 
     // "Desligamos" o VAO, evitando assim que operações posteriores venham a
     // alterar o mesmo. Isso evita bugs.
     glBindVertexArray(0);
+
+    return first_handle;
 }
 
 // Carrega um Vertex Shader de um arquivo GLSL. Veja definição de LoadShader() abaixo.
@@ -1895,6 +2378,7 @@ void FramebufferSizeCallback(GLFWwindow* window, int width, int height)
     // O cast para float é necessário pois números inteiros são arredondados ao
     // serem divididos!
     g_ScreenRatio = (float)width / height;
+    g_ScreenHeight = height;
 }
 
 // Variáveis globais que armazenam a última posição do cursor do mouse, para
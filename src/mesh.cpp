@@ -0,0 +1,1704 @@
+#include "mesh.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+#include <algorithm>
+#include <unordered_map>
+#include <queue>
+#include <iterator>
+
+#include <glm/vec4.hpp>
+#include <glm/geometric.hpp>
+#include <glm/gtc/packing.hpp>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+ObjModel::ObjModel(const char* filename, const char* basepath, bool triangulate, bool verbose)
+{
+    if (verbose)
+        printf("Carregando objetos do arquivo \"%s\"...\n", filename);
+
+    // Se basepath == NULL, então setamos basepath como o dirname do
+    // filename, para que os arquivos MTL sejam corretamente carregados caso
+    // estejam no mesmo diretório dos arquivos OBJ.
+    std::string fullpath(filename);
+    std::string dirname;
+    if (basepath == NULL)
+    {
+        auto i = fullpath.find_last_of("/");
+        if (i != std::string::npos)
+        {
+            dirname = fullpath.substr(0, i+1);
+            basepath = dirname.c_str();
+        }
+    }
+
+    std::string err;
+    bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filename, basepath, triangulate);
+
+    if (!ret)
+        throw std::runtime_error("Erro ao carregar o modelo \"" + fullpath + "\".\n" + err);
+
+    // Avisos da tinyobjloader (por exemplo, arquivo MTL ausente): uma única
+    // chamada, para não se misturarem com as mensagens de outras threads.
+    if (!err.empty())
+        fprintf(stderr, "\n%s\n", err.c_str());
+
+    for (size_t shape = 0; shape < shapes.size(); ++shape)
+    {
+        if (shapes[shape].name.empty())
+            throw std::runtime_error("Objeto sem nome dentro do arquivo '" + fullpath + "'.\n"
+                                     "Veja https://www.inf.ufrgs.br/~eslgastal/fcg-faq-etc.html#Modelos-3D-no-formato-OBJ .");
+        if (verbose)
+            printf("- Objeto '%s'\n", shapes[shape].name.c_str());
+    }
+
+    if (verbose)
+        printf("OK.\n");
+}
+
+// Função que computa as normais de um ObjModel, caso elas não tenham sido
+// especificadas dentro do arquivo ".obj"
+void ComputeNormals(ObjModel* model)
+{
+    if ( !model->attrib.normals.empty() )
+        return;
+
+    // Primeiro computamos as normais para todos os TRIÂNGULOS.
+    // Segundo, computamos as normais dos VÉRTICES através do método proposto
+    // por Gouraud, onde a normal de cada vértice vai ser a média das normais de
+    // todas as faces que compartilham este vértice.
+
+    size_t num_vertices = model->attrib.vertices.size() / 3;
+
+    std::vector<int> num_triangles_per_vertex(num_vertices, 0);
+    std::vector<glm::vec4> vertex_normals(num_vertices, glm::vec4(0.0f,0.0f,0.0f,0.0f));
+
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+    {
+        size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
+
+        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
+        {
+            assert(model->shapes[shape].mesh.num_face_vertices[triangle] == 3);
+
+            glm::vec3  vertices[3];
+            for (size_t vertex = 0; vertex < 3; ++vertex)
+            {
+                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
+                const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
+                const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
+                const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
+                vertices[vertex] = glm::vec3(vx,vy,vz);
+            }
+
+            const glm::vec3  a = vertices[0];
+            const glm::vec3  b = vertices[1];
+            const glm::vec3  c = vertices[2];
+
+            const glm::vec4  n = glm::vec4(glm::cross(b-a,c-a), 0.0f);
+
+            for (size_t vertex = 0; vertex < 3; ++vertex)
+            {
+                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
+                num_triangles_per_vertex[idx.vertex_index] += 1;
+                vertex_normals[idx.vertex_index] += n;
+                model->shapes[shape].mesh.indices[3*triangle + vertex].normal_index = idx.vertex_index;
+            }
+        }
+    }
+
+    model->attrib.normals.resize( 3*num_vertices );
+
+    for (size_t i = 0; i < vertex_normals.size(); ++i)
+    {
+        glm::vec4 n = vertex_normals[i] / (float)num_triangles_per_vertex[i];
+        n /= glm::length(glm::vec3(n));
+        model->attrib.normals[3*i + 0] = n.x;
+        model->attrib.normals[3*i + 1] = n.y;
+        model->attrib.normals[3*i + 2] = n.z;
+    }
+}
+
+// Chave usada para soldar vértices: posição, normal e coordenadas de textura.
+// Os valores são comparados bit a bit, de modo que somente vértices
+// exatamente iguais são unidos.
+struct VertexKey
+{
+    float attributes[8];
+
+    bool operator==(const VertexKey& other) const
+    {
+        return memcmp(attributes, other.attributes, sizeof(attributes)) == 0;
+    }
+};
+
+struct VertexKeyHash
+{
+    size_t operator()(const VertexKey& key) const
+    {
+        return (size_t)HashBytes((const unsigned char*)key.attributes, sizeof(key.attributes));
+    }
+};
+
+// Constrói os vetores que serão enviados para a GPU a partir de um ObjModel.
+// Os cantos de triângulos com a mesma posição, normal e coordenadas de
+// textura são soldados em um único vértice, de forma que cada vértice é
+// transformado uma única vez pela GPU enquanto permanecer na sua cache de
+// vértices transformados. Os índices de cada objeto (shape) ficam em
+// sequência dentro de mesh.indices e referenciam somente vértices do próprio
+// objeto.
+void BuildMeshData(ObjModel* model, MeshData& mesh)
+{
+    std::unordered_map<VertexKey, uint32_t, VertexKeyHash> vertices;
+
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+    {
+        size_t first_index = mesh.indices.size();
+        size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
+
+        const float minval = std::numeric_limits<float>::min();
+        const float maxval = std::numeric_limits<float>::max();
+
+        glm::vec3 bbox_min = glm::vec3(maxval,maxval,maxval);
+        glm::vec3 bbox_max = glm::vec3(minval,minval,minval);
+
+        vertices.clear();
+        vertices.reserve(3*num_triangles);
+
+        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
+        {
+            assert(model->shapes[shape].mesh.num_face_vertices[triangle] == 3);
+
+            for (size_t vertex = 0; vertex < 3; ++vertex)
+            {
+                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
+
+                const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
+                const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
+                const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
+
+                bbox_min.x = std::min(bbox_min.x, vx);
+                bbox_min.y = std::min(bbox_min.y, vy);
+                bbox_min.z = std::min(bbox_min.z, vz);
+                bbox_max.x = std::max(bbox_max.x, vx);
+                bbox_max.y = std::max(bbox_max.y, vy);
+                bbox_max.z = std::max(bbox_max.z, vz);
+
+                // Inspecionando o código da tinyobjloader, o aluno Bernardo
+                // Sulzbach (2017/1) apontou que a maneira correta de testar se
+                // existem normais e coordenadas de textura no ObjModel é
+                // comparando se o índice retornado é -1. Fazemos isso abaixo.
+
+                VertexKey key;
+                memset(&key, 0, sizeof(key));
+                key.attributes[0] = vx;
+                key.attributes[1] = vy;
+                key.attributes[2] = vz;
+                if ( idx.normal_index != -1 )
+                {
+                    key.attributes[3] = model->attrib.normals[3*idx.normal_index + 0];
+                    key.attributes[4] = model->attrib.normals[3*idx.normal_index + 1];
+                    key.attributes[5] = model->attrib.normals[3*idx.normal_index + 2];
+                }
+                if ( idx.texcoord_index != -1 )
+                {
+                    key.attributes[6] = model->attrib.texcoords[2*idx.texcoord_index + 0];
+                    key.attributes[7] = model->attrib.texcoords[2*idx.texcoord_index + 1];
+                }
+
+                uint32_t new_vertex = (uint32_t)(mesh.model_coefficients.size() / 4);
+                std::pair<std::unordered_map<VertexKey, uint32_t, VertexKeyHash>::iterator, bool> inserted =
+                    vertices.insert(std::make_pair(key, new_vertex));
+
+                mesh.indices.push_back(inserted.first->second);
+                if (!inserted.second)
+                    continue; // Vértice já emitido por outro triângulo deste objeto
+
+                mesh.model_coefficients.push_back( vx ); // X
+                mesh.model_coefficients.push_back( vy ); // Y
+                mesh.model_coefficients.push_back( vz ); // Z
+                mesh.model_coefficients.push_back( 1.0f ); // W
+
+                if ( idx.normal_index != -1 )
+                {
+                    mesh.normal_coefficients.push_back( key.attributes[3] ); // X
+                    mesh.normal_coefficients.push_back( key.attributes[4] ); // Y
+                    mesh.normal_coefficients.push_back( key.attributes[5] ); // Z
+                    mesh.normal_coefficients.push_back( 0.0f ); // W
+                }
+
+                if ( idx.texcoord_index != -1 )
+                {
+                    mesh.texture_coefficients.push_back( key.attributes[6] ); // U
+                    mesh.texture_coefficients.push_back( key.attributes[7] ); // V
+                }
+            }
+        }
+
+        MeshShape theshape;
+        theshape.name         = model->shapes[shape].name;
+        theshape.first_index  = first_index;
+        theshape.num_indices  = mesh.indices.size() - first_index;
+        theshape.num_vertices = vertices.size();
+        theshape.bbox_min     = bbox_min;
+        theshape.bbox_max     = bbox_max;
+        mesh.shapes.push_back(theshape);
+    }
+}
+
+// Simula a cache FIFO de vértices transformados da GPU para um triângulo e
+// retorna quantos dos seus vértices não estavam nela. Um vértice está na
+// cache se foi incluído há no máximo "cache_size" inclusões; somar
+// cache_size+1 a "timestamp" esvazia a cache.
+static unsigned int UpdateVertexCache(const uint32_t* triangle, unsigned int cache_size,
+                                      std::vector<unsigned int>& timestamps, unsigned int& timestamp)
+{
+    unsigned int misses = 0;
+    for (int k = 0; k < 3; ++k)
+    {
+        if (timestamp - timestamps[triangle[k]] > cache_size)
+        {
+            timestamps[triangle[k]] = timestamp++;
+            misses += 1;
+        }
+    }
+    return misses;
+}
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t num_indices, unsigned int cache_size)
+{
+    VertexCacheStatistics statistics;
+    statistics.num_triangles = num_indices / 3;
+
+    uint32_t max_index = 0;
+    for (size_t i = 0; i < num_indices; ++i)
+        max_index = std::max(max_index, indices[i]);
+
+    std::vector<unsigned int> timestamps(num_indices > 0 ? max_index + 1 : 0, 0);
+    std::vector<bool> used(timestamps.size(), false);
+    unsigned int timestamp = cache_size + 1;
+
+    for (size_t triangle = 0; triangle < statistics.num_triangles; ++triangle)
+        statistics.cache_misses += UpdateVertexCache(indices + 3*triangle, cache_size, timestamps, timestamp);
+
+    for (size_t i = 0; i < num_indices; ++i)
+    {
+        if (!used[indices[i]])
+            statistics.num_vertices += 1;
+        used[indices[i]] = true;
+    }
+
+    if (statistics.num_triangles > 0)
+        statistics.acmr = (float)statistics.cache_misses / statistics.num_triangles;
+    if (statistics.num_vertices > 0)
+        statistics.atvr = (float)statistics.cache_misses / statistics.num_vertices;
+    return statistics;
+}
+
+// Reordena os triângulos com o algoritmo Tipsify (Sander, Nehab e Barczak,
+// "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007):
+// os triângulos são emitidos em leques ao redor de um vértice, e o próximo
+// vértice é o que ainda tem triângulos e deve continuar na cache depois de
+// emiti-los. Quando nenhum serve, o algoritmo volta para um vértice emitido
+// recentemente ("dead-end"). Os índices devem estar entre 0 e num_vertices-1.
+static void TipsifyTriangles(const uint32_t* indices, size_t num_triangles, size_t num_vertices,
+                             unsigned int cache_size, std::vector<uint32_t>& order)
+{
+    // Triângulos de cada vértice ainda não emitidos ("live") e lista de
+    // adjacência vértice -> triângulos.
+    std::vector<uint32_t> live(num_vertices, 0);
+    for (size_t i = 0; i < 3*num_triangles; ++i)
+        live[indices[i]] += 1;
+
+    std::vector<uint32_t> offsets(num_vertices + 1, 0);
+    for (size_t v = 0; v < num_vertices; ++v)
+        offsets[v + 1] = offsets[v] + live[v];
+
+    std::vector<uint32_t> adjacency(3*num_triangles);
+    std::vector<uint32_t> filled(offsets.begin(), offsets.end() - 1);
+    for (size_t triangle = 0; triangle < num_triangles; ++triangle)
+        for (int k = 0; k < 3; ++k)
+            adjacency[filled[indices[3*triangle + k]]++] = (uint32_t)triangle;
+
+    std::vector<unsigned int> timestamps(num_vertices, 0);
+    unsigned int timestamp = cache_size + 1;
+
+    std::vector<bool>     emitted(num_triangles, false);
+    std::vector<uint32_t> dead_end;
+    std::vector<uint32_t> candidates;
+    size_t cursor = 0;
+
+    order.clear();
+    order.reserve(num_triangles);
+
+    while (cursor < num_vertices && live[cursor] == 0)
+        ++cursor;
+    long fanning = cursor < num_vertices ? (long)cursor : -1;
+
+    while (fanning >= 0)
+    {
+        candidates.clear();
+
+        for (uint32_t a = offsets[fanning]; a < offsets[fanning + 1]; ++a)
+        {
+            uint32_t triangle = adjacency[a];
+            if (emitted[triangle])
+                continue;
+
+            for (int k = 0; k < 3; ++k)
+            {
+                uint32_t v = indices[3*triangle + k];
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                live[v] -= 1;
+                if (timestamp - timestamps[v] > cache_size)
+                    timestamps[v] = timestamp++;
+            }
+            emitted[triangle] = true;
+            order.push_back(triangle);
+        }
+
+        // Próximo vértice: o que ainda tem triângulos e cujos vértices, depois
+        // de emitidos, não expulsarão o próprio vértice da cache; entre eles,
+        // o que está há mais tempo na cache.
+        fanning = -1;
+        long best_priority = -1;
+        for (size_t c = 0; c < candidates.size(); ++c)
+        {
+            uint32_t v = candidates[c];
+            if (live[v] == 0)
+                continue;
+
+            long priority = 0;
+            if (timestamp - timestamps[v] + 2*live[v] <= cache_size)
+                priority = timestamp - timestamps[v];
+            if (priority > best_priority)
+            {
+                best_priority = priority;
+                fanning = v;
+            }
+        }
+
+        while (fanning < 0 && !dead_end.empty())
+        {
+            uint32_t v = dead_end.back();
+            dead_end.pop_back();
+            if (live[v] > 0)
+                fanning = v;
+        }
+
+        while (fanning < 0 && cursor < num_vertices)
+        {
+            if (live[cursor] > 0)
+                fanning = (long)cursor;
+            else
+                ++cursor;
+        }
+    }
+}
+
+// Divide a sequência de triângulos (já ordenada por TipsifyTriangles()) em
+// grupos que podem ser desenhados em qualquer ordem sem aumentar muito o ACMR.
+// Um grupo começa onde os três vértices de um triângulo faltam na cache
+// (uma nova região da malha) e é subdividido sempre que o ACMR acumulado
+// desde o início do subgrupo chega a MESH_OVERDRAW_THRESHOLD vezes o ACMR do
+// grupo inteiro. Retorna o primeiro triângulo de cada grupo.
+static void FindTriangleClusters(const uint32_t* indices, size_t num_triangles, size_t num_vertices,
+                                 unsigned int cache_size, std::vector<uint32_t>& clusters)
+{
+    std::vector<unsigned int> timestamps(num_vertices, 0);
+    unsigned int timestamp = cache_size + 1;
+
+    std::vector<uint32_t> hard;
+    for (size_t triangle = 0; triangle < num_triangles; ++triangle)
+    {
+        unsigned int misses = UpdateVertexCache(indices + 3*triangle, cache_size, timestamps, timestamp);
+        if (triangle == 0 || misses == 3)
+            hard.push_back((uint32_t)triangle);
+    }
+
+    clusters.clear();
+    for (size_t h = 0; h < hard.size(); ++h)
+    {
+        size_t start = hard[h];
+        size_t end = h + 1 < hard.size() ? hard[h + 1] : num_triangles;
+
+        timestamp += cache_size + 1;
+        unsigned int cluster_misses = 0;
+        for (size_t triangle = start; triangle < end; ++triangle)
+            cluster_misses += UpdateVertexCache(indices + 3*triangle, cache_size, timestamps, timestamp);
+        float threshold = MESH_OVERDRAW_THRESHOLD * cluster_misses / (end - start);
+
+        size_t first_cluster = clusters.size();
+        clusters.push_back((uint32_t)start);
+
+        timestamp += cache_size + 1;
+        unsigned int running_misses = 0;
+        unsigned int running_triangles = 0;
+        for (size_t triangle = start; triangle < end; ++triangle)
+        {
+            running_misses += UpdateVertexCache(indices + 3*triangle, cache_size, timestamps, timestamp);
+            running_triangles += 1;
+
+            if ((float)running_misses / running_triangles <= threshold)
+            {
+                clusters.push_back((uint32_t)(triangle + 1));
+                timestamp += cache_size + 1;
+                running_misses = 0;
+                running_triangles = 0;
+            }
+        }
+
+        // O último subgrupo raramente atinge o limite; ele é unido ao anterior
+        // (ou, se estiver vazio, simplesmente descartado).
+        if (clusters.size() > first_cluster + 1)
+            clusters.pop_back();
+    }
+}
+
+// Reordena os triângulos de um objeto para a cache de vértices (Tipsify) e
+// depois os grupos de triângulos de fora para dentro: grupos cuja normal
+// média aponta para longe do centro do objeto tendem a ficar na frente dos
+// demais, e desenhá-los primeiro permite que o teste de profundidade descarte
+// mais fragmentos dos grupos seguintes (menos overdraw).
+static void OptimizeTriangleOrder(uint32_t* indices, size_t num_triangles, size_t num_vertices, const float* positions)
+{
+    if (num_triangles == 0)
+        return;
+
+    std::vector<uint32_t> order;
+    TipsifyTriangles(indices, num_triangles, num_vertices, MESH_VERTEX_CACHE_SIZE, order);
+
+    std::vector<uint32_t> tipsified(3*num_triangles);
+    for (size_t t = 0; t < num_triangles; ++t)
+        for (int k = 0; k < 3; ++k)
+            tipsified[3*t + k] = indices[3*order[t] + k];
+
+    std::vector<uint32_t> clusters;
+    FindTriangleClusters(tipsified.data(), num_triangles, num_vertices, MESH_VERTEX_CACHE_SIZE, clusters);
+
+    std::vector<glm::vec3> centroids(clusters.size(), glm::vec3(0.0f));
+    std::vector<glm::vec3> normals(clusters.size(), glm::vec3(0.0f));
+    std::vector<float>     areas(clusters.size(), 0.0f);
+    glm::vec3 mesh_centroid(0.0f);
+    float mesh_area = 0.0f;
+
+    for (size_t c = 0; c < clusters.size(); ++c)
+    {
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : num_triangles;
+        for (size_t t = clusters[c]; t < end; ++t)
+        {
+            const float* p0 = positions + 4*tipsified[3*t + 0];
+            const float* p1 = positions + 4*tipsified[3*t + 1];
+            const float* p2 = positions + 4*tipsified[3*t + 2];
+            glm::vec3 a(p0[0], p0[1], p0[2]);
+            glm::vec3 b(p1[0], p1[1], p1[2]);
+            glm::vec3 d(p2[0], p2[1], p2[2]);
+
+            glm::vec3 normal = glm::cross(b - a, d - a);
+            float area = glm::length(normal);
+
+            centroids[c] += (a + b + d) * (area / 3.0f);
+            normals[c]   += normal;
+            areas[c]     += area;
+        }
+        mesh_centroid += centroids[c];
+        mesh_area     += areas[c];
+    }
+    if (mesh_area > 0.0f)
+        mesh_centroid /= mesh_area;
+
+    std::vector<float> sort_keys(clusters.size(), 0.0f);
+    for (size_t c = 0; c < clusters.size(); ++c)
+    {
+        float length = glm::length(normals[c]);
+        if (areas[c] > 0.0f && length > 0.0f)
+            sort_keys[c] = glm::dot(centroids[c] / areas[c] - mesh_centroid, normals[c] / length);
+    }
+
+    std::vector<uint32_t> cluster_order(clusters.size());
+    for (size_t c = 0; c < clusters.size(); ++c)
+        cluster_order[c] = (uint32_t)c;
+    std::stable_sort(cluster_order.begin(), cluster_order.end(),
+                     [&sort_keys](uint32_t a, uint32_t b) { return sort_keys[a] > sort_keys[b]; });
+
+    uint32_t* destination = indices;
+    for (size_t i = 0; i < cluster_order.size(); ++i)
+    {
+        size_t c = cluster_order[i];
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : num_triangles;
+        destination = std::copy(tipsified.begin() + 3*clusters[c], tipsified.begin() + 3*end, destination);
+    }
+}
+
+void OptimizeMeshData(MeshData& mesh)
+{
+    bool has_normals   = !mesh.normal_coefficients.empty();
+    bool has_texcoords = !mesh.texture_coefficients.empty();
+
+    std::vector<float> model_coefficients(mesh.model_coefficients.size());
+    std::vector<float> normal_coefficients(mesh.normal_coefficients.size());
+    std::vector<float> texture_coefficients(mesh.texture_coefficients.size());
+
+    // Os vértices de cada objeto ocupam um intervalo próprio, na ordem dos
+    // objetos; veja BuildMeshData().
+    uint32_t first_vertex = 0;
+    for (size_t shape = 0; shape < mesh.shapes.size(); ++shape)
+    {
+        uint32_t* indices = mesh.indices.data() + mesh.shapes[shape].first_index;
+        size_t num_indices = mesh.shapes[shape].num_indices;
+        size_t num_vertices = mesh.shapes[shape].num_vertices;
+
+        for (size_t i = 0; i < num_indices; ++i)
+            indices[i] -= first_vertex;
+
+        OptimizeTriangleOrder(indices, num_indices / 3, num_vertices,
+                              mesh.model_coefficients.data() + 4*first_vertex);
+
+        // Os vértices são renumerados na ordem em que os triângulos os usam
+        // pela primeira vez, de forma que a GPU os leia dos VBOs em sequência.
+        const uint32_t unused = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> remap(num_vertices, unused);
+        uint32_t next_vertex = 0;
+        for (size_t i = 0; i < num_indices; ++i)
+        {
+            if (remap[indices[i]] == unused)
+                remap[indices[i]] = next_vertex++;
+            indices[i] = first_vertex + remap[indices[i]];
+        }
+        for (size_t v = 0; v < num_vertices; ++v)
+            if (remap[v] == unused)
+                remap[v] = next_vertex++;
+
+        for (size_t v = 0; v < num_vertices; ++v)
+        {
+            size_t from = first_vertex + v;
+            size_t to = first_vertex + remap[v];
+            std::copy(&mesh.model_coefficients[4*from], &mesh.model_coefficients[4*from] + 4, &model_coefficients[4*to]);
+            if (has_normals)
+                std::copy(&mesh.normal_coefficients[4*from], &mesh.normal_coefficients[4*from] + 4, &normal_coefficients[4*to]);
+            if (has_texcoords)
+                std::copy(&mesh.texture_coefficients[2*from], &mesh.texture_coefficients[2*from] + 2, &texture_coefficients[2*to]);
+        }
+
+        first_vertex += (uint32_t)num_vertices;
+    }
+
+    mesh.model_coefficients.swap(model_coefficients);
+    mesh.normal_coefficients.swap(normal_coefficients);
+    mesh.texture_coefficients.swap(texture_coefficients);
+}
+
+void PrintVertexCacheReport(const char* filename, const MeshArrays& before, const MeshArrays& after)
+{
+    for (size_t i = 0; i < before.shapes.size(); ++i)
+    {
+        size_t j = 0;
+        while (j < after.shapes.size() && after.shapes[j].name != before.shapes[i].name)
+            ++j;
+        if (j == after.shapes.size())
+            continue;
+
+        VertexCacheStatistics a = AnalyzeVertexCache(before.indices + before.shapes[i].first_index, before.shapes[i].num_indices);
+        VertexCacheStatistics b = AnalyzeVertexCache(after.indices + after.shapes[j].first_index, after.shapes[j].num_indices);
+        printf("%s: objeto '%s': ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (cache de %d vertices)\n",
+               filename, before.shapes[i].name.c_str(), a.acmr, b.acmr, a.atvr, b.atvr, MESH_VERTEX_CACHE_SIZE);
+    }
+}
+
+// Quádrica de erro (Garland e Heckbert, "Surface Simplification Using
+// Quadric Error Metrics", 1997): soma dos quadrados das distâncias de um
+// ponto aos planos dos triângulos vizinhos, ponderada pela área de cada um.
+// Somente os 10 coeficientes distintos da matriz simétrica 4x4 são guardados.
+struct Quadric
+{
+    double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+    double weight;
+};
+
+// Inclui o plano n.x + d = 0 (n unitário) com o peso dado.
+static void AddPlaneQuadric(Quadric& q, const glm::vec3& n, float d, double weight)
+{
+    double a = n.x, b = n.y, c = n.z;
+    q.a2 += weight*a*a; q.ab += weight*a*b; q.ac += weight*a*c; q.ad += weight*a*d;
+    q.b2 += weight*b*b; q.bc += weight*b*c; q.bd += weight*b*d;
+    q.c2 += weight*c*c; q.cd += weight*c*d;
+    q.d2 += weight*(double)d*d;
+    q.weight += weight;
+}
+
+static Quadric SumQuadrics(const Quadric& q, const Quadric& r)
+{
+    Quadric s;
+    s.a2 = q.a2 + r.a2; s.ab = q.ab + r.ab; s.ac = q.ac + r.ac; s.ad = q.ad + r.ad;
+    s.b2 = q.b2 + r.b2; s.bc = q.bc + r.bc; s.bd = q.bd + r.bd;
+    s.c2 = q.c2 + r.c2; s.cd = q.cd + r.cd;
+    s.d2 = q.d2 + r.d2;
+    s.weight = q.weight + r.weight;
+    return s;
+}
+
+// Média ponderada dos quadrados das distâncias de "p" aos planos da quádrica.
+static double QuadricError(const Quadric& q, const glm::vec3& p)
+{
+    double x = p.x, y = p.y, z = p.z;
+    double error = q.a2*x*x + 2.0*q.ab*x*y + 2.0*q.ac*x*z + 2.0*q.ad*x
+                 + q.b2*y*y + 2.0*q.bc*y*z + 2.0*q.bd*y
+                 + q.c2*z*z + 2.0*q.cd*z
+                 + q.d2;
+    return q.weight > 0.0 ? std::max(0.0, error) / q.weight : 0.0;
+}
+
+// Distância de um ponto a um triângulo (Ericson, "Real-Time Collision
+// Detection", seção 5.1.5).
+static float PointTriangleDistance(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+    float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f)
+        return glm::length(ap);
+
+    glm::vec3 bp = p - b;
+    float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3)
+        return glm::length(bp);
+
+    float vc = d1*d4 - d3*d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        return glm::length(p - (a + ab * (d1 / (d1 - d3))));
+
+    glm::vec3 cp = p - c;
+    float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6)
+        return glm::length(cp);
+
+    float vb = d5*d2 - d1*d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        return glm::length(p - (a + ac * (d2 / (d2 - d6))));
+
+    float va = d3*d6 - d5*d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+        return glm::length(p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+
+    float denominator = 1.0f / (va + vb + vc);
+    return glm::length(p - (a + ab * (vb * denominator) + ac * (vc * denominator)));
+}
+
+// Maior distância de um conjunto de pontos até uma superfície (três cantos
+// por triângulo em "corners"): a distância de Hausdorff em um sentido. Os
+// triângulos são distribuídos em uma grade uniforme, e cada ponto procura em
+// camadas de células cada vez mais distantes, parando quando nenhuma célula
+// ainda não visitada pode conter um triângulo mais próximo.
+static float MaxDistanceToTriangles(const std::vector<glm::vec3>& points, const std::vector<glm::vec3>& corners)
+{
+    size_t num_triangles = corners.size() / 3;
+    if (num_triangles == 0 || points.empty())
+        return 0.0f;
+
+    glm::vec3 low = corners[0], high = corners[0];
+    for (size_t i = 0; i < corners.size(); ++i)
+    {
+        low = glm::min(low, corners[i]);
+        high = glm::max(high, corners[i]);
+    }
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        low = glm::min(low, points[i]);
+        high = glm::max(high, points[i]);
+    }
+
+    // Com o dobro da raiz cúbica do número de triângulos por eixo, uma
+    // superfície ocupa poucas células e cada uma tem poucos triângulos.
+    int resolution = std::max(1, std::min(128, (int)std::ceil(2.0*std::cbrt((double)num_triangles))));
+    glm::vec3 cell = glm::max((high - low) / (float)resolution, glm::vec3(1e-12f));
+    float min_cell = std::min(cell.x, std::min(cell.y, cell.z));
+
+    auto cell_of = [&](const glm::vec3& p, int axis)
+    {
+        return std::max(0, std::min(resolution - 1, (int)((p[axis] - low[axis]) / cell[axis])));
+    };
+
+    // Triângulos de cada célula, em um único vetor: os da célula c ficam em
+    // cell_triangles[cell_offsets[c]] até cell_triangles[cell_offsets[c+1]-1].
+    std::vector<uint32_t> cell_offsets(resolution*resolution*resolution + 1, 0);
+    std::vector<uint32_t> cell_triangles;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (size_t t = 0; t < num_triangles; ++t)
+        {
+            glm::vec3 a = glm::min(corners[3*t], glm::min(corners[3*t + 1], corners[3*t + 2]));
+            glm::vec3 b = glm::max(corners[3*t], glm::max(corners[3*t + 1], corners[3*t + 2]));
+            for (int x = cell_of(a, 0); x <= cell_of(b, 0); ++x)
+                for (int y = cell_of(a, 1); y <= cell_of(b, 1); ++y)
+                    for (int z = cell_of(a, 2); z <= cell_of(b, 2); ++z)
+                    {
+                        size_t c = (x*resolution + y)*resolution + z;
+                        if (pass == 0)
+                            cell_offsets[c + 1] += 1;
+                        else
+                            cell_triangles[cell_offsets[c]++] = (uint32_t)t;
+                    }
+        }
+        if (pass == 0)
+        {
+            for (size_t c = 1; c < cell_offsets.size(); ++c)
+                cell_offsets[c] += cell_offsets[c - 1];
+            cell_triangles.resize(cell_offsets.back());
+        }
+    }
+    // O segundo passo avançou cada início até o início da célula seguinte.
+    for (size_t c = cell_offsets.size() - 1; c > 0; --c)
+        cell_offsets[c] = cell_offsets[c - 1];
+    cell_offsets[0] = 0;
+
+    float max_distance = 0.0f;
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        const glm::vec3& p = points[i];
+        int px = cell_of(p, 0), py = cell_of(p, 1), pz = cell_of(p, 2);
+        float distance = std::numeric_limits<float>::max();
+
+        for (int shell = 0; shell <= resolution; ++shell)
+        {
+            // Células fora da camada "shell" estão a pelo menos (shell-1)*min_cell do ponto.
+            if (shell > 0 && distance <= (shell - 1) * min_cell)
+                break;
+            for (int x = std::max(0, px - shell); x <= std::min(resolution - 1, px + shell); ++x)
+                for (int y = std::max(0, py - shell); y <= std::min(resolution - 1, py + shell); ++y)
+                    for (int z = std::max(0, pz - shell); z <= std::min(resolution - 1, pz + shell); ++z)
+                    {
+                        if (std::max(std::abs(x - px), std::max(std::abs(y - py), std::abs(z - pz))) != shell)
+                            continue;
+
+                        // Células mais distantes que o triângulo mais próximo já encontrado são ignoradas.
+                        glm::vec3 cell_low = low + cell * glm::vec3((float)x, (float)y, (float)z);
+                        glm::vec3 offset = glm::max(glm::max(cell_low - p, p - (cell_low + cell)), glm::vec3(0.0f));
+                        if (glm::dot(offset, offset) >= distance*distance)
+                            continue;
+
+                        size_t c = (x*resolution + y)*resolution + z;
+                        for (size_t k = cell_offsets[c]; k < cell_offsets[c + 1]; ++k)
+                        {
+                            uint32_t t = cell_triangles[k];
+                            distance = std::min(distance, PointTriangleDistance(p, corners[3*t], corners[3*t + 1], corners[3*t + 2]));
+                        }
+                    }
+        }
+        max_distance = std::max(max_distance, distance);
+    }
+    return max_distance;
+}
+
+// Colapso candidato de uma aresta: o vértice "from" é movido para "to". As
+// versões permitem descartar candidatos calculados antes de uma alteração
+// em algum dos dois vértices.
+struct EdgeCollapse
+{
+    double   cost;
+    uint32_t from;
+    uint32_t to;
+    uint32_t version_from;
+    uint32_t version_to;
+
+    bool operator<(const EdgeCollapse& other) const { return cost > other.cost; } // Menor custo primeiro na priority_queue
+};
+
+// Simplificação de um objeto para os seus níveis de detalhe. Trabalha sobre as
+// posições (os vértices com a mesma posição, separados somente por normais ou
+// coordenadas de textura diferentes, são unidos) e somente move vértices para
+// a posição de um vizinho, de forma que os triângulos simplificados continuam
+// referenciando os vértices originais, que não precisam ser duplicados.
+// Gera até MESH_MAX_LODS níveis, cada um com MESH_LOD_RATIO vezes os
+// triângulos do anterior. O erro de cada nível é a maior distância de um
+// ponto original até a superfície simplificada (a quádrica, que é uma média
+// ponderada, subestima bastante esse valor).
+static void SimplifyShape(const uint32_t* indices, size_t num_triangles, size_t num_vertices,
+                          const float* positions, const float* normals, const float* texcoords,
+                          std::vector< std::vector<uint32_t> >& levels, std::vector<float>& errors)
+{
+    levels.clear();
+    errors.clear();
+
+    // Vértices com a mesma posição formam um único ponto; "wedges" guarda os
+    // vértices originais de cada ponto.
+    std::unordered_map<VertexKey, uint32_t, VertexKeyHash> point_of_position;
+    std::vector<uint32_t> point_of(num_vertices);
+    std::vector<glm::vec3> points;
+    std::vector< std::vector<uint32_t> > wedges;
+    for (size_t v = 0; v < num_vertices; ++v)
+    {
+        VertexKey key;
+        memset(&key, 0, sizeof(key));
+        memcpy(key.attributes, positions + 4*v, 3*sizeof(float));
+        std::pair<std::unordered_map<VertexKey, uint32_t, VertexKeyHash>::iterator, bool> inserted =
+            point_of_position.insert(std::make_pair(key, (uint32_t)points.size()));
+        if (inserted.second)
+        {
+            points.push_back(glm::vec3(positions[4*v + 0], positions[4*v + 1], positions[4*v + 2]));
+            wedges.push_back(std::vector<uint32_t>());
+        }
+        point_of[v] = inserted.first->second;
+        wedges[point_of[v]].push_back((uint32_t)v);
+    }
+    size_t num_points = points.size();
+
+    std::vector<uint32_t> triangles(3*num_triangles);
+    std::vector<bool> alive(num_triangles, false);
+    std::vector< std::vector<uint32_t> > point_triangles(num_points);
+    std::vector<Quadric> quadrics(num_points);
+    memset(quadrics.data(), 0, num_points*sizeof(Quadric));
+    size_t num_alive = 0;
+
+    for (size_t t = 0; t < num_triangles; ++t)
+    {
+        for (int k = 0; k < 3; ++k)
+            triangles[3*t + k] = point_of[indices[3*t + k]];
+
+        uint32_t* p = &triangles[3*t];
+        if (p[0] == p[1] || p[1] == p[2] || p[0] == p[2])
+            continue;
+
+        alive[t] = true;
+        num_alive += 1;
+        for (int k = 0; k < 3; ++k)
+            point_triangles[p[k]].push_back((uint32_t)t);
+
+        glm::vec3 normal = glm::cross(points[p[1]] - points[p[0]], points[p[2]] - points[p[0]]);
+        float length = glm::length(normal);
+        if (length == 0.0f)
+            continue;
+        normal /= length;
+        for (int k = 0; k < 3; ++k)
+            AddPlaneQuadric(quadrics[p[k]], normal, -glm::dot(normal, points[p[0]]), 0.5*length);
+    }
+
+    // Arestas da borda (de um único triângulo) recebem um plano perpendicular
+    // ao triângulo, com peso alto, para que a silhueta aberta seja preservada.
+    std::unordered_map<uint64_t, int> edge_triangles;
+    for (size_t t = 0; t < num_triangles; ++t)
+    {
+        if (!alive[t])
+            continue;
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t a = triangles[3*t + k], b = triangles[3*t + (k + 1) % 3];
+            edge_triangles[((uint64_t)std::min(a, b) << 32) | std::max(a, b)] += 1;
+        }
+    }
+    for (size_t t = 0; t < num_triangles; ++t)
+    {
+        if (!alive[t])
+            continue;
+        const uint32_t* p = &triangles[3*t];
+        glm::vec3 normal = glm::cross(points[p[1]] - points[p[0]], points[p[2]] - points[p[0]]);
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t a = p[k], b = p[(k + 1) % 3];
+            if (edge_triangles[((uint64_t)std::min(a, b) << 32) | std::max(a, b)] != 1)
+                continue;
+            glm::vec3 edge = points[b] - points[a];
+            glm::vec3 border_normal = glm::cross(edge, normal);
+            float length = glm::length(border_normal);
+            if (length == 0.0f)
+                continue;
+            border_normal /= length;
+            double weight = MESH_LOD_BORDER_WEIGHT * glm::dot(edge, edge);
+            float d = -glm::dot(border_normal, points[a]);
+            AddPlaneQuadric(quadrics[a], border_normal, d, weight);
+            AddPlaneQuadric(quadrics[b], border_normal, d, weight);
+        }
+    }
+
+    std::vector<uint32_t> versions(num_points, 0);
+    std::vector<bool> removed(num_points, false);
+    std::priority_queue<EdgeCollapse> collapses;
+
+    // Inclui o colapso mais barato, em um dos dois sentidos, da aresta a-b.
+    auto push_edge = [&](uint32_t a, uint32_t b)
+    {
+        Quadric q = SumQuadrics(quadrics[a], quadrics[b]);
+        EdgeCollapse collapse;
+        double cost_ab = QuadricError(q, points[b]);
+        double cost_ba = QuadricError(q, points[a]);
+        collapse.from = cost_ab <= cost_ba ? a : b;
+        collapse.to   = cost_ab <= cost_ba ? b : a;
+        collapse.cost = std::min(cost_ab, cost_ba);
+        collapse.version_from = versions[collapse.from];
+        collapse.version_to   = versions[collapse.to];
+        collapses.push(collapse);
+    };
+
+    for (std::unordered_map<uint64_t, int>::const_iterator it = edge_triangles.begin(); it != edge_triangles.end(); ++it)
+        push_edge((uint32_t)(it->first >> 32), (uint32_t)(it->first & 0xffffffffu));
+
+    std::vector<uint32_t> neighbors_from, neighbors_to;
+    auto collect_neighbors = [&](uint32_t point, std::vector<uint32_t>& neighbors)
+    {
+        neighbors.clear();
+        for (size_t i = 0; i < point_triangles[point].size(); ++i)
+        {
+            uint32_t t = point_triangles[point][i];
+            if (!alive[t])
+                continue;
+            for (int k = 0; k < 3; ++k)
+                if (triangles[3*t + k] != point)
+                    neighbors.push_back(triangles[3*t + k]);
+        }
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+    };
+
+    size_t target = (size_t)(num_triangles * MESH_LOD_RATIO);
+    size_t last_level_triangles = num_alive;
+
+    auto emit_level = [&]()
+    {
+        std::vector<uint32_t> level;
+        level.reserve(3*num_alive);
+        for (size_t t = 0; t < num_triangles; ++t)
+        {
+            if (!alive[t])
+                continue;
+            for (int k = 0; k < 3; ++k)
+            {
+                // O canto do triângulo usa, entre os vértices do ponto para
+                // onde foi movido, o de normal e coordenadas de textura mais
+                // parecidas com as do vértice original.
+                uint32_t original = indices[3*t + k];
+                uint32_t point = triangles[3*t + k];
+                uint32_t best = original;
+                if (point_of[original] != point)
+                {
+                    float best_distance = std::numeric_limits<float>::max();
+                    for (size_t w = 0; w < wedges[point].size(); ++w)
+                    {
+                        uint32_t candidate = wedges[point][w];
+                        float distance = 0.0f;
+                        for (int c = 0; normals != NULL && c < 3; ++c)
+                            distance += (normals[4*candidate + c] - normals[4*original + c]) * (normals[4*candidate + c] - normals[4*original + c]);
+                        for (int c = 0; texcoords != NULL && c < 2; ++c)
+                            distance += (texcoords[2*candidate + c] - texcoords[2*original + c]) * (texcoords[2*candidate + c] - texcoords[2*original + c]);
+                        if (distance < best_distance)
+                        {
+                            best_distance = distance;
+                            best = candidate;
+                        }
+                    }
+                }
+                level.push_back(best);
+            }
+        }
+        // Os pontos que não foram movidos são vértices da própria superfície simplificada.
+        std::vector<glm::vec3> moved, corners;
+        for (size_t p = 0; p < num_points; ++p)
+            if (removed[p])
+                moved.push_back(points[p]);
+        corners.reserve(3*num_alive);
+        for (size_t t = 0; t < num_triangles; ++t)
+            if (alive[t])
+                for (int k = 0; k < 3; ++k)
+                    corners.push_back(points[triangles[3*t + k]]);
+        float error = MaxDistanceToTriangles(moved, corners);
+        if (!errors.empty())
+            error = std::max(error, errors.back()); // O erro nunca diminui de um nível para o seguinte
+
+        OptimizeTriangleOrder(level.data(), level.size() / 3, num_vertices, positions);
+        levels.push_back(level);
+        errors.push_back(error);
+        last_level_triangles = num_alive;
+    };
+
+    while (levels.size() < MESH_MAX_LODS && !collapses.empty())
+    {
+        EdgeCollapse collapse = collapses.top();
+        collapses.pop();
+
+        uint32_t from = collapse.from, to = collapse.to;
+        if (removed[from] || removed[to] || versions[from] != collapse.version_from || versions[to] != collapse.version_to)
+            continue;
+
+        // Condição de ligação: os dois vértices só podem ter em comum os
+        // vizinhos dos triângulos da própria aresta; caso contrário o colapso
+        // criaria uma malha não-manifold.
+        collect_neighbors(from, neighbors_from);
+        collect_neighbors(to, neighbors_to);
+        size_t shared_triangles = 0;
+        for (size_t i = 0; i < point_triangles[from].size(); ++i)
+        {
+            uint32_t t = point_triangles[from][i];
+            if (alive[t] && (triangles[3*t] == to || triangles[3*t + 1] == to || triangles[3*t + 2] == to))
+                shared_triangles += 1;
+        }
+        std::vector<uint32_t> common;
+        std::set_intersection(neighbors_from.begin(), neighbors_from.end(), neighbors_to.begin(), neighbors_to.end(),
+                              std::back_inserter(common));
+        bool valid = shared_triangles > 0 && common.size() <= shared_triangles;
+
+        // Os triângulos que permanecem não podem inverter nem mudar muito de orientação.
+        for (size_t i = 0; valid && i < point_triangles[from].size(); ++i)
+        {
+            uint32_t t = point_triangles[from][i];
+            const uint32_t* p = &triangles[3*t];
+            if (!alive[t] || p[0] == to || p[1] == to || p[2] == to)
+                continue;
+
+            glm::vec3 before[3], after[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                before[k] = points[p[k]];
+                after[k] = p[k] == from ? points[to] : points[p[k]];
+            }
+            glm::vec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+            glm::vec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+            valid = glm::dot(n0, n1) > 0.25f * glm::length(n0) * glm::length(n1);
+        }
+        if (!valid)
+            continue;
+
+        for (size_t i = 0; i < point_triangles[from].size(); ++i)
+        {
+            uint32_t t = point_triangles[from][i];
+            uint32_t* p = &triangles[3*t];
+            if (!alive[t])
+                continue;
+            if (p[0] == to || p[1] == to || p[2] == to)
+            {
+                alive[t] = false;
+                num_alive -= 1;
+                continue;
+            }
+            for (int k = 0; k < 3; ++k)
+                if (p[k] == from)
+                    p[k] = to;
+            point_triangles[to].push_back(t);
+        }
+        point_triangles[from].clear();
+        quadrics[to] = SumQuadrics(quadrics[to], quadrics[from]);
+        removed[from] = true;
+        versions[to] += 1;
+
+        collect_neighbors(to, neighbors_to);
+        for (size_t i = 0; i < neighbors_to.size(); ++i)
+            push_edge(to, neighbors_to[i]);
+
+        if (num_alive <= target)
+        {
+            emit_level();
+            target = (size_t)(num_alive * MESH_LOD_RATIO);
+        }
+    }
+
+    // Se os colapsos válidos acabaram antes do alvo, o que foi obtido ainda
+    // vale como último nível quando é bem menor que o nível anterior.
+    if (levels.size() < MESH_MAX_LODS && num_alive < last_level_triangles * 0.8)
+        emit_level();
+}
+
+// Erro de um nível de detalhe feito à mão: a maior distância de um vértice
+// do objeto original até a superfície do nível.
+static float MeasureLODError(const MeshData& mesh, const MeshShape& base, const MeshShape& lod)
+{
+    std::vector<glm::vec3> points, corners;
+    for (size_t i = 0; i < base.num_indices; ++i)
+    {
+        const float* p = &mesh.model_coefficients[4*mesh.indices[base.first_index + i]];
+        points.push_back(glm::vec3(p[0], p[1], p[2]));
+    }
+    for (size_t i = 0; i < lod.num_indices; ++i)
+    {
+        const float* p = &mesh.model_coefficients[4*mesh.indices[lod.first_index + i]];
+        corners.push_back(glm::vec3(p[0], p[1], p[2]));
+    }
+    return MaxDistanceToTriangles(points, corners);
+}
+
+void PrintMeshLODReport(const char* filename, const MeshArrays& mesh)
+{
+    size_t base = 0;
+    for (size_t i = 0; i < mesh.shapes.size(); ++i)
+    {
+        const MeshShape& shape = mesh.shapes[i];
+        if (shape.lod_level == 0)
+        {
+            base = i;
+            continue;
+        }
+        const MeshShape& original = mesh.shapes[base];
+        float diagonal = glm::length(original.bbox_max - original.bbox_min);
+        printf("%s: objeto '%s': nivel %d de '%s' (%s): %lu triangulos (%.1f%%), erro %g (%.3f%% da diagonal)\n",
+               filename, shape.name.c_str(), shape.lod_level, original.name.c_str(),
+               shape.num_vertices == 0 ? "gerado" : "do arquivo",
+               (unsigned long)(shape.num_indices / 3), 100.0 * shape.num_indices / original.num_indices,
+               shape.lod_error, diagonal > 0.0f ? 100.0f * shape.lod_error / diagonal : 0.0f);
+    }
+}
+
+// Separa um nome no formato "<prefixo>_LOD<n>". Retorna -1 se o nome não segue esse formato.
+static int ParseLODName(const std::string& name, std::string& prefix)
+{
+    size_t position = name.rfind("_LOD");
+    if (position == std::string::npos || position + 4 == name.size())
+        return -1;
+    for (size_t i = position + 4; i < name.size(); ++i)
+        if (name[i] < '0' || name[i] > '9')
+            return -1;
+    prefix = name.substr(0, position);
+    return atoi(name.c_str() + position + 4);
+}
+
+void GenerateMeshLODs(MeshData& mesh)
+{
+    std::vector<MeshShape> shapes;
+    std::string base_prefix;
+    size_t base = 0;
+    uint32_t first_vertex = 0;
+
+    for (size_t shape = 0; shape < mesh.shapes.size(); ++shape)
+    {
+        MeshShape current = mesh.shapes[shape];
+        uint32_t shape_first_vertex = first_vertex;
+        first_vertex += (uint32_t)current.num_vertices;
+
+        // Níveis feitos à mão: objetos "X_LOD1", "X_LOD2", ... logo depois de "X_LOD0".
+        std::string prefix;
+        int level = ParseLODName(current.name, prefix);
+        if (level > 0 && !shapes.empty() && prefix == base_prefix && level == shapes.back().lod_level + 1)
+        {
+            current.lod_level = level;
+            current.lod_error = std::max(MeasureLODError(mesh, shapes[base], current), shapes.back().lod_error);
+            shapes.push_back(current);
+            continue;
+        }
+
+        base = shapes.size();
+        base_prefix = level == 0 ? prefix : std::string();
+        shapes.push_back(current);
+
+        bool authored = false;
+        if (level == 0 && shape + 1 < mesh.shapes.size())
+        {
+            std::string next_prefix;
+            authored = ParseLODName(mesh.shapes[shape + 1].name, next_prefix) == 1 && next_prefix == prefix;
+        }
+        if (authored || current.num_indices / 3 < MESH_LOD_MIN_TRIANGLES)
+            continue;
+
+        // Níveis gerados: novos intervalos de índices que usam os vértices do objeto original.
+        std::vector<uint32_t> local(mesh.indices.begin() + current.first_index,
+                                    mesh.indices.begin() + current.first_index + current.num_indices);
+        for (size_t i = 0; i < local.size(); ++i)
+            local[i] -= shape_first_vertex;
+
+        const float* positions = mesh.model_coefficients.data() + 4*shape_first_vertex;
+        const float* normals = mesh.normal_coefficients.empty() ? NULL : mesh.normal_coefficients.data() + 4*shape_first_vertex;
+        const float* texcoords = mesh.texture_coefficients.empty() ? NULL : mesh.texture_coefficients.data() + 2*shape_first_vertex;
+
+        std::vector< std::vector<uint32_t> > levels;
+        std::vector<float> errors;
+        SimplifyShape(local.data(), local.size() / 3, current.num_vertices, positions, normals, texcoords, levels, errors);
+
+        for (size_t l = 0; l < levels.size(); ++l)
+        {
+            MeshShape lod = current;
+            lod.name         = current.name + "_LOD" + std::to_string(l + 1);
+            lod.first_index  = mesh.indices.size();
+            lod.num_indices  = levels[l].size();
+            lod.num_vertices = 0; // Usa os vértices de "current"
+            lod.lod_level    = (int)l + 1;
+            lod.lod_error    = errors[l];
+            for (size_t i = 0; i < levels[l].size(); ++i)
+                mesh.indices.push_back(shape_first_vertex + levels[l][i]);
+            shapes.push_back(lod);
+        }
+    }
+
+    mesh.shapes.swap(shapes);
+}
+
+void PrintMeshVertexReport(const char* filename, const MeshArrays& mesh, size_t vertex_stride)
+{
+    unsigned long total_indices = 0;
+    unsigned long total_vertices = 0;
+    for (size_t i = 0; i < mesh.shapes.size(); ++i)
+    {
+        const MeshShape& shape = mesh.shapes[i];
+        if (shape.num_vertices == 0)
+            continue; // Nível de detalhe gerado: usa os vértices do objeto original
+        printf("%s: objeto '%s': %lu vertices antes da soldagem, %lu depois (%.1fx)\n",
+               filename, shape.name.c_str(), (unsigned long)shape.num_indices, (unsigned long)shape.num_vertices,
+               shape.num_vertices > 0 ? (double)shape.num_indices/shape.num_vertices : 0.0);
+        total_indices += shape.num_indices;
+        total_vertices += shape.num_vertices;
+    }
+    printf("%s: total: %lu vertices antes da soldagem, %lu depois (VBOs: %.1f KB -> %.1f KB)\n",
+           filename, total_indices, total_vertices,
+           total_indices*vertex_stride/1024.0, total_vertices*vertex_stride/1024.0);
+}
+
+MeshArrays GetMeshArrays(const MeshData& mesh)
+{
+    MeshArrays arrays;
+    arrays.model_coefficients       = mesh.model_coefficients.data();
+    arrays.num_model_coefficients   = mesh.model_coefficients.size();
+    arrays.normal_coefficients      = mesh.normal_coefficients.data();
+    arrays.num_normal_coefficients  = mesh.normal_coefficients.size();
+    arrays.texture_coefficients     = mesh.texture_coefficients.data();
+    arrays.num_texture_coefficients = mesh.texture_coefficients.size();
+    arrays.indices                  = mesh.indices.data();
+    arrays.num_indices              = mesh.indices.size();
+    arrays.shapes                   = mesh.shapes;
+    return arrays;
+}
+
+static VertexAttribute AddVertexAttribute(PackedVertices& vertices, int type, int components)
+{
+    static const size_t component_size[] = {sizeof(float), sizeof(uint16_t), sizeof(int16_t), sizeof(uint16_t)};
+
+    VertexAttribute attribute;
+    attribute.type       = type;
+    attribute.components = components;
+    attribute.offset     = vertices.stride;
+
+    // Cada atributo começa em um múltiplo de 4 bytes, como recomendado pelas placas de vídeo.
+    vertices.stride += (components*component_size[type] + 3) & ~(size_t)3;
+    return attribute;
+}
+
+static void StoreFloat(unsigned char* destination, float value)
+{
+    memcpy(destination, &value, sizeof(float));
+}
+
+static void StoreUint16(unsigned char* destination, uint16_t value)
+{
+    memcpy(destination, &value, sizeof(uint16_t));
+}
+
+void PackVertices(const MeshArrays& mesh, unsigned int format, PackedVertices& vertices)
+{
+    vertices = PackedVertices();
+    vertices.num_vertices = mesh.num_model_coefficients / 4;
+
+    bool has_normals   = mesh.num_normal_coefficients > 0;
+    bool has_texcoords = mesh.num_texture_coefficients > 0;
+
+    // Coordenadas de textura fora de [0,1] (texturas repetidas) não cabem em
+    // inteiros normalizados; nesse caso elas continuam em float.
+    if ((format & VERTEX_PACKED_TEXCOORDS) && has_texcoords)
+    {
+        for (size_t i = 0; i < mesh.num_texture_coefficients; ++i)
+        {
+            float t = mesh.texture_coefficients[i];
+            if (!(t >= 0.0f && t <= 1.0f))
+            {
+                format &= ~VERTEX_PACKED_TEXCOORDS;
+                break;
+            }
+        }
+    }
+    if (!has_normals)
+        format &= ~VERTEX_PACKED_NORMALS;
+    if (!has_texcoords)
+        format &= ~VERTEX_PACKED_TEXCOORDS;
+    vertices.format = format;
+
+    // A coordenada w das posições (sempre 1) e das normais (sempre 0) não é
+    // armazenada: o vertex shader completa os vetores. A exceção são as
+    // posições em half float e as normais em inteiros, que ocupam quatro
+    // componentes para manter o alinhamento de 4 bytes.
+    if (format & VERTEX_HALF_POSITIONS)
+        vertices.position = AddVertexAttribute(vertices, VERTEX_ATTRIBUTE_HALF, 4);
+    else
+        vertices.position = AddVertexAttribute(vertices, VERTEX_ATTRIBUTE_FLOAT, 3);
+
+    if (format & VERTEX_PACKED_NORMALS)
+        vertices.normal = AddVertexAttribute(vertices, VERTEX_ATTRIBUTE_SNORM16, 4);
+    else if (has_normals)
+        vertices.normal = AddVertexAttribute(vertices, VERTEX_ATTRIBUTE_FLOAT, 3);
+
+    if (format & VERTEX_PACKED_TEXCOORDS)
+        vertices.texcoords = AddVertexAttribute(vertices, VERTEX_ATTRIBUTE_UNORM16, 2);
+    else if (has_texcoords)
+        vertices.texcoords = AddVertexAttribute(vertices, VERTEX_ATTRIBUTE_FLOAT, 2);
+
+    vertices.data.assign(vertices.num_vertices * vertices.stride, 0);
+
+    for (size_t i = 0; i < vertices.num_vertices; ++i)
+    {
+        unsigned char* vertex = vertices.data.data() + i*vertices.stride;
+
+        const float* position = mesh.model_coefficients + 4*i;
+        unsigned char* destination = vertex + vertices.position.offset;
+        for (int c = 0; c < 3; ++c)
+        {
+            if (format & VERTEX_HALF_POSITIONS)
+                StoreUint16(destination + c*sizeof(uint16_t), glm::packHalf1x16(position[c]));
+            else
+                StoreFloat(destination + c*sizeof(float), position[c]);
+        }
+        if (format & VERTEX_HALF_POSITIONS)
+            StoreUint16(destination + 3*sizeof(uint16_t), glm::packHalf1x16(1.0f));
+
+        if (has_normals)
+        {
+            const float* normal = mesh.normal_coefficients + 4*i;
+            destination = vertex + vertices.normal.offset;
+            for (int c = 0; c < 3; ++c)
+            {
+                if (format & VERTEX_PACKED_NORMALS)
+                    StoreUint16(destination + c*sizeof(int16_t), glm::packSnorm1x16(normal[c]));
+                else
+                    StoreFloat(destination + c*sizeof(float), normal[c]);
+            }
+        }
+
+        if (has_texcoords)
+        {
+            const float* texcoords = mesh.texture_coefficients + 2*i;
+            destination = vertex + vertices.texcoords.offset;
+            for (int c = 0; c < 2; ++c)
+            {
+                if (format & VERTEX_PACKED_TEXCOORDS)
+                    StoreUint16(destination + c*sizeof(uint16_t), glm::packUnorm1x16(texcoords[c]));
+                else
+                    StoreFloat(destination + c*sizeof(float), texcoords[c]);
+            }
+        }
+    }
+}
+
+bool MapFile(const char* filename, MappedFile& file)
+{
+    file = MappedFile();
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(handle);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        CloseHandle(handle);
+        return false;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL)
+    {
+        CloseHandle(mapping);
+        CloseHandle(handle);
+        return false;
+    }
+
+    file.data = (const unsigned char*)data;
+    file.size = (size_t)size.QuadPart;
+    file.file_handle = handle;
+    file.mapping_handle = mapping;
+#else
+    int descriptor = open(filename, O_RDONLY);
+    if (descriptor < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(descriptor, &info) != 0 || info.st_size == 0)
+    {
+        close(descriptor);
+        return false;
+    }
+
+    void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if (data == MAP_FAILED)
+        return false;
+
+    file.data = (const unsigned char*)data;
+    file.size = (size_t)info.st_size;
+#endif
+
+    return true;
+}
+
+void UnmapFile(MappedFile& file)
+{
+    if (file.data == NULL)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(file.data);
+    CloseHandle((HANDLE)file.mapping_handle);
+    CloseHandle((HANDLE)file.file_handle);
+#else
+    munmap((void*)file.data, file.size);
+#endif
+
+    file = MappedFile();
+}
+
+bool WriteFileReplacing(const char* filename, const void* header, size_t header_size, const void* data, size_t data_size)
+{
+    std::string temporary = std::string(filename) + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (file == NULL)
+        return false;
+    bool ok = fwrite(header, 1, header_size, file) == header_size;
+    ok = ok && (data_size == 0 || fwrite(data, 1, data_size, file) == data_size);
+    ok = (fclose(file) == 0) && ok;
+
+    if (ok)
+    {
+        remove(filename);
+        ok = rename(temporary.c_str(), filename) == 0;
+    }
+    if (!ok)
+        remove(temporary.c_str());
+    return ok;
+}
+
+double Now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// FNV-1a de 64 bits.
+uint64_t HashBytes(const unsigned char* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    return hash;
+}
+
+// Formato do arquivo de cache. Todas as seções começam em múltiplos de 16 bytes:
+//
+//     MeshCacheHeader
+//     MeshCacheShape[num_shapes]
+//     nomes dos objetos (num_name_bytes, sem terminador)
+//     model_coefficients, normal_coefficients, texture_coefficients (float)
+//     indices (uint32_t)
+struct MeshCacheHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t num_shapes;
+    uint64_t source_hash;
+    uint64_t num_name_bytes;
+    uint64_t num_model_coefficients;
+    uint64_t num_normal_coefficients;
+    uint64_t num_texture_coefficients;
+    uint64_t num_indices;
+};
+
+struct MeshCacheShape
+{
+    uint64_t first_index;
+    uint64_t num_indices;
+    uint64_t num_vertices;
+    float    bbox_min[3];
+    float    bbox_max[3];
+    uint32_t name_offset;
+    uint32_t name_length;
+    int32_t  lod_level;
+    float    lod_error;
+};
+
+static const char MESH_CACHE_MAGIC[8] = { 'F','C','G','M','E','S','H','\0' };
+
+static size_t AlignCacheOffset(size_t offset)
+{
+    return (offset + 15) & ~(size_t)15;
+}
+
+// Calcula o deslocamento de cada seção do arquivo. Devolve o tamanho total.
+static size_t MeshCacheLayout(const MeshCacheHeader& header, size_t offsets[6])
+{
+    size_t offset = AlignCacheOffset(sizeof(MeshCacheHeader));
+    offsets[0] = offset; offset = AlignCacheOffset(offset + header.num_shapes*sizeof(MeshCacheShape));
+    offsets[1] = offset; offset = AlignCacheOffset(offset + header.num_name_bytes);
+    offsets[2] = offset; offset = AlignCacheOffset(offset + header.num_model_coefficients*sizeof(float));
+    offsets[3] = offset; offset = AlignCacheOffset(offset + header.num_normal_coefficients*sizeof(float));
+    offsets[4] = offset; offset = AlignCacheOffset(offset + header.num_texture_coefficients*sizeof(float));
+    offsets[5] = offset; offset = offset + header.num_indices*sizeof(uint32_t);
+    return offset;
+}
+
+bool SaveMeshCache(const char* cache_filename, uint64_t source_hash, const MeshData& mesh)
+{
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = MESH_CACHE_VERSION;
+    header.num_shapes = (uint32_t)mesh.shapes.size();
+    header.source_hash = source_hash;
+    header.num_model_coefficients = mesh.model_coefficients.size();
+    header.num_normal_coefficients = mesh.normal_coefficients.size();
+    header.num_texture_coefficients = mesh.texture_coefficients.size();
+    header.num_indices = mesh.indices.size();
+
+    std::string names;
+    std::vector<MeshCacheShape> shapes(mesh.shapes.size());
+    for (size_t i = 0; i < mesh.shapes.size(); ++i)
+    {
+        memset(&shapes[i], 0, sizeof(MeshCacheShape));
+        shapes[i].first_index = mesh.shapes[i].first_index;
+        shapes[i].num_indices = mesh.shapes[i].num_indices;
+        shapes[i].num_vertices = mesh.shapes[i].num_vertices;
+        shapes[i].lod_level = mesh.shapes[i].lod_level;
+        shapes[i].lod_error = mesh.shapes[i].lod_error;
+        for (int k = 0; k < 3; ++k)
+        {
+            shapes[i].bbox_min[k] = mesh.shapes[i].bbox_min[k];
+            shapes[i].bbox_max[k] = mesh.shapes[i].bbox_max[k];
+        }
+        shapes[i].name_offset = (uint32_t)names.size();
+        shapes[i].name_length = (uint32_t)mesh.shapes[i].name.size();
+        names += mesh.shapes[i].name;
+    }
+    header.num_name_bytes = names.size();
+
+    size_t offsets[6];
+    size_t size = MeshCacheLayout(header, offsets);
+
+    std::vector<unsigned char> buffer(size, 0);
+    memcpy(&buffer[0], &header, sizeof(header));
+    if (!shapes.empty())
+        memcpy(&buffer[offsets[0]], shapes.data(), shapes.size()*sizeof(MeshCacheShape));
+    if (!names.empty())
+        memcpy(&buffer[offsets[1]], names.data(), names.size());
+    if (!mesh.model_coefficients.empty())
+        memcpy(&buffer[offsets[2]], mesh.model_coefficients.data(), mesh.model_coefficients.size()*sizeof(float));
+    if (!mesh.normal_coefficients.empty())
+        memcpy(&buffer[offsets[3]], mesh.normal_coefficients.data(), mesh.normal_coefficients.size()*sizeof(float));
+    if (!mesh.texture_coefficients.empty())
+        memcpy(&buffer[offsets[4]], mesh.texture_coefficients.data(), mesh.texture_coefficients.size()*sizeof(float));
+    if (!mesh.indices.empty())
+        memcpy(&buffer[offsets[5]], mesh.indices.data(), mesh.indices.size()*sizeof(uint32_t));
+
+    return WriteFileReplacing(cache_filename, buffer.data(), buffer.size(), NULL, 0);
+}
+
+bool OpenMeshCache(const char* cache_filename, uint64_t source_hash, MappedFile& file, MeshArrays& arrays)
+{
+    if (!MapFile(cache_filename, file))
+        return false;
+
+    MeshCacheHeader header;
+    bool valid = file.size >= sizeof(header);
+    if (valid)
+    {
+        memcpy(&header, file.data, sizeof(header));
+        valid = memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) == 0
+             && header.version == MESH_CACHE_VERSION
+             && header.source_hash == source_hash;
+    }
+
+    size_t offsets[6];
+    valid = valid && MeshCacheLayout(header, offsets) == file.size;
+
+    if (valid)
+    {
+        const MeshCacheShape* shapes = (const MeshCacheShape*)(file.data + offsets[0]);
+        const char* names = (const char*)(file.data + offsets[1]);
+
+        arrays.model_coefficients       = (const float*)(file.data + offsets[2]);
+        arrays.num_model_coefficients   = header.num_model_coefficients;
+        arrays.normal_coefficients      = (const float*)(file.data + offsets[3]);
+        arrays.num_normal_coefficients  = header.num_normal_coefficients;
+        arrays.texture_coefficients     = (const float*)(file.data + offsets[4]);
+        arrays.num_texture_coefficients = header.num_texture_coefficients;
+        arrays.indices                  = (const uint32_t*)(file.data + offsets[5]);
+        arrays.num_indices              = header.num_indices;
+
+        arrays.shapes.resize(header.num_shapes);
+        for (size_t i = 0; i < header.num_shapes && valid; ++i)
+        {
+            valid = shapes[i].first_index + shapes[i].num_indices <= header.num_indices
+                 && (uint64_t)shapes[i].name_offset + shapes[i].name_length <= header.num_name_bytes;
+
+            MeshShape& shape = arrays.shapes[i];
+            shape.name.assign(names + shapes[i].name_offset, valid ? shapes[i].name_length : 0);
+            shape.first_index = shapes[i].first_index;
+            shape.num_indices = shapes[i].num_indices;
+            shape.num_vertices = shapes[i].num_vertices;
+            shape.lod_level = shapes[i].lod_level;
+            shape.lod_error = shapes[i].lod_error;
+            shape.bbox_min = glm::vec3(shapes[i].bbox_min[0], shapes[i].bbox_min[1], shapes[i].bbox_min[2]);
+            shape.bbox_max = glm::vec3(shapes[i].bbox_max[0], shapes[i].bbox_max[1], shapes[i].bbox_max[2]);
+        }
+
+        // Um índice fora dos vetores, ou normais e coordenadas de textura em
+        // número diferente do de vértices, faria PackVertices() e a GPU lerem além
+        // dos dados: nesse caso o cache é descartado e a malha é reconstruída a
+        // partir do OBJ.
+        size_t num_vertices = header.num_model_coefficients / 4;
+        valid = valid
+             && (header.num_normal_coefficients == 0 || header.num_normal_coefficients == 4*num_vertices)
+             && (header.num_texture_coefficients == 0 || header.num_texture_coefficients == 2*num_vertices);
+        for (size_t i = 0; i < header.num_indices && valid; ++i)
+            valid = arrays.indices[i] < num_vertices;
+    }
+
+    if (!valid)
+    {
+        UnmapFile(file);
+        arrays = MeshArrays();
+    }
+    return valid;
+}
+
+void LoadMesh(const char* filename, LoadedMesh& mesh)
+{
+    double start = Now();
+
+    MappedFile source;
+    if (!MapFile(filename, source))
+        throw std::runtime_error(std::string("Cannot open file \"") + filename + "\".");
+    uint64_t source_hash = HashBytes(source.data, source.size);
+    UnmapFile(source);
+
+    std::string cache_filename = std::string(filename) + ".meshcache";
+
+    mesh.from_cache = OpenMeshCache(cache_filename.c_str(), source_hash, mesh.cache, mesh.arrays);
+    if (!mesh.from_cache)
+    {
+        ObjModel model(filename, NULL, true, false);
+        ComputeNormals(&model);
+        BuildMeshData(&model, mesh.data);
+        OptimizeMeshData(mesh.data);
+        GenerateMeshLODs(mesh.data);
+        mesh.arrays = GetMeshArrays(mesh.data);
+
+        if (!SaveMeshCache(cache_filename.c_str(), source_hash, mesh.data))
+            fprintf(stderr, "WARNING: Cannot write mesh cache \"%s\".\n", cache_filename.c_str());
+    }
+
+    mesh.load_time = Now() - start;
+}
+
+void UnloadMesh(LoadedMesh& mesh)
+{
+    UnmapFile(mesh.cache);
+    mesh.data = MeshData();
+    mesh.arrays = MeshArrays();
+}
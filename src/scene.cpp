@@ -0,0 +1,112 @@
+#include "scene.h"
+
+#include <glm/vec3.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+const char* const NOME_MODELOS_CENARIO[QUANTIDADE_MODELOS_CENARIO] =
+{
+    "Crate_Plane.005",
+    "ConcreteConstructionBarrier",
+    "PalletPlywoodNew_LOD0",
+};
+
+const char* const ARQUIVO_MODELOS_CENARIO[QUANTIDADE_MODELOS_CENARIO] =
+{
+    "WoodenCrate.obj",
+    "barreira.obj",
+    "PalletPlywoodNew_GameReady_LODs.obj",
+};
+
+/* Equivalentes das funções Matrix_* de matrices.h, que só podem ser incluídas por main.cpp. */
+static glm::mat4 translacao(float x, float y, float z)
+{
+    return glm::translate(glm::mat4(1.0f), glm::vec3(x, y, z));
+}
+
+static glm::mat4 escala(float x, float y, float z)
+{
+    return glm::scale(glm::mat4(1.0f), glm::vec3(x, y, z));
+}
+
+static glm::mat4 rotacao_x(float angulo)
+{
+    return glm::rotate(glm::mat4(1.0f), angulo, glm::vec3(1.0f, 0.0f, 0.0f));
+}
+
+static glm::mat4 rotacao_y(float angulo)
+{
+    return glm::rotate(glm::mat4(1.0f), angulo, glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+static glm::mat4 rotacao_z(float angulo)
+{
+    return glm::rotate(glm::mat4(1.0f), angulo, glm::vec3(0.0f, 0.0f, 1.0f));
+}
+
+static void adiciona_item_estatico(std::vector<ItemEstatico>& itens, int modelo, glm::mat4 model, int indice_colisao)
+{
+    ItemEstatico item;
+    item.modelo = modelo;
+    item.model = model;
+    item.indice_colisao = indice_colisao;
+    itens.push_back(item);
+}
+
+static void monta_caixas(std::vector<ItemEstatico>& itens)
+{
+    glm::mat4 base = escala(0.15f, 0.15f, 0.15f);
+
+    adiciona_item_estatico(itens, MODELO_CAIXA, translacao(-4.2f, 0.0f, 1.5f) * base * rotacao_y(0.785f), 0);
+    adiciona_item_estatico(itens, MODELO_CAIXA, translacao(-4.2f, 0.0f, 1.5f) * base * translacao(0.0f, 5.0f, 0.0f), 1);
+    adiciona_item_estatico(itens, MODELO_CAIXA, translacao(2.0f, 0.0f, 1.5f) * base * escala(1.0f, 2.0f, 1.0f), 2);
+    adiciona_item_estatico(itens, MODELO_CAIXA, translacao(-1.4f, 0.0f, -1.0f) * base * rotacao_y(-0.2f), 3);
+    adiciona_item_estatico(itens, MODELO_CAIXA, translacao(2.2f, 0.0f, -0.8f) * base * rotacao_y(-0.4f) * escala(3.0f, 0.5f, 1.0f), 4);
+    adiciona_item_estatico(itens, MODELO_CAIXA, translacao(-7.5f, 0.0f, 6.7f) * base * escala(0.8f, 0.8f, 0.8f) * rotacao_y(0.1f), 5);
+    adiciona_item_estatico(itens, MODELO_CAIXA, translacao(-7.5f, 0.0f, 5.2f) * base * escala(0.8f, 0.8f, 0.8f) * rotacao_y(-0.21f), 6);
+}
+
+static void monta_barreiras(std::vector<ItemEstatico>& itens)
+{
+    glm::mat4 base = escala(0.007f, 0.007f, 0.007f) * rotacao_x(29.85f);
+
+    adiciona_item_estatico(itens, MODELO_BARREIRA, translacao(-2.7f, 0.0f, 1.6f) * base, 7);
+
+    /* Paredes em volta da posição inicial do jogador. Não colidem com as balas; o jogador
+    é limitado por elas em move_jogador() (simulation.cpp). */
+    adiciona_item_estatico(itens, MODELO_BARREIRA, translacao(-1.05f, 0.0f, 3.7f) * base * escala(3.5f, 0.8f, 0.8f), -1);
+    adiciona_item_estatico(itens, MODELO_BARREIRA, translacao(-1.05f, 0.0f, 7.5f) * base * escala(3.5f, 0.8f, 0.8f), -1);
+    adiciona_item_estatico(itens, MODELO_BARREIRA, translacao(-4.4f, 0.0f, 5.5f) * base * rotacao_z(1.57f) * escala(1.8f, 0.8f, 0.8f), -1);
+    adiciona_item_estatico(itens, MODELO_BARREIRA, translacao(2.6f, 0.0f, 5.5f) * base * rotacao_z(1.57f) * escala(1.8f, 0.8f, 0.8f), -1);
+
+    adiciona_item_estatico(itens, MODELO_BARREIRA, translacao(3.5f, 0.0f, 11.0f) * base * escala(1.0f, 1.0f, 3.0f), 8);
+}
+
+static void monta_paletes(std::vector<ItemEstatico>& itens)
+{
+    adiciona_item_estatico(itens, MODELO_PALETE, translacao(0.0f, 0.0f, -1.0f), 9);
+    adiciona_item_estatico(itens, MODELO_PALETE, translacao(0.0f, 0.0f, 12.0f) * escala(4.0f, 0.8f, 1.5f), 10);
+    adiciona_item_estatico(itens, MODELO_PALETE, translacao(-7.5f, 0.6f, 6.0f) * escala(0.3f, 0.4f, 1.0f) * rotacao_y(1.57f), 11);
+}
+
+void monta_cena_estatica(std::vector<ItemEstatico>& itens)
+{
+    itens.clear();
+    monta_caixas(itens);
+    monta_barreiras(itens);
+    monta_paletes(itens);
+}
+
+void calcula_bboxes_cenario(const std::vector<ItemEstatico>& itens,
+                            const glm::vec4 bbox_minimo_modelos[], const glm::vec4 bbox_maximo_modelos[],
+                            ObjetoCenario vetor_objetos[])
+{
+    for (size_t i = 0; i < itens.size(); i++)
+    {
+        if (itens[i].indice_colisao < 0)
+            continue;
+
+        ObjetoCenario& cenario = vetor_objetos[itens[i].indice_colisao];
+        calcula_aabb_mundo(itens[i].model, bbox_minimo_modelos[itens[i].modelo], bbox_maximo_modelos[itens[i].modelo],
+                           cenario.bbox_minimo, cenario.bbox_maximo);
+    }
+}
@@ -1,16 +1,40 @@
 #version 330 core
 
 // Atributos de vértice recebidos como entrada ("in") pelo Vertex Shader.
-// Veja a função BuildTrianglesAndAddToVirtualScene() em "main.cpp".
+// Veja a função AddMeshToVirtualScene() em "main.cpp". Os vértices não
+// armazenam o w das posições, que a OpenGL completa com 1, nem o das normais,
+// que é sempre 0; por isso as normais são recebidas como vec3.
 layout (location = 0) in vec4 model_coefficients;
-layout (location = 1) in vec4 normal_coefficients;
+layout (location = 1) in vec3 normal_coefficients;
 layout (location = 2) in vec2 texture_coefficients;
 
-// Matrizes computadas no código C++ e enviadas para a GPU
+// Matriz de modelagem e matriz das normais de cada instância, usadas no desenho
+// instanciado. Veja a função QueueVirtualObjectInstanced() em "main.cpp". Uma
+// mat4 ocupa as localizações 3, 4, 5 e 6, e uma mat3, as localizações 7, 8 e 9.
+layout (location = 3) in mat4 instance_model;
+layout (location = 7) in mat3 instance_normal_matrix;
+
+// Matrizes computadas no código C++ e enviadas para a GPU. A matriz das
+// normais é a inversa da transposta da parte 3x3 de "model" (veja
+// Matrix_Normal() em "matrices.h").
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform sampler2D TextureImage9;
+uniform mat3 normal_matrix;
+
+// Dados da câmera, iguais para todos os objetos desenhados com ela, lidos do
+// uniform buffer object ligado pelo código C++. Veja a estrutura
+// CameraUniforms em "main.cpp"; o layout std140 garante a mesma disposição.
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 view_inverse;
+    vec4 camera_position;
+};
+
+// Se verdadeiro, as matrizes de modelagem e das normais vêm dos atributos
+// "instance_model" e "instance_normal_matrix" em vez das variáveis "model" e
+// "normal_matrix".
+uniform bool instanced;
 
 // Atributos de vértice que serão gerados como saída ("out") pelo Vertex Shader.
 // ** Estes serão interpolados pelo rasterizador! ** gerando, assim, valores
@@ -36,7 +60,10 @@ void main()
     // deste Vertex Shader, a placa de vídeo (GPU) fará a divisão por W. Veja
     // slides 41-67 e 69-86 do documento Aula_09_Projecoes.pdf.
 
-    gl_Position = projection * view * model * model_coefficients;
+    mat4 model_matrix = instanced ? instance_model : model;
+    mat3 normal_transform = instanced ? instance_normal_matrix : normal_matrix;
+
+    gl_Position = projection * view * model_matrix * model_coefficients;
 
     // Como as variáveis acima  (tipo vec4) são vetores com 4 coeficientes,
     // também é possível acessar e modificar cada coeficiente de maneira
@@ -53,22 +80,18 @@ void main()
     // rasterizador para gerar atributos únicos para cada fragmento gerado.
 
     // Posição do vértice atual no sistema de coordenadas global (World).
-    position_world = model * model_coefficients;
+    position_world = model_matrix * model_coefficients;
 
     // Posição do vértice atual no sistema de coordenadas local do modelo.
     position_model = model_coefficients;
 
     // Normal do vértice atual no sistema de coordenadas global (World).
     // Veja slides 123-151 do documento Aula_07_Transformacoes_Geometricas_3D.pdf.
-    normal = inverse(transpose(model)) * normal_coefficients;
-    normal.w = 0.0;
+    normal = vec4(normal_transform * normal_coefficients, 0.0);
 
     // Coordenadas de textura obtidas do arquivo OBJ (se existirem!)
     texcoords = texture_coefficients;
 
-    vec4 origin = vec4(0.0, 0.0, 0.0, 1.0);
-    vec4 camera_position = inverse(view) * origin;
-
     vec3 Kd= vec3(0.8,0.4,0.08); // Refletância difusa
     vec3 Ks = vec3(0.8,0.8,0.8); // Refletância especular
     vec3 Ka = Kd/2; // Refletância ambiente
@@ -0,0 +1,512 @@
+#include "simulation.h"
+
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+/* Pontos de controle da curva de Bézier cúbica percorrida pelo alvo 0. */
+static const glm::vec4 ponto1 = glm::vec4(-5.0f,0.0f,8.0f,1.0f);
+static const glm::vec4 ponto2 = glm::vec4(9.0f,0.0f,10.0f,1.0f);
+static const glm::vec4 ponto3 = glm::vec4(-10.0f,0.0f,10.0f,1.0f);
+static const glm::vec4 ponto4 = glm::vec4(4.0f,0.0f,8.0f,1.0f);
+
+static void inicializa_alvos(Alvo vetor_alvos[])
+{
+    vetor_alvos[0].x = 0.0f;
+    vetor_alvos[0].y = 0.5f;
+    vetor_alvos[0].z = 0.0f;
+
+    vetor_alvos[1].x = -8.0f;
+    vetor_alvos[1].y = 0.5f;
+    vetor_alvos[1].z = 6.0f;
+
+    vetor_alvos[2].x = -8.0f;
+    vetor_alvos[2].y = 0.5f;
+    vetor_alvos[2].z = 8.0f;
+
+    vetor_alvos[3].x = 3.2f;
+    vetor_alvos[3].y = 0.95f;
+    vetor_alvos[3].z = 11.5f;
+
+    vetor_alvos[4].x = 1.2f;
+    vetor_alvos[4].y = 0.95f;
+    vetor_alvos[4].z = 11.5f;
+
+    vetor_alvos[5].x = -1.2f;
+    vetor_alvos[5].y = 0.95f;
+    vetor_alvos[5].z = 11.5f;
+
+    vetor_alvos[6].x = -3.2f;
+    vetor_alvos[6].y = 0.95f;
+    vetor_alvos[6].z = 11.5f;
+
+    vetor_alvos[7].x = -2.8f;
+    vetor_alvos[7].y = 0.5f;
+    vetor_alvos[7].z = 1.0f;
+
+    vetor_alvos[8].x = -1.0f;
+    vetor_alvos[8].y = 0.5f;
+    vetor_alvos[8].z = -1.9f;
+
+    vetor_alvos[9].x = 0.1f;
+    vetor_alvos[9].y = 0.5f;
+    vetor_alvos[9].z = -1.9f;
+
+    vetor_alvos[10].x = 2.4f;
+    vetor_alvos[10].y = 0.5f;
+    vetor_alvos[10].z = -1.6f;
+
+     for (int i = NUM_ALVOS_NAOLINEARES; i < QUANTIDADE_ALVOS; i++)
+    {
+        if (i % 2 == 0)
+            vetor_alvos[i].direcao = DIRECAO_DIREITA;
+        else
+            vetor_alvos[i].direcao = DIRECAO_ESQUERDA;
+        vetor_alvos[i].x = 0.0f;
+        vetor_alvos[i].y = 0.5f;
+        vetor_alvos[i].z = -3.0f*(i-NUM_ALVOS_NAOLINEARES);
+    }
+}
+
+static void inicializa_esferas(Esfera vetor_esferas[])
+{
+    for (int i = 0; i < QUANTIDADE_ESFERAS; i++)
+    {
+        if (i % 2 == 0)
+            vetor_esferas[i].direcao = DIRECAO_DIREITA;
+        else
+            vetor_esferas[i].direcao = DIRECAO_ESQUERDA;
+        vetor_esferas[i].centro_x = 0.0f;
+        vetor_esferas[i].centro_y = ALTURA_ESFERAS;
+        vetor_esferas[i].centro_z = -3.0f*i;
+    }
+}
+
+/* Avança o parâmetro da curva de Bézier do alvo 0 e retorna o ponto correspondente da curva. */
+static glm::vec4 avanca_bezier_alvo(EstadoSimulacao& estado, double passo)
+{
+    estado.tempo_bezier += passo;
+    if (estado.tempo_bezier > TEMPO_ALVO_BEZIER)
+    {
+        estado.tempo_bezier -= TEMPO_ALVO_BEZIER;
+        estado.bezier_ida = !estado.bezier_ida;
+    }
+
+    float t = (float)(estado.tempo_bezier/TEMPO_ALVO_BEZIER);
+    if (!estado.bezier_ida)
+        t = 1.0f - t;
+
+    glm::vec4 vetor12 = ponto1 + t*(ponto2 - ponto1);
+    glm::vec4 vetor23 = ponto2 + t*(ponto3 - ponto2);
+    glm::vec4 vetor34 = ponto3 + t*(ponto4 - ponto3);
+
+    glm::vec4 vetor123 = vetor12 + t*(vetor23 - vetor12);
+    glm::vec4 vetor234 = vetor23 + t*(vetor34 - vetor23);
+
+    return vetor123 + t*(vetor234 - vetor123);
+}
+
+/* Função para controlar a movimentação dos alvos no cenário, com teste de colisão
+envolvendo os pontos extremos do cenário e o ponto no qual o alvo se encontra. */
+static void controla_alvos(Alvo vetor_alvos[], glm::vec4 vetor_bezier_alvo, double delta_t)
+{
+    vetor_alvos[0].x = vetor_bezier_alvo.x;
+    vetor_alvos[0].z = vetor_bezier_alvo.z;
+
+    for (int i = NUM_ALVOS_NAOLINEARES; i < QUANTIDADE_ALVOS; i++)
+    {
+        if (vetor_alvos[i].x >= LIMITE_DIR_ALVO) /* Inverte o sentido da direção do alvo para a esquerda, caso ele atinja o limite direito. */
+            vetor_alvos[i].direcao = DIRECAO_ESQUERDA;
+
+        else if (vetor_alvos[i].x <= LIMITE_ESQ_ALVO) /* Inverte o sentido da direção do alvo para a direita, caso ele atinja o limite esquerdo. */
+            vetor_alvos[i].direcao = DIRECAO_DIREITA;
+
+        if (vetor_alvos[i].direcao == DIRECAO_DIREITA)
+            vetor_alvos[i].x += vetor_alvos[i].velocidade_alvo*delta_t;
+
+        else if (vetor_alvos[i].direcao == DIRECAO_ESQUERDA)
+            vetor_alvos[i].x -= vetor_alvos[i].velocidade_alvo*delta_t;
+    }
+}
+
+glm::mat4 modelo_alvo(int indice, glm::vec4 posicao)
+{
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(posicao.x,posicao.y,posicao.z))*
+                      glm::scale(glm::mat4(1.0f), glm::vec3(0.1f,0.1f,0.01f));
+    if (indice == 0 || (indice >= 3 && indice <= 6))
+        model = model*glm::rotate(glm::mat4(1.0f), 3.14f, glm::vec3(0.0f,1.0f,0.0f));
+    else if (indice == 1 || indice == 2)
+        model = model*glm::rotate(glm::mat4(1.0f), 1.57f, glm::vec3(0.0f,1.0f,0.0f))*glm::scale(glm::mat4(1.0f), glm::vec3(10.0f,1.0f,0.8f));
+    return model;
+}
+
+/* Recalcula as bounding boxes dos alvos a partir da bounding box local do cubo e da
+matriz de modelagem de cada alvo, a mesma usada para desenhá-lo. */
+static void atualiza_bbox_alvos(EstadoSimulacao& estado)
+{
+    for (int i = 0; i < QUANTIDADE_ALVOS; i++)
+    {
+        Alvo& alvo = estado.alvos[i];
+        if (alvo.dano >= MAXIMO_DANO)
+            continue;
+
+        glm::vec4 posicao = glm::vec4(alvo.x,alvo.y,alvo.z,1.0f);
+        calcula_aabb_mundo(modelo_alvo(i, posicao), estado.bbox_minimo_alvo, estado.bbox_maximo_alvo,
+                           alvo.bbox_minimo, alvo.bbox_maximo);
+    }
+}
+
+/* Função para controlar a movimentação das esferas no cenário, com teste de colisão
+envolvendo os pontos extremos do cenário e o ponto no qual a esfera se encontra. */
+static void controla_esferas(Esfera vetor_esferas[], double delta_t)
+{
+    for (int i = 0; i < QUANTIDADE_ESFERAS; i++)
+    {
+        if (vetor_esferas[i].centro_x >= LIMITE_DIR_ESFERA) /* Inverte o sentido da direção da esfera para a esquerda, caso ela atinja o limite direito. */
+            vetor_esferas[i].direcao = DIRECAO_ESQUERDA;
+
+        else if (vetor_esferas[i].centro_x <= LIMITE_ESQ_ESFERA) /* Inverte o sentido da direção da esfera para a direita, caso ela atinja o limite esquerdo. */
+            vetor_esferas[i].direcao = DIRECAO_DIREITA;
+
+        if (vetor_esferas[i].direcao == DIRECAO_DIREITA)
+            vetor_esferas[i].centro_x += vetor_esferas[i].velocidade_esfera*delta_t;
+
+        else if (vetor_esferas[i].direcao == DIRECAO_ESQUERDA)
+            vetor_esferas[i].centro_x -= vetor_esferas[i].velocidade_esfera*delta_t;
+    }
+}
+
+static void controla_balas(Balas& balas)
+{
+    for (int i = 0; i < balas.quantidade; i++)
+    {
+        if (balas.z[i] >= LIMITE_FRENTE ||
+            balas.z[i] <= LIMITE_FUNDO ||
+            balas.x[i] <= LIMITE_ESQUERDA ||
+            balas.x[i] >= LIMITE_DIREITA ||
+            balas.y[i] >= LIMITE_CIMA ||
+            balas.y[i] <= LIMITE_BAIXO ||
+            balas.atingiu_cenario[i]) /* Balas que atingiram o cenário no passo anterior também são removidas. */
+            {
+                balas.desenhar[i] = 0;
+                balas.atingiu_cenario[i] = 0;
+                balas.x[i] = 0.0;
+                balas.y[i] = 0.0;
+                balas.z[i] = 0.0;
+            }
+    }
+}
+
+static void dispara_balas(Balas& balas, glm::vec4 posicao, glm::vec4 direcao_camera)
+{
+    for (int i = 0; i < balas.quantidade; i++)
+        if (!balas.desenhar[i])
+        {
+            balas.desenhar[i] = 1;
+            balas.atingiu_cenario[i] = 0;
+            balas.x[i] = posicao.x;
+            balas.y[i] = posicao.y;
+            balas.z[i] = posicao.z;
+            balas.x_anterior[i] = balas.x[i];
+            balas.y_anterior[i] = balas.y[i];
+            balas.z_anterior[i] = balas.z[i];
+
+            balas.direcao[i].x = direcao_camera.x;
+            balas.direcao[i].y = direcao_camera.y;
+            balas.direcao[i].z = direcao_camera.z;
+
+            glm::vec3 eixo_rotacao = glm::cross(glm::vec3(0.0f,1.0f,0.0f), glm::vec3(direcao_camera));
+            balas.eixo_rotacao_normalizado[i] = glm::vec4(glm::normalize(eixo_rotacao), 0.0f);
+            glm::vec4 view_normalizado = glm::normalize(direcao_camera);
+            float cosseno_rotacao = glm::dot(view_normalizado,glm::vec4(0.0f,1.0f,0.0f,0.0f));
+
+            balas.angulo_rotacao[i] = acosf(cosseno_rotacao);
+            break;
+        }
+}
+
+static void move_balas(Balas& balas, double delta_t)
+{
+    for (int i = 0; i < balas.quantidade; i++)
+    {
+        if (balas.desenhar[i])
+        {
+            // Guardamos a posição anterior para o teste de colisão por varredura (veja collisions.cpp)
+            balas.x_anterior[i] = balas.x[i];
+            balas.y_anterior[i] = balas.y[i];
+            balas.z_anterior[i] = balas.z[i];
+
+            balas.x[i] += VELOCIDADE_BALAS*balas.direcao[i].x*delta_t;
+            balas.y[i] += VELOCIDADE_BALAS*balas.direcao[i].y*delta_t;
+            balas.z[i] += VELOCIDADE_BALAS*balas.direcao[i].z*delta_t;
+        }
+    }
+}
+
+/* Movimenta o jogador conforme as teclas WASD, impedindo que ele atravesse as paredes do labirinto. */
+static void move_jogador(EstadoSimulacao& estado, const EntradaSimulacao& entrada, double delta_t)
+{
+    glm::vec4 nova_pos = estado.posicao_jogador;
+    glm::vec4 w_normalizado = entrada.vetor_w;
+    w_normalizado.y = 0.0f;
+    w_normalizado = glm::normalize(w_normalizado);
+    glm::vec4 u = entrada.vetor_u;
+
+    if (entrada.frente)
+    {
+        nova_pos.x += delta_t*(-1*w_normalizado.x*VELOCIDADE_CAMERA);
+        nova_pos.z += delta_t*(-1*w_normalizado.z*VELOCIDADE_CAMERA);
+    }
+
+    if (entrada.tras)
+    {
+        nova_pos.x += delta_t*(w_normalizado.x*VELOCIDADE_CAMERA);
+        nova_pos.z += delta_t*(w_normalizado.z*VELOCIDADE_CAMERA);
+    }
+
+    if (entrada.direita)
+    {
+        nova_pos.x += delta_t*(u.x*VELOCIDADE_CAMERA);
+        nova_pos.z += delta_t*(u.z*VELOCIDADE_CAMERA);
+    }
+
+    if (entrada.esquerda)
+    {
+        nova_pos.x += delta_t*(-1*u.x*VELOCIDADE_CAMERA);
+        nova_pos.z += delta_t*(-1*u.z*VELOCIDADE_CAMERA);
+    }
+    glm::vec4 bbox_jogador_max = nova_pos;
+    bbox_jogador_max.x += ESPESSURA_JOGADOR;
+    bbox_jogador_max.z += ESPESSURA_JOGADOR;
+    glm::vec4 bbox_jogador_min = nova_pos;
+    bbox_jogador_min.x -= ESPESSURA_JOGADOR;
+    bbox_jogador_min.z -= ESPESSURA_JOGADOR;
+    bool parede1 = limita_jogador_plano_x(bbox_jogador_max, bbox_jogador_min, -4.4f);
+    bool parede2 = limita_jogador_plano_x(bbox_jogador_max, bbox_jogador_min, 2.3f);
+    bool parede3 = limita_jogador_plano_z(bbox_jogador_max, bbox_jogador_min, 3.9f);
+    bool parede4 = limita_jogador_plano_z(bbox_jogador_max, bbox_jogador_min, 7.0f);
+    if(!parede1 && !parede2){
+        estado.posicao_jogador.x = nova_pos.x;
+    }
+    if(!parede3 && !parede4){
+        estado.posicao_jogador.z = nova_pos.z;
+    }
+}
+
+static bool verifica_fim(Alvo vetor_alvos[], Esfera vetor_esferas[])
+{
+    int i = 0;
+    for(i = 0; i < QUANTIDADE_ALVOS; i++)
+        if (vetor_alvos[i].dano < MAXIMO_DANO)
+            break;
+
+    if (i != QUANTIDADE_ALVOS)
+        return false;
+
+     for(i = 0; i < QUANTIDADE_ESFERAS; i++)
+        if (vetor_esferas[i].dano < MAXIMO_DANO)
+            break;
+
+     if (i != QUANTIDADE_ESFERAS)
+        return false;
+
+    return true;
+}
+
+void inicializa_simulacao(EstadoSimulacao& estado, glm::vec4 posicao_jogador)
+{
+    inicializa_alvos(estado.alvos);
+    inicializa_esferas(estado.esferas);
+    inicializa_balas(estado.balas, QUANTIDADE_BALAS);
+
+    estado.posicao_jogador = posicao_jogador;
+    estado.posicao_jogador_anterior = posicao_jogador;
+    for (int i = 0; i < QUANTIDADE_ALVOS; i++)
+        estado.posicao_alvos_anterior[i] = glm::vec4(estado.alvos[i].x,estado.alvos[i].y,estado.alvos[i].z,1.0f);
+    for (int i = 0; i < QUANTIDADE_ESFERAS; i++)
+        estado.centro_esferas_anterior[i] = glm::vec4(estado.esferas[i].centro_x,estado.esferas[i].centro_y,estado.esferas[i].centro_z,1.0f);
+
+    atualiza_bbox_alvos(estado);
+}
+
+/* Recebe as bounding boxes dos objetos estáticos do cenário e constrói a grade correspondente.
+Até esta função ser chamada, as balas não colidem com o cenário. */
+void constroi_cenario_simulacao(EstadoSimulacao& estado, const ObjetoCenario vetor_objetos[])
+{
+    std::copy(vetor_objetos, vetor_objetos + QUANTIDADE_OBJETOS, estado.objetos);
+    constroi_grade_objetos(estado.grade_objetos, estado.objetos);
+    estado.cenario_pronto = true;
+}
+
+void passo_simulacao(EstadoSimulacao& estado, EntradaSimulacao& entrada, double passo)
+{
+    estado.posicao_jogador_anterior = estado.posicao_jogador;
+    for (int i = 0; i < QUANTIDADE_ALVOS; i++)
+        estado.posicao_alvos_anterior[i] = glm::vec4(estado.alvos[i].x,estado.alvos[i].y,estado.alvos[i].z,1.0f);
+    for (int i = 0; i < QUANTIDADE_ESFERAS; i++)
+        estado.centro_esferas_anterior[i] = glm::vec4(estado.esferas[i].centro_x,estado.esferas[i].centro_y,estado.esferas[i].centro_z,1.0f);
+
+    controla_esferas(estado.esferas, passo);
+    controla_alvos(estado.alvos, avanca_bezier_alvo(estado, passo), passo);
+    atualiza_bbox_alvos(estado);
+    atualiza_grade_alvos(estado.grade_alvos, estado.alvos);
+    atualiza_grade_esferas(estado.grade_esferas, estado.esferas);
+
+    controla_balas(estado.balas);
+
+    if (entrada.disparar)
+    {
+        entrada.disparar = false;
+        dispara_balas(estado.balas, estado.posicao_jogador, entrada.direcao_camera);
+    }
+
+    move_balas(estado.balas, passo);
+    if (estado.cenario_pronto)
+        destroi_balas(estado.balas, estado.objetos, estado.grade_objetos);
+    destroi_alvos(estado.balas, estado.alvos, estado.grade_alvos);
+    destroi_esferas(estado.balas, estado.esferas, estado.grade_esferas);
+
+    move_jogador(estado, entrada, passo);
+
+    estado.fim_jogo = verifica_fim(estado.alvos, estado.esferas);
+    estado.passos++;
+}
+
+/* Consome o tempo real decorrido em passos fixos e retorna o fator de interpolação (entre 0 e 1)
+da sobra do acumulador, a ser usado por extrai_quadro_simulacao(). */
+float avanca_simulacao(EstadoSimulacao& estado, EntradaSimulacao& entrada, double tempo_decorrido)
+{
+    tempo_decorrido = std::min(tempo_decorrido, MAXIMO_PASSOS_POR_QUADRO*PASSO_SIMULACAO);
+    estado.acumulador += tempo_decorrido;
+
+    while (estado.acumulador >= PASSO_SIMULACAO && !estado.fim_jogo)
+    {
+        passo_simulacao(estado, entrada, PASSO_SIMULACAO);
+        estado.acumulador -= PASSO_SIMULACAO;
+    }
+
+    if (estado.fim_jogo)
+        return 1.0f;
+
+    return (float)(estado.acumulador/PASSO_SIMULACAO);
+}
+
+void extrai_quadro_simulacao(const EstadoSimulacao& estado, float alfa, QuadroSimulacao& quadro)
+{
+    quadro.posicao_jogador = estado.posicao_jogador_anterior + alfa*(estado.posicao_jogador - estado.posicao_jogador_anterior);
+
+    for (int i = 0; i < QUANTIDADE_ALVOS; i++)
+    {
+        glm::vec4 atual = glm::vec4(estado.alvos[i].x,estado.alvos[i].y,estado.alvos[i].z,1.0f);
+        quadro.posicao_alvos[i] = estado.posicao_alvos_anterior[i] + alfa*(atual - estado.posicao_alvos_anterior[i]);
+        quadro.alvo_visivel[i] = estado.alvos[i].dano < MAXIMO_DANO;
+    }
+
+    for (int i = 0; i < QUANTIDADE_ESFERAS; i++)
+    {
+        glm::vec4 atual = glm::vec4(estado.esferas[i].centro_x,estado.esferas[i].centro_y,estado.esferas[i].centro_z,1.0f);
+        quadro.centro_esferas[i] = estado.centro_esferas_anterior[i] + alfa*(atual - estado.centro_esferas_anterior[i]);
+        quadro.esfera_visivel[i] = estado.esferas[i].dano < MAXIMO_DANO;
+    }
+
+    const Balas& balas = estado.balas;
+    quadro.posicao_balas.clear();
+    quadro.eixo_rotacao_balas.clear();
+    quadro.angulo_rotacao_balas.clear();
+    for (int i = 0; i < balas.quantidade; i++)
+    {
+        if (!balas.desenhar[i])
+            continue;
+        glm::vec4 anterior = glm::vec4(balas.x_anterior[i],balas.y_anterior[i],balas.z_anterior[i],1.0f);
+        glm::vec4 atual = glm::vec4(balas.x[i],balas.y[i],balas.z[i],1.0f);
+        quadro.posicao_balas.push_back(anterior + alfa*(atual - anterior));
+        quadro.eixo_rotacao_balas.push_back(balas.eixo_rotacao_normalizado[i]);
+        quadro.angulo_rotacao_balas.push_back(balas.angulo_rotacao[i]);
+    }
+
+    quadro.fim_jogo = estado.fim_jogo;
+}
+
+/* Laço da thread auxiliar: espera uma solicitação, avança a simulação e escreve o quadro
+resultante no buffer que não está sendo desenhado. O mutex só protege a troca de mensagens: os
+passos são executados sem ele, já que o laço principal não acessa o estado nem esse buffer
+enquanto há trabalho pendente. */
+static void executa_simulacao_paralela(SimulacaoParalela* simulacao)
+{
+    std::unique_lock<std::mutex> trava(simulacao->mutex);
+    while (true)
+    {
+        simulacao->condicao.wait(trava, [simulacao] { return simulacao->trabalho_pendente || simulacao->encerrar; });
+        if (simulacao->encerrar)
+            return;
+
+        EntradaSimulacao entrada = simulacao->entrada;
+        double tempo_decorrido = simulacao->tempo_decorrido;
+        QuadroSimulacao& quadro = simulacao->quadros[1 - simulacao->quadro_leitura];
+        trava.unlock();
+
+        std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+
+        float alfa = avanca_simulacao(simulacao->estado, entrada, tempo_decorrido);
+        extrai_quadro_simulacao(simulacao->estado, alfa, quadro);
+
+        double duracao = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+
+        trava.lock();
+        /* Um disparo que não foi consumido (nenhum passo executado) continua pendente. */
+        simulacao->entrada.disparar = entrada.disparar;
+        simulacao->duracao_passos = duracao;
+        simulacao->trabalho_pendente = false;
+        simulacao->condicao.notify_all();
+    }
+}
+
+/* Inicia a thread auxiliar. O estado já deve ter sido inicializado com inicializa_simulacao(). */
+void inicia_simulacao_paralela(SimulacaoParalela& simulacao)
+{
+    extrai_quadro_simulacao(simulacao.estado, 1.0f, simulacao.quadros[0]);
+    extrai_quadro_simulacao(simulacao.estado, 1.0f, simulacao.quadros[1]);
+    simulacao.quadro_leitura = 0;
+    simulacao.thread = std::thread(executa_simulacao_paralela, &simulacao);
+}
+
+void solicita_passos_simulacao(SimulacaoParalela& simulacao, const EntradaSimulacao& entrada, double tempo_decorrido)
+{
+    std::lock_guard<std::mutex> trava(simulacao.mutex);
+
+    /* Um disparo ainda não consumido (nenhum passo no quadro anterior) não pode ser perdido. */
+    bool disparo_pendente = simulacao.entrada.disparar;
+    simulacao.entrada = entrada;
+    simulacao.entrada.disparar = simulacao.entrada.disparar || disparo_pendente;
+
+    simulacao.tempo_decorrido = tempo_decorrido;
+    simulacao.trabalho_pendente = true;
+    simulacao.condicao.notify_all();
+}
+
+void aguarda_passos_simulacao(SimulacaoParalela& simulacao)
+{
+    std::unique_lock<std::mutex> trava(simulacao.mutex);
+    simulacao.condicao.wait(trava, [&simulacao] { return !simulacao.trabalho_pendente; });
+    simulacao.quadro_leitura = 1 - simulacao.quadro_leitura;
+}
+
+void encerra_simulacao_paralela(SimulacaoParalela& simulacao)
+{
+    {
+        std::lock_guard<std::mutex> trava(simulacao.mutex);
+        simulacao.encerrar = true;
+        simulacao.condicao.notify_all();
+    }
+    simulacao.thread.join();
+}
+
+const QuadroSimulacao& quadro_simulacao(const SimulacaoParalela& simulacao)
+{
+    return simulacao.quadros[simulacao.quadro_leitura];
+}
@@ -1,6 +1,8 @@
 // Based on http://hamelot.io/visualization/opengl-text-without-any-external-libraries/
 //   and on https://github.com/rougier/freetype-gl
 #include <string>
+#include <vector>
+#include <algorithm>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -87,6 +89,20 @@ GLuint textVBO;
 GLuint textprogram_id;
 GLuint texttexture_id;
 
+// Tabela com o glifo de cada codepoint (NULL quando a fonte não o possui),
+// para que cada caractere seja encontrado sem percorrer dejavufont.glyphs.
+std::vector<texture_glyph_t*> textglyphs;
+
+// Vértices de todos os textos do quadro atual. TextRendering_PrintString()
+// somente acrescenta os quadriláteros dos glifos a este vetor; eles são
+// enviados e desenhados de uma só vez por TextRendering_Flush().
+struct TextVertex
+{
+    float x, y, s, t;
+};
+std::vector<TextVertex> textvertices;
+size_t textvbo_capacity = 0; // Em vértices
+
 void TextRendering_Init()
 {
     GLuint sampler;
@@ -101,6 +117,13 @@ void TextRendering_Init()
     glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glCheckError();
 
+    uint32_t max_codepoint = 0;
+    for (size_t j = 0; j < dejavufont.glyphs_count; ++j)
+        max_codepoint = std::max(max_codepoint, dejavufont.glyphs[j].codepoint);
+    textglyphs.assign(max_codepoint + 1, NULL);
+    for (size_t j = 0; j < dejavufont.glyphs_count; ++j)
+        textglyphs[dejavufont.glyphs[j].codepoint] = &dejavufont.glyphs[j];
+
     GLuint textvertexshader_id = glCreateShader(GL_VERTEX_SHADER);
     TextRendering_LoadShader(textvertexshader_source, textvertexshader_id);
     glCheckError();
@@ -127,7 +150,8 @@ void TextRendering_Init()
     glBindVertexArray(textVAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-    glBufferData(GL_ARRAY_BUFFER, 24 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+    textvbo_capacity = 1024;
+    glBufferData(GL_ARRAY_BUFFER, textvbo_capacity * sizeof(TextVertex), NULL, GL_DYNAMIC_DRAW);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(0);
     glCheckError();
@@ -155,15 +179,8 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
     for (size_t i = 0; i < str.size(); i++)
     {
         // Find the glyph for the character we are looking for
-        texture_glyph_t *glyph = 0;
-        for (size_t j = 0; j < dejavufont.glyphs_count; ++j)
-        {
-            if (dejavufont.glyphs[j].codepoint == (uint32_t)str[i])
-            {
-                glyph = &dejavufont.glyphs[j];
-                break;
-            }
-        }
+        uint32_t codepoint = (unsigned char)str[i];
+        texture_glyph_t *glyph = codepoint < textglyphs.size() ? textglyphs[codepoint] : 0;
         if (!glyph) {
             continue;
         }
@@ -178,7 +195,7 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
         float s1 = glyph->s1 - 0.5f/dejavufont.tex_width;
         float t1 = glyph->t1 - 0.5f/dejavufont.tex_height;
 
-        struct {float x, y, s, t;} data[6] = {
+        TextVertex data[6] = {
             { x0, y0, s0, t0 },
             { x0, y1, s0, t1 },
             { x1, y1, s1, t1 },
@@ -186,29 +203,45 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
             { x1, y1, s1, t1 },
             { x1, y0, s1, t0 }
         };
+        textvertices.insert(textvertices.end(), data, data + 6);
 
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        x += (glyph->advance_x * sx);
+    }
+}
 
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        glDepthFunc(GL_ALWAYS);
-        glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, 24 * sizeof(float), data);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+// Desenha todos os textos acumulados desde a última chamada com uma única
+// chamada de desenho, e esvazia o acumulador. Deve ser chamada uma vez por
+// quadro, depois de todos os TextRendering_Print*(), antes de trocar os buffers.
+void TextRendering_Flush()
+{
+    if (textvertices.empty())
+        return;
 
-        glUseProgram(textprogram_id);
-        glBindVertexArray(textVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, textVBO);
+    while (textvbo_capacity < textvertices.size())
+        textvbo_capacity *= 2;
+    // glBufferData() com NULL descarta o conteúdo anterior do buffer, e o
+    // driver não precisa esperar o desenho do quadro anterior terminar.
+    glBufferData(GL_ARRAY_BUFFER, textvbo_capacity * sizeof(TextVertex), NULL, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, textvertices.size() * sizeof(TextVertex), textvertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDepthFunc(GL_ALWAYS);
 
-        glBindVertexArray(0);
-        glUseProgram(0);
-        glDepthFunc(GL_LESS);
+    glUseProgram(textprogram_id);
+    glBindVertexArray(textVAO);
 
-        glDisable(GL_BLEND);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)textvertices.size());
 
-        x += (glyph->advance_x * sx);
-    }
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glDepthFunc(GL_LESS);
+    glDisable(GL_BLEND);
+
+    textvertices.clear();
 }
 
 float TextRendering_LineHeight(GLFWwindow* window)
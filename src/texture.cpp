@@ -0,0 +1,675 @@
+#include "texture.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+#include <stb_image.h>
+
+#if TEXTURE_SIMD
+#include <emmintrin.h>
+#endif
+
+void DecodeImage(const char* filename, LoadedImage& image)
+{
+    int channels;
+    image.data = stbi_load(filename, &image.width, &image.height, &channels, 3);
+
+    if ( image.data == NULL )
+        throw std::runtime_error(std::string("Cannot open image file \"") + filename + "\".");
+}
+
+void FreeDecodedImage(LoadedImage& image)
+{
+    if (image.data != NULL)
+        stbi_image_free(image.data);
+    image = LoadedImage();
+}
+
+// Reamostra a imagem para width x height pixels com interpolação bilinear,
+// amostrando a imagem original no centro de cada novo pixel. A interpolação
+// bilinear usa somente os 2x2 pixels mais próximos, e em reduções maiores que
+// 2x ignoraria parte da imagem (aliasing); por isso a imagem é antes reduzida
+// à metade com DownsampleImageSRGB() enquanto for pelo menos duas vezes maior
+// que o tamanho pedido nas duas direções.
+void ResizeImage(LoadedImage& image, int width, int height)
+{
+    if (image.width >= 2*width && image.height >= 2*height)
+    {
+        std::vector<unsigned char> current((size_t)image.width * image.height * 4);
+        std::vector<unsigned char> next;
+        ExpandImageRGBA(image, false, current.data());
+        int current_width = image.width;
+        int current_height = image.height;
+        while (current_width >= 2*width && current_height >= 2*height)
+        {
+            next.resize((size_t)(current_width / 2) * (current_height / 2) * 4);
+            DownsampleImageSRGB(current.data(), current_width, current_height,
+                                next.data(), current_width / 2, current_height / 2);
+            current.swap(next);
+            current_width /= 2;
+            current_height /= 2;
+        }
+
+        unsigned char* data = (unsigned char*)malloc((size_t)current_width * current_height * 3);
+        for (size_t i = 0; i < (size_t)current_width * current_height; ++i)
+            memcpy(data + 3*i, &current[4*i], 3);
+        stbi_image_free(image.data);
+        image.data = data;
+        image.width = current_width;
+        image.height = current_height;
+    }
+
+    if (image.width == width && image.height == height)
+        return;
+
+    unsigned char* data = (unsigned char*)malloc((size_t)width * height * 3);
+    float scale_x = (float)image.width / width;
+    float scale_y = (float)image.height / height;
+
+    for (int y = 0; y < height; ++y)
+    {
+        float source_y = std::min(std::max((y + 0.5f) * scale_y - 0.5f, 0.0f), (float)(image.height - 1));
+        int y0 = (int)source_y;
+        int y1 = std::min(y0 + 1, image.height - 1);
+        float fy = source_y - y0;
+
+        for (int x = 0; x < width; ++x)
+        {
+            float source_x = std::min(std::max((x + 0.5f) * scale_x - 0.5f, 0.0f), (float)(image.width - 1));
+            int x0 = (int)source_x;
+            int x1 = std::min(x0 + 1, image.width - 1);
+            float fx = source_x - x0;
+
+            const unsigned char* p00 = image.data + ((size_t)y0 * image.width + x0) * 3;
+            const unsigned char* p01 = image.data + ((size_t)y0 * image.width + x1) * 3;
+            const unsigned char* p10 = image.data + ((size_t)y1 * image.width + x0) * 3;
+            const unsigned char* p11 = image.data + ((size_t)y1 * image.width + x1) * 3;
+            unsigned char* target = data + ((size_t)y * width + x) * 3;
+            for (int c = 0; c < 3; ++c)
+            {
+                float top = p00[c] + (p01[c] - p00[c]) * fx;
+                float bottom = p10[c] + (p11[c] - p10[c]) * fx;
+                target[c] = (unsigned char)(top + (bottom - top) * fy + 0.5f);
+            }
+        }
+    }
+
+    // A memória de "data" é liberada por FreeDecodedImage(), com a mesma
+    // função free() usada pela stb_image.
+    stbi_image_free(image.data);
+    image.data = data;
+    image.width = width;
+    image.height = height;
+}
+
+size_t TextureLevelSize(int format, int width, int height)
+{
+    if (format == TEXTURE_FORMAT_BC1)
+        return (size_t)((width + 3) / 4) * ((height + 3) / 4) * 8;
+    return (size_t)width * height * 4;
+}
+
+// Calcula os níveis de mipmap de uma textura de width x height pixels, até
+// 1x1. Devolve a soma dos seus tamanhos.
+static size_t TextureLayout(int format, int width, int height, std::vector<TextureLevel>& levels)
+{
+    size_t size = 0;
+    levels.clear();
+    for (;;)
+    {
+        TextureLevel level;
+        level.width = width;
+        level.height = height;
+        level.offset = size;
+        level.size = TextureLevelSize(format, width, height);
+        levels.push_back(level);
+        size += level.size;
+
+        if (width == 1 && height == 1)
+            return size;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+}
+
+void ExpandImageRGBA(const LoadedImage& image, bool flip, unsigned char* rgba, bool simd)
+{
+    for (int y = 0; y < image.height; ++y)
+    {
+        const unsigned char* source = image.data + (size_t)(flip ? image.height - 1 - y : y) * image.width * 3;
+        unsigned char* target = rgba + (size_t)y * image.width * 4;
+        int x = 0;
+
+#if TEXTURE_SIMD
+        // Quatro pixels por vez: os 16 bytes lidos a partir do pixel x contêm
+        // os 12 bytes dos pixels x..x+3. Deslocando o vetor 0, 1, 2 e 3 bytes
+        // para a esquerda, os bytes de cada pixel caem na sua posição de 32
+        // bits; as máscaras escolhem o deslocamento certo para cada pixel.
+        // O laço para enquanto os 16 bytes lidos estão dentro da linha.
+        if (simd)
+        {
+            const __m128i mask0 = _mm_setr_epi32(0x00ffffff, 0, 0, 0);
+            const __m128i mask1 = _mm_setr_epi32(0, 0x00ffffff, 0, 0);
+            const __m128i mask2 = _mm_setr_epi32(0, 0, 0x00ffffff, 0);
+            const __m128i mask3 = _mm_setr_epi32(0, 0, 0, 0x00ffffff);
+            const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+            for (; x + 6 <= image.width; x += 4)
+            {
+                __m128i pixels = _mm_loadu_si128((const __m128i*)(source + 3*x));
+                __m128i result = _mm_or_si128(_mm_and_si128(pixels, mask0), _mm_and_si128(_mm_slli_si128(pixels, 1), mask1));
+                result = _mm_or_si128(result, _mm_and_si128(_mm_slli_si128(pixels, 2), mask2));
+                result = _mm_or_si128(result, _mm_and_si128(_mm_slli_si128(pixels, 3), mask3));
+                _mm_storeu_si128((__m128i*)(target + 4*x), _mm_or_si128(result, alpha));
+            }
+        }
+#else
+        (void)simd;
+#endif
+
+        for (; x < image.width; ++x)
+        {
+            target[4*x + 0] = source[3*x + 0];
+            target[4*x + 1] = source[3*x + 1];
+            target[4*x + 2] = source[3*x + 2];
+            target[4*x + 3] = 255;
+        }
+    }
+}
+
+// Tabelas de conversão entre sRGB de 8 bits e intensidade linear de 16 bits.
+// A conversão de volta usa uma entrada para cada valor linear, para que nenhum
+// valor sRGB se perca nos tons escuros.
+struct SRGBTables
+{
+    uint16_t      to_linear[256];
+    unsigned char to_srgb[65536];
+
+    SRGBTables()
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            double c = i / 255.0;
+            double linear = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+            to_linear[i] = (uint16_t)(linear * 65535.0 + 0.5);
+        }
+        for (int i = 0; i < 65536; ++i)
+        {
+            double linear = i / 65535.0;
+            double c = linear <= 0.0031308 ? linear * 12.92 : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+            to_srgb[i] = (unsigned char)(c * 255.0 + 0.5);
+        }
+    }
+};
+
+static const SRGBTables& GetSRGBTables()
+{
+    static const SRGBTables tables; // Inicialização thread-safe em C++11
+    return tables;
+}
+
+// Converte uma linha RGBA sRGB para intensidades lineares (o alfa é ignorado).
+static void RowToLinear(const SRGBTables& tables, const unsigned char* rgba, int width, uint16_t* linear)
+{
+    for (int i = 0; i < 4*width; ++i)
+        linear[i] = tables.to_linear[rgba[i]];
+}
+
+// Média de cada bloco 2x2, calculada como duas médias de pares com
+// arredondamento para cima ((a + b + 1) / 2), exatamente como _mm_avg_epu16().
+static inline uint16_t Average(uint16_t a, uint16_t b)
+{
+    return (uint16_t)((a + b + 1) >> 1);
+}
+
+void DownsampleImageSRGB(const unsigned char* rgba, int width, int height,
+                         unsigned char* target, int target_width, int target_height, bool simd)
+{
+    const SRGBTables& tables = GetSRGBTables();
+    std::vector<uint16_t> row0((size_t)width * 4);
+    std::vector<uint16_t> row1((size_t)width * 4);
+    std::vector<uint16_t> result((size_t)target_width * 4);
+
+    for (int y = 0; y < target_height; ++y)
+    {
+        // Em dimensões ímpares, a última linha e a última coluna são repetidas.
+        RowToLinear(tables, rgba + (size_t)std::min(2*y, height - 1) * width * 4, width, row0.data());
+        RowToLinear(tables, rgba + (size_t)std::min(2*y + 1, height - 1) * width * 4, width, row1.data());
+
+        int x = 0;
+#if TEXTURE_SIMD
+        // Dois pixels do resultado por vez, a partir de 4x2 pixels de origem.
+        if (simd)
+        {
+            for (; 2*x + 4 <= width && x + 2 <= target_width; x += 2)
+            {
+                __m128i a = _mm_avg_epu16(_mm_loadu_si128((const __m128i*)&row0[8*x]), _mm_loadu_si128((const __m128i*)&row1[8*x]));
+                __m128i b = _mm_avg_epu16(_mm_loadu_si128((const __m128i*)&row0[8*x + 8]), _mm_loadu_si128((const __m128i*)&row1[8*x + 8]));
+                __m128i even = _mm_unpacklo_epi64(a, b); // Pixels 0 e 2 das médias verticais
+                __m128i odd = _mm_unpackhi_epi64(a, b);  // Pixels 1 e 3
+                _mm_storeu_si128((__m128i*)&result[4*x], _mm_avg_epu16(even, odd));
+            }
+        }
+#else
+        (void)simd;
+#endif
+
+        for (; x < target_width; ++x)
+        {
+            int x0 = std::min(2*x, width - 1);
+            int x1 = std::min(2*x + 1, width - 1);
+            for (int c = 0; c < 4; ++c)
+                result[4*x + c] = Average(Average(row0[4*x0 + c], row1[4*x0 + c]), Average(row0[4*x1 + c], row1[4*x1 + c]));
+        }
+
+        unsigned char* line = target + (size_t)y * target_width * 4;
+        for (int i = 0; i < target_width; ++i)
+        {
+            line[4*i + 0] = tables.to_srgb[result[4*i + 0]];
+            line[4*i + 1] = tables.to_srgb[result[4*i + 1]];
+            line[4*i + 2] = tables.to_srgb[result[4*i + 2]];
+            line[4*i + 3] = 255;
+        }
+    }
+}
+
+void BuildTextureMipmaps(const unsigned char* rgba, int width, int height, int format, TextureData& texture)
+{
+    texture.format = format;
+    texture.size = TextureLayout(format, width, height, texture.levels);
+    texture.pixels.resize(texture.size);
+
+    // Em RGB8 cada nível é gerado diretamente no seu lugar em "pixels"; em
+    // BC1, em "current", antes de ser comprimido.
+    std::vector<unsigned char> current;
+    std::vector<unsigned char> next;
+    const unsigned char* source = rgba;
+    for (size_t i = 0; i < texture.levels.size(); ++i)
+    {
+        const TextureLevel& level = texture.levels[i];
+        if (format == TEXTURE_FORMAT_BC1)
+            CompressBC1(source, level.width, level.height, &texture.pixels[level.offset]);
+        else if (i == 0)
+            memcpy(&texture.pixels[level.offset], source, level.size);
+
+        if (i + 1 < texture.levels.size())
+        {
+            const TextureLevel& smaller = texture.levels[i+1];
+            unsigned char* target = &texture.pixels[smaller.offset];
+            if (format == TEXTURE_FORMAT_BC1)
+            {
+                next.resize((size_t)smaller.width * smaller.height * 4);
+                target = next.data();
+            }
+            DownsampleImageSRGB(source, level.width, level.height, target, smaller.width, smaller.height);
+            if (format == TEXTURE_FORMAT_BC1)
+            {
+                current.swap(next);
+                target = current.data();
+            }
+            source = target;
+        }
+    }
+
+    texture.data = texture.pixels.data();
+}
+
+// Cores dos blocos BC1: RGB 5:6:5 e a sua expansão para 8 bits, como a GPU faz.
+static uint16_t PackRGB565(const float color[3])
+{
+    int r = std::min(std::max((int)(color[0] * 31.0f / 255.0f + 0.5f), 0), 31);
+    int g = std::min(std::max((int)(color[1] * 63.0f / 255.0f + 0.5f), 0), 63);
+    int b = std::min(std::max((int)(color[2] * 31.0f / 255.0f + 0.5f), 0), 31);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void UnpackRGB565(uint16_t packed, int color[3])
+{
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// As quatro cores de um bloco. Com color0 > color1 (o único modo gerado por
+// CompressBC1()), os índices 2 e 3 são interpolações a 1/3 e 2/3; com
+// color0 <= color1, o índice 2 é a média e o 3 é preto.
+static void BC1Palette(uint16_t color0, uint16_t color1, int palette[4][3])
+{
+    UnpackRGB565(color0, palette[0]);
+    UnpackRGB565(color1, palette[1]);
+    for (int c = 0; c < 3; ++c)
+    {
+        if (color0 > color1)
+        {
+            palette[2][c] = (2*palette[0][c] + palette[1][c] + 1) / 3;
+            palette[3][c] = (palette[0][c] + 2*palette[1][c] + 1) / 3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+}
+
+// Escolhe, para cada pixel, a cor mais próxima entre as quatro do bloco.
+// Devolve os índices e, em "error", a soma dos quadrados dos erros.
+static uint32_t BC1Indices(const unsigned char pixels[16][3], uint16_t color0, uint16_t color1, int& error)
+{
+    int palette[4][3];
+    BC1Palette(color0, color1, palette);
+
+    uint32_t indices = 0;
+    error = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        int best = 0;
+        int best_distance = 0x7fffffff;
+        for (int k = 0; k < 4; ++k)
+        {
+            int dr = pixels[i][0] - palette[k][0];
+            int dg = pixels[i][1] - palette[k][1];
+            int db = pixels[i][2] - palette[k][2];
+            int distance = dr*dr + dg*dg + db*db;
+            if (distance < best_distance)
+            {
+                best_distance = distance;
+                best = k;
+            }
+        }
+        indices |= (uint32_t)best << (2*i);
+        error += best_distance;
+    }
+    return indices;
+}
+
+// Ordena as duas cores para o modo de quatro cores (color0 > color1) e
+// calcula os índices. Cores iguais usam somente o índice 0.
+static void EncodeBC1Block(const unsigned char pixels[16][3], uint16_t color0, uint16_t color1,
+                           uint16_t& out0, uint16_t& out1, uint32_t& indices, int& error)
+{
+    if (color0 < color1)
+        std::swap(color0, color1);
+    out0 = color0;
+    out1 = color1;
+
+    if (color0 == color1)
+    {
+        int palette[4][3];
+        BC1Palette(color0, color1, palette);
+        error = 0;
+        for (int i = 0; i < 16; ++i)
+            for (int c = 0; c < 3; ++c)
+                error += (pixels[i][c] - palette[0][c]) * (pixels[i][c] - palette[0][c]);
+        indices = 0;
+        return;
+    }
+    indices = BC1Indices(pixels, color0, color1, error);
+}
+
+// Comprime um bloco 4x4. As duas cores são os extremos da projeção dos
+// pixels no eixo principal (autovetor da matriz de covariância, obtido por
+// iteração de potência); depois de escolhidos os índices, as cores são
+// recalculadas uma vez por mínimos quadrados, e a melhor das duas versões é
+// mantida.
+static void CompressBC1Block(const unsigned char pixels[16][3], unsigned char block[8])
+{
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 3; ++c)
+            mean[c] += pixels[i][c] / 16.0f;
+
+    float covariance[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f}; // rr, rg, rb, gg, gb, bb
+    for (int i = 0; i < 16; ++i)
+    {
+        float r = pixels[i][0] - mean[0];
+        float g = pixels[i][1] - mean[1];
+        float b = pixels[i][2] - mean[2];
+        covariance[0] += r*r; covariance[1] += r*g; covariance[2] += r*b;
+        covariance[3] += g*g; covariance[4] += g*b; covariance[5] += b*b;
+    }
+
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 8; ++iteration)
+    {
+        float x = covariance[0]*axis[0] + covariance[1]*axis[1] + covariance[2]*axis[2];
+        float y = covariance[1]*axis[0] + covariance[3]*axis[1] + covariance[4]*axis[2];
+        float z = covariance[2]*axis[0] + covariance[4]*axis[1] + covariance[5]*axis[2];
+        float length = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+        if (length < 1e-6f)
+            break;
+        axis[0] = x / length;
+        axis[1] = y / length;
+        axis[2] = z / length;
+    }
+
+    float min_t = 0.0f, max_t = 0.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float t = (pixels[i][0] - mean[0])*axis[0] + (pixels[i][1] - mean[1])*axis[1] + (pixels[i][2] - mean[2])*axis[2];
+        min_t = std::min(min_t, t);
+        max_t = std::max(max_t, t);
+    }
+    float length2 = axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2];
+    float endpoint0[3], endpoint1[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        endpoint0[c] = mean[c] + axis[c] * max_t / length2;
+        endpoint1[c] = mean[c] + axis[c] * min_t / length2;
+    }
+
+    uint16_t color0, color1;
+    uint32_t indices;
+    int error;
+    EncodeBC1Block(pixels, PackRGB565(endpoint0), PackRGB565(endpoint1), color0, color1, indices, error);
+
+    // Mínimos quadrados: cada pixel é w*color0 + (1-w)*color1, com o peso w
+    // dado pelo seu índice.
+    if (error > 0 && color0 != color1)
+    {
+        static const float weights[4] = {1.0f, 0.0f, 2.0f/3.0f, 1.0f/3.0f};
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[3] = {0.0f, 0.0f, 0.0f}, bx[3] = {0.0f, 0.0f, 0.0f};
+        for (int i = 0; i < 16; ++i)
+        {
+            float a = weights[(indices >> (2*i)) & 3];
+            float b = 1.0f - a;
+            aa += a*a; ab += a*b; bb += b*b;
+            for (int c = 0; c < 3; ++c)
+            {
+                ax[c] += a * pixels[i][c];
+                bx[c] += b * pixels[i][c];
+            }
+        }
+        float determinant = aa*bb - ab*ab;
+        if (std::fabs(determinant) > 1e-6f)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                endpoint0[c] = (bb*ax[c] - ab*bx[c]) / determinant;
+                endpoint1[c] = (aa*bx[c] - ab*ax[c]) / determinant;
+            }
+            uint16_t refined0, refined1;
+            uint32_t refined_indices;
+            int refined_error;
+            EncodeBC1Block(pixels, PackRGB565(endpoint0), PackRGB565(endpoint1), refined0, refined1, refined_indices, refined_error);
+            if (refined_error < error)
+            {
+                color0 = refined0;
+                color1 = refined1;
+                indices = refined_indices;
+            }
+        }
+    }
+
+    block[0] = (unsigned char)(color0 & 0xff);
+    block[1] = (unsigned char)(color0 >> 8);
+    block[2] = (unsigned char)(color1 & 0xff);
+    block[3] = (unsigned char)(color1 >> 8);
+    for (int k = 0; k < 4; ++k)
+        block[4 + k] = (unsigned char)(indices >> (8*k));
+}
+
+void CompressBC1(const unsigned char* rgba, int width, int height, unsigned char* blocks)
+{
+    for (int block_y = 0; block_y < height; block_y += 4)
+    {
+        for (int block_x = 0; block_x < width; block_x += 4)
+        {
+            unsigned char pixels[16][3];
+            for (int y = 0; y < 4; ++y)
+            {
+                int source_y = std::min(block_y + y, height - 1);
+                for (int x = 0; x < 4; ++x)
+                {
+                    int source_x = std::min(block_x + x, width - 1);
+                    memcpy(pixels[4*y + x], rgba + ((size_t)source_y * width + source_x) * 4, 3);
+                }
+            }
+            CompressBC1Block(pixels, blocks);
+            blocks += 8;
+        }
+    }
+}
+
+void DecompressBC1(const unsigned char* blocks, int width, int height, unsigned char* rgba)
+{
+    for (int block_y = 0; block_y < height; block_y += 4)
+    {
+        for (int block_x = 0; block_x < width; block_x += 4)
+        {
+            uint16_t color0 = (uint16_t)(blocks[0] | (blocks[1] << 8));
+            uint16_t color1 = (uint16_t)(blocks[2] | (blocks[3] << 8));
+            uint32_t indices = blocks[4] | (blocks[5] << 8) | (blocks[6] << 16) | ((uint32_t)blocks[7] << 24);
+            int palette[4][3];
+            BC1Palette(color0, color1, palette);
+
+            for (int y = 0; y < 4 && block_y + y < height; ++y)
+                for (int x = 0; x < 4 && block_x + x < width; ++x)
+                {
+                    const int* color = palette[(indices >> (2*(4*y + x))) & 3];
+                    unsigned char* target = rgba + ((size_t)(block_y + y) * width + block_x + x) * 4;
+                    for (int c = 0; c < 3; ++c)
+                        target[c] = (unsigned char)color[c];
+                    target[3] = 255;
+                }
+            blocks += 8;
+        }
+    }
+}
+
+// Formato do arquivo de cache (todos os campos little-endian, como na memória):
+//     TextureCacheHeader
+//     níveis de mipmap, do maior para 1x1 (veja TextureLayout())
+struct TextureCacheHeader
+{
+    char     magic[8];
+    uint32_t version;
+    int32_t  format;
+    uint64_t source_hash;
+    int32_t  width;
+    int32_t  height;
+    uint64_t data_size;
+};
+
+static const char TEXTURE_CACHE_MAGIC[8] = { 'F','C','G','T','E','X','\0','\0' };
+
+bool SaveTextureCache(const char* cache_filename, uint64_t source_hash, const TextureData& texture)
+{
+    TextureCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TEXTURE_CACHE_MAGIC, sizeof(header.magic));
+    header.version = TEXTURE_CACHE_VERSION;
+    header.format = texture.format;
+    header.source_hash = source_hash;
+    header.width = texture.levels[0].width;
+    header.height = texture.levels[0].height;
+    header.data_size = texture.size;
+
+    return WriteFileReplacing(cache_filename, &header, sizeof(header), texture.data, texture.size);
+}
+
+bool OpenTextureCache(const char* cache_filename, uint64_t source_hash, int format, int size, TextureData& texture)
+{
+    if (!MapFile(cache_filename, texture.cache))
+        return false;
+
+    TextureCacheHeader header;
+    bool valid = texture.cache.size >= sizeof(header);
+    if (valid)
+    {
+        memcpy(&header, texture.cache.data, sizeof(header));
+        valid = memcmp(header.magic, TEXTURE_CACHE_MAGIC, sizeof(header.magic)) == 0
+             && header.version == TEXTURE_CACHE_VERSION
+             && header.format == format
+             && header.source_hash == source_hash
+             && header.width > 0 && header.height > 0
+             && (size == 0 || (header.width == size && header.height == size));
+    }
+
+    valid = valid && TextureLayout(format, header.width, header.height, texture.levels) == header.data_size
+                  && sizeof(header) + header.data_size == texture.cache.size;
+
+    if (valid)
+    {
+        texture.format = format;
+        texture.data = texture.cache.data + sizeof(header);
+        texture.size = header.data_size;
+    }
+    else
+    {
+        UnmapFile(texture.cache);
+        texture.levels.clear();
+    }
+    return valid;
+}
+
+void LoadTexture(const char* filename, int size, int format, TextureData& texture)
+{
+    double start = Now();
+
+    uint64_t source_hash = 0;
+    std::string cache_filename = std::string(filename) + ".texcache";
+
+    texture.from_cache = false;
+    if (format == TEXTURE_FORMAT_BC1)
+    {
+        MappedFile source;
+        if (!MapFile(filename, source))
+            throw std::runtime_error(std::string("Cannot open image file \"") + filename + "\".");
+        source_hash = HashBytes(source.data, source.size);
+        UnmapFile(source);
+
+        texture.from_cache = OpenTextureCache(cache_filename.c_str(), source_hash, format, size, texture);
+    }
+
+    if (!texture.from_cache)
+    {
+        LoadedImage image;
+        DecodeImage(filename, image);
+        if (size > 0)
+            ResizeImage(image, size, size);
+        std::vector<unsigned char> rgba((size_t)image.width * image.height * 4);
+        ExpandImageRGBA(image, true, rgba.data());
+        BuildTextureMipmaps(rgba.data(), image.width, image.height, format, texture);
+        FreeDecodedImage(image);
+
+        if (format == TEXTURE_FORMAT_BC1 && !SaveTextureCache(cache_filename.c_str(), source_hash, texture))
+            fprintf(stderr, "WARNING: Cannot write texture cache \"%s\".\n", cache_filename.c_str());
+    }
+
+    texture.load_time = Now() - start;
+}
+
+void UnloadTexture(TextureData& texture)
+{
+    UnmapFile(texture.cache);
+    texture = TextureData();
+}